@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include "third_party/catch.hpp"
+#include "algorithm/searching/binary_search.hpp"
+#include "algorithm/searching/linear_search.hpp"
+#include "query_benchmark.hpp"
+
+using std::vector;
+
+const size_t BENCHMARK_QUERIES = 100000;
+
+TEST_CASE("Finding keys in small sorted arrays", "[benchmark][linear_search]") {
+    // Where linear_find overtakes binary search depends on the vector width:
+    // build with -mavx2 or -mavx512f to compare the vector scans
+    for (const size_t size : {8, 32, 128, 512, 2048, 8192}) {
+        std::mt19937 generator(1);
+        vector<int32_t> keys(size);
+        for (int32_t& key : keys)
+            key = int32_t(generator());
+        std::sort(keys.begin(), keys.end());
+
+        // Every query is found, at a uniformly random position
+        vector<int32_t> queries(BENCHMARK_QUERIES);
+        for (int32_t& query : queries)
+            query = keys[generator() % size];
+
+        const std::string suffix = " (" + std::to_string(size) + " keys)";
+
+        BENCHMARK_ADVANCED("std::find" + suffix)(Catch::Benchmark::Chronometer meter) {
+            benchmark_queries(meter, queries, [&](int32_t query) {
+                return size_t(std::find(keys.begin(), keys.end(), query) - keys.begin());
+            });
+        };
+
+        BENCHMARK_ADVANCED("linear_find" + suffix)(Catch::Benchmark::Chronometer meter) {
+            benchmark_queries(meter, queries, [&](int32_t query) {
+                return size_t(linear_find(keys.begin(), keys.end(), query) - keys.begin());
+            });
+        };
+
+        BENCHMARK_ADVANCED("std::lower_bound" + suffix)(Catch::Benchmark::Chronometer meter) {
+            benchmark_queries(meter, queries, [&](int32_t query) {
+                return size_t(std::lower_bound(keys.begin(), keys.end(), query) - keys.begin());
+            });
+        };
+
+        BENCHMARK_ADVANCED("branchless_lower_bound" + suffix)(Catch::Benchmark::Chronometer meter) {
+            benchmark_queries(meter, queries, [&](int32_t query) {
+                return size_t(branchless_lower_bound(keys.begin(), keys.end(), query) - keys.begin());
+            });
+        };
+    }
+}
+
+TEST_CASE("Scanning 1M random bytes", "[benchmark][linear_search]") {
+    std::mt19937 generator(1);
+    vector<uint8_t> bytes(1 << 20);
+    for (uint8_t& byte : bytes)
+        byte = uint8_t(generator() % 255);
+
+    // No byte is 255, so finding it scans all the bytes
+    BENCHMARK("std::find of a missing byte") {
+        return std::find(bytes.begin(), bytes.end(), uint8_t(255));
+    };
+
+    BENCHMARK("linear_find of a missing byte") {
+        return linear_find(bytes.begin(), bytes.end(), uint8_t(255));
+    };
+
+    BENCHMARK("std::count of a byte") {
+        return std::count(bytes.begin(), bytes.end(), uint8_t(7));
+    };
+
+    BENCHMARK("linear_count of a byte") {
+        return linear_count(bytes.begin(), bytes.end(), uint8_t(7));
+    };
+}
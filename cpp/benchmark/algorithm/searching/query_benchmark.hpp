@@ -0,0 +1,43 @@
+#ifndef QUERY_BENCHMARK_HPP
+#define QUERY_BENCHMARK_HPP
+
+#include <cstddef>
+#include <vector>
+#include "third_party/catch.hpp"
+
+/*
+    benchmark_queries
+    -----------------
+    Measures search on every query, and sums the positions it returns so
+    that the searches can't be optimized away.
+*/
+template <typename T, typename Search>
+void benchmark_queries(Catch::Benchmark::Chronometer meter, const std::vector<T>& queries, Search search) {
+    meter.measure([&] {
+        size_t sum = 0;
+        for (const T& query : queries)
+            sum += search(query);
+        return sum;
+    });
+}
+
+/*
+    benchmark_batch
+    ---------------
+    Measures search_all(queries, positions), which searches all the queries
+    at once and writes their positions, and sums the positions like
+    benchmark_queries.
+*/
+template <typename T, typename SearchAll>
+void benchmark_batch(Catch::Benchmark::Chronometer meter, const std::vector<T>& queries, SearchAll search_all) {
+    std::vector<size_t> positions(queries.size());
+    meter.measure([&] {
+        search_all(queries, positions);
+        size_t sum = 0;
+        for (const size_t position : positions)
+            sum += position;
+        return sum;
+    });
+}
+
+#endif // QUERY_BENCHMARK_HPP
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include "third_party/catch.hpp"
+#include "algorithm/searching/binary_search.hpp"
+#include "algorithm/searching/interpolation_search.hpp"
+#include "algorithm/searching/static_search_index.hpp"
+#include "query_benchmark.hpp"
+
+const size_t BENCHMARK_SIZE = 16000000;
+const size_t BENCHMARK_QUERIES = 1000000;
+
+TEST_CASE("Lower bounds of 1M random queries on 16M sorted integers", "[benchmark][static_search_index]") {
+    std::mt19937 generator(1);
+    vector<int32_t> keys(BENCHMARK_SIZE);
+    for (int32_t& key : keys)
+        key = int32_t(generator());
+    std::sort(keys.begin(), keys.end());
+
+    vector<int32_t> queries(BENCHMARK_QUERIES);
+    for (int32_t& query : queries)
+        query = int32_t(generator());
+    vector<int32_t> sorted_queries = queries;
+    std::sort(sorted_queries.begin(), sorted_queries.end());
+
+    const EytzingerIndex<int32_t> eytzinger_index(keys);
+    const BTreeIndex<int32_t> b_tree_index(keys);
+    const LearnedIndex<int32_t> learned_index(keys);
+
+    BENCHMARK_ADVANCED("std::lower_bound")(Catch::Benchmark::Chronometer meter) {
+        benchmark_queries(meter, queries, [&](int32_t query) {
+            return size_t(std::lower_bound(keys.begin(), keys.end(), query) - keys.begin());
+        });
+    };
+
+    BENCHMARK_ADVANCED("branchless_lower_bound")(Catch::Benchmark::Chronometer meter) {
+        benchmark_queries(meter, queries, [&](int32_t query) {
+            return size_t(branchless_lower_bound(keys.begin(), keys.end(), query) - keys.begin());
+        });
+    };
+
+    // batch_lower_bound gathers with AVX2 (e.g. -mavx2), and
+    // multi_lower_bound gallops through sorted queries
+    BENCHMARK_ADVANCED("batch_lower_bound")(Catch::Benchmark::Chronometer meter) {
+        benchmark_batch(meter, queries, [&](const vector<int32_t>& batch, vector<size_t>& positions) {
+            batch_lower_bound(keys.begin(), keys.end(), batch.begin(), batch.end(), positions.begin());
+        });
+    };
+
+    BENCHMARK_ADVANCED("multi_lower_bound of sorted queries")(Catch::Benchmark::Chronometer meter) {
+        benchmark_batch(meter, sorted_queries, [&](const vector<int32_t>& batch, vector<size_t>& positions) {
+            multi_lower_bound(keys.begin(), keys.end(), batch.begin(), batch.end(), positions.begin());
+        });
+    };
+
+    BENCHMARK_ADVANCED("Eytzinger index")(Catch::Benchmark::Chronometer meter) {
+        benchmark_queries(meter, queries, [&](int32_t query) {
+            return eytzinger_index.lower_bound(query);
+        });
+    };
+
+    BENCHMARK_ADVANCED("B-tree index")(Catch::Benchmark::Chronometer meter) {
+        benchmark_queries(meter, queries, [&](int32_t query) {
+            return b_tree_index.lower_bound(query);
+        });
+    };
+
+    BENCHMARK_ADVANCED("interpolation_lower_bound")(Catch::Benchmark::Chronometer meter) {
+        benchmark_queries(meter, queries, [&](int32_t query) {
+            return size_t(interpolation_lower_bound(keys.begin(), keys.end(), query) - keys.begin());
+        });
+    };
+
+    BENCHMARK_ADVANCED("Learned index")(Catch::Benchmark::Chronometer meter) {
+        benchmark_queries(meter, queries, [&](int32_t query) {
+            return learned_index.lower_bound(query);
+        });
+    };
+}
@@ -0,0 +1,44 @@
+#include <random>
+#include "third_party/catch.hpp"
+#include "algorithm/sorting/heap_sort.hpp"
+
+const size_t BENCHMARK_SIZE = 10000000;
+
+/*
+    benchmark_sort
+    --------------
+    Measures sort on copies of values, which are made outside the timed
+    region.
+*/
+template <typename Sort>
+void benchmark_sort(Catch::Benchmark::Chronometer meter, const vector<int>& values, Sort sort) {
+    vector<vector<int>> inputs(meter.runs(), values);
+    meter.measure([&](int run) {
+        sort(inputs[run]);
+    });
+}
+
+TEST_CASE("Heap sort of 10M random integers", "[benchmark][heap_sort]") {
+    std::mt19937 generator(1);
+    vector<int> values(BENCHMARK_SIZE);
+    for (int& value : values)
+        value = int(generator());
+
+    BENCHMARK_ADVANCED("binary heap")(Catch::Benchmark::Chronometer meter) {
+        benchmark_sort(meter, values, [](vector<int>& input) {
+            heap_sort(input.begin(), input.end());
+        });
+    };
+
+    BENCHMARK_ADVANCED("4-ary heap")(Catch::Benchmark::Chronometer meter) {
+        benchmark_sort(meter, values, [](vector<int>& input) {
+            dary_heap_sort<4>(input.begin(), input.end());
+        });
+    };
+
+    BENCHMARK_ADVANCED("8-ary heap")(Catch::Benchmark::Chronometer meter) {
+        benchmark_sort(meter, values, [](vector<int>& input) {
+            dary_heap_sort<8>(input.begin(), input.end());
+        });
+    };
+}
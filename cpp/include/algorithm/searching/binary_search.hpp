@@ -4,6 +4,17 @@
     A searching algorithm that finds the index of a target value within a
     sorted array using divide and conquer.
 
+    branchless_lower_bound, branchless_upper_bound and branchless_equal_range
+    search any sorted random access range, like their std counterparts,
+    without branching on the comparisons: every step halves the range with a
+    conditional move, and prefetches both elements that the next step may
+    compare. batch_lower_bound interleaves many such searches, so that their
+    cache misses overlap; with AVX2, it searches 32 bit integers a vector of
+    8 queries at a time, with gathers. sorted_batch_lower_bound searches
+    sorted queries by galloping from one result to the next, and
+    multi_lower_bound picks either, depending on whether the queries are
+    sorted.
+
     Time complexity
     ---------------
     O(log(N)), where N is the number of elements in the array.
@@ -16,34 +27,342 @@
 #ifndef BINARY_SEARCH_HPP
 #define BINARY_SEARCH_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#include "algorithm/sorting/utils.hpp"
+
+#if defined(__AVX2__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SEARCH_SIMD 1
+#else
+#define SEARCH_SIMD 0
+#endif
+
+// Number of searches that batch_lower_bound interleaves
+const size_t BATCH_SEARCH_GROUP_SIZE = 16;
+
+// Number of 32 bit keys in an AVX2 vector, and of searches that
+// batch_lower_bound interleaves with gathers: gathers take longer to issue,
+// so more of them have to be in flight
+const size_t SEARCH_SIMD_LANES = 8;
+const size_t GATHER_SEARCH_GROUP_SIZE = 32;
+
+// multi_lower_bound gallops through sorted queries if there are at most
+// this many keys per query
+const size_t GALLOP_SEARCH_MAX_KEYS_PER_QUERY = 16;
+
+/*
+    prefetch_for_search
+    -------------------
+    Hints the processor to load the cache line that holds *it.
+*/
+
+template <typename RandomIt>
+void prefetch_for_search(RandomIt it) {
+#if defined(__GNUC__)
+    __builtin_prefetch(std::addressof(*it));
+#else
+    (void)it;
+#endif
+}
+
+
+/*
+    branchless_lower_bound
+    ----------------------
+    Returns the first position in the sorted range [first, last) whose
+    element does not come before value according to comp, or last if there
+    is none. The range is narrowed to its upper half or kept to its lower
+    half without a branch, so the steps are never mispredicted; both
+    candidates for the next step are prefetched meanwhile.
+*/
+
+template <typename RandomIt, typename T, typename Compare = std::less<>>
+RandomIt branchless_lower_bound(RandomIt first, RandomIt last, const T& value, Compare comp = Compare()) {
+    auto size = last - first;
+    if (size == 0)
+        return last;
+
+    while (size > 1) {
+        const auto half = size / 2;
+        size -= half;
+        prefetch_for_search(first + size / 2);
+        prefetch_for_search(first + half + size / 2);
+        first = comp(first[half], value) ? first + half : first;
+    }
+    return first + comp(*first, value);
+}
+
+
+/*
+    branchless_upper_bound
+    ----------------------
+    Returns the first position in the sorted range [first, last) whose
+    element comes after value according to comp, or last if there is none.
+*/
+
+template <typename RandomIt, typename T, typename Compare = std::less<>>
+RandomIt branchless_upper_bound(RandomIt first, RandomIt last, const T& value, Compare comp = Compare()) {
+    auto size = last - first;
+    if (size == 0)
+        return last;
+
+    while (size > 1) {
+        const auto half = size / 2;
+        size -= half;
+        prefetch_for_search(first + size / 2);
+        prefetch_for_search(first + half + size / 2);
+        first = comp(value, first[half]) ? first : first + half;
+    }
+    return first + !comp(value, *first);
+}
+
+
+/*
+    branchless_equal_range
+    ----------------------
+    Returns the range of elements of the sorted range [first, last) that are
+    equivalent to value according to comp.
+*/
+
+template <typename RandomIt, typename T, typename Compare = std::less<>>
+std::pair<RandomIt, RandomIt> branchless_equal_range(RandomIt first, RandomIt last, const T& value,
+                                                     Compare comp = Compare()) {
+    const RandomIt lower = branchless_lower_bound(first, last, value, comp);
+    return std::make_pair(lower, branchless_upper_bound(lower, last, value, comp));
+}
+
+
+/*
+    HasGatherSearch
+    ---------------
+    Whether batch_lower_bound searches with AVX2 gathers: the keys must be
+    contiguous 32 bit integers, the queries 32 bit integers too, and comp a
+    standard order.
+*/
+
+template <typename RandomIt, typename InputIt, typename Compare>
+struct HasGatherSearch : std::integral_constant<bool,
+    SEARCH_SIMD and IsStandardOrder<int32_t, Compare>::value and
+    std::is_same<typename std::iterator_traits<InputIt>::value_type, int32_t>::value and
+    (std::is_same<RandomIt, int32_t*>::value or
+     std::is_same<RandomIt, const int32_t*>::value or
+     std::is_same<RandomIt, std::vector<int32_t>::iterator>::value or
+     std::is_same<RandomIt, std::vector<int32_t>::const_iterator>::value)> {};
+
+
+/*
+    batch_lower_bound
+    -----------------
+    Writes the index of branchless_lower_bound(first, last, query, comp) in
+    the sorted range [first, last) to out, for every query of [queries_first,
+    queries_last), and returns the end of the output. The steps of a search
+    only depend on the size of the range, so the searches of a group of
+    BATCH_SEARCH_GROUP_SIZE queries advance in lockstep: each step issues
+    all of their loads before using any of them, and their cache misses are
+    served in parallel instead of one after the other. Nothing is
+    prefetched, since the loads already overlap, and prefetching both
+    candidates would double the memory traffic.
+*/
+
+template <typename RandomIt, typename InputIt, typename OutputIt, typename Compare>
+OutputIt batch_lower_bound(RandomIt first, RandomIt last, InputIt queries_first, InputIt queries_last,
+                           OutputIt out, Compare comp, std::false_type /* has gather */) {
+    using Query = typename std::iterator_traits<InputIt>::value_type;
+    using Distance = typename std::iterator_traits<RandomIt>::difference_type;
+
+    const Distance size = last - first;
+    Query queries[BATCH_SEARCH_GROUP_SIZE];
+    Distance bases[BATCH_SEARCH_GROUP_SIZE];
+
+    while (queries_first != queries_last) {
+        size_t group_size = 0;
+        for (; group_size < BATCH_SEARCH_GROUP_SIZE and queries_first != queries_last; ++queries_first)
+            queries[group_size++] = *queries_first;
+
+        if (size == 0) {
+            for (size_t i = 0; i < group_size; i++)
+                *out++ = 0;
+            continue;
+        }
+
+        for (size_t i = 0; i < group_size; i++)
+            bases[i] = 0;
+
+        for (Distance remaining = size; remaining > 1; ) {
+            const Distance half = remaining / 2;
+            remaining -= half;
+            for (size_t i = 0; i < group_size; i++)
+                bases[i] = comp(first[bases[i] + half], queries[i]) ? bases[i] + half : bases[i];
+        }
+
+        for (size_t i = 0; i < group_size; i++)
+            *out++ = size_t(bases[i] + comp(first[bases[i]], queries[i]));
+    }
+    return out;
+}
+
+#if SEARCH_SIMD
+/*
+    With AVX2, groups of GATHER_SEARCH_GROUP_SIZE queries are searched a
+    vector of SEARCH_SIMD_LANES queries at a time: every step gathers the
+    keys that the lanes compare with, and adds the step to the lanes whose
+    key comes before their query. Ranges too large for 32 bit indices are
+    searched without SIMD.
+*/
+
+template <typename RandomIt, typename InputIt, typename OutputIt, typename Compare>
+OutputIt batch_lower_bound(RandomIt first, RandomIt last, InputIt queries_first, InputIt queries_last,
+                           OutputIt out, Compare comp, std::true_type /* has gather */) {
+    const size_t num_vectors = GATHER_SEARCH_GROUP_SIZE / SEARCH_SIMD_LANES;
+    const auto size = last - first;
+    if (size == 0 or size > std::numeric_limits<int32_t>::max())
+        return batch_lower_bound(first, last, queries_first, queries_last, out, comp, std::false_type());
+
+    const bool descending = IsReverseOrder<Compare>::value;
+    const int* keys = &*first;
+    alignas(32) int32_t queries[GATHER_SEARCH_GROUP_SIZE];
+    alignas(32) int32_t bases[GATHER_SEARCH_GROUP_SIZE];
+
+    while (queries_first != queries_last) {
+        size_t group_size = 0;
+        for (; group_size < GATHER_SEARCH_GROUP_SIZE and queries_first != queries_last; ++queries_first)
+            queries[group_size++] = *queries_first;
+        for (size_t i = group_size; i < GATHER_SEARCH_GROUP_SIZE; i++)
+            queries[i] = queries[0];
+
+        __m256i query_vectors[num_vectors];
+        __m256i base_vectors[num_vectors];
+        for (size_t v = 0; v < num_vectors; v++) {
+            query_vectors[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(queries + v * SEARCH_SIMD_LANES));
+            base_vectors[v] = _mm256_setzero_si256();
+        }
+
+        for (auto remaining = size; remaining > 1; ) {
+            const auto half = remaining / 2;
+            remaining -= half;
+            const __m256i halves = _mm256_set1_epi32(int32_t(half));
+            for (size_t v = 0; v < num_vectors; v++) {
+                const __m256i probes = _mm256_i32gather_epi32(keys, _mm256_add_epi32(base_vectors[v], halves), 4);
+                const __m256i before = descending ? _mm256_cmpgt_epi32(probes, query_vectors[v])
+                                                  : _mm256_cmpgt_epi32(query_vectors[v], probes);
+                base_vectors[v] = _mm256_add_epi32(base_vectors[v], _mm256_and_si256(before, halves));
+            }
+        }
+
+        // The lanes whose last key comes before their query end one further
+        // (before is -1 in them)
+        for (size_t v = 0; v < num_vectors; v++) {
+            const __m256i probes = _mm256_i32gather_epi32(keys, base_vectors[v], 4);
+            const __m256i before = descending ? _mm256_cmpgt_epi32(probes, query_vectors[v])
+                                              : _mm256_cmpgt_epi32(query_vectors[v], probes);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(bases + v * SEARCH_SIMD_LANES),
+                               _mm256_sub_epi32(base_vectors[v], before));
+        }
+
+        for (size_t i = 0; i < group_size; i++)
+            *out++ = size_t(bases[i]);
+    }
+    return out;
+}
+#endif
+
+template <typename RandomIt, typename InputIt, typename OutputIt, typename Compare = std::less<>>
+OutputIt batch_lower_bound(RandomIt first, RandomIt last, InputIt queries_first, InputIt queries_last,
+                           OutputIt out, Compare comp = Compare()) {
+    return batch_lower_bound(first, last, queries_first, queries_last, out, comp,
+                             HasGatherSearch<RandomIt, InputIt, Compare>());
+}
+
+
+/*
+    sorted_batch_lower_bound
+    ------------------------
+    Like batch_lower_bound, for queries sorted according to comp. Every
+    search starts where the previous one ended, and gallops: it probes the
+    keys 1, 2, 4, ... positions ahead until one does not come before the
+    query, and then searches the last gap with branchless_lower_bound. M
+    queries take O(M * log(N / M)) comparisons on N keys, and when they are
+    as dense as the keys, the search becomes a merge that reads the keys in
+    order.
+*/
+
+template <typename RandomIt, typename InputIt, typename OutputIt, typename Compare = std::less<>>
+OutputIt sorted_batch_lower_bound(RandomIt first, RandomIt last, InputIt queries_first, InputIt queries_last,
+                                  OutputIt out, Compare comp = Compare()) {
+    using Distance = typename std::iterator_traits<RandomIt>::difference_type;
+
+    const Distance size = last - first;
+    Distance position = 0;
+    for (; queries_first != queries_last; ++queries_first) {
+        const auto& query = *queries_first;
+
+        Distance step = 1;
+        while (step <= size - position and comp(first[position + step - 1], query)) {
+            position += step;
+            step *= 2;
+        }
+
+        const Distance gap_end = position + std::min(step - 1, size - position);
+        position = branchless_lower_bound(first + position, first + gap_end, query, comp) - first;
+        *out++ = size_t(position);
+    }
+    return out;
+}
+
+
+/*
+    multi_lower_bound
+    -----------------
+    Writes the index of the lower bound of every query of [queries_first,
+    queries_last) in the sorted range [first, last) to out, and returns the
+    end of the output, which must have room for all of them. Queries sorted
+    according to comp are searched with sorted_batch_lower_bound if there
+    are at most GALLOP_SEARCH_MAX_KEYS_PER_QUERY keys per query. Sparser
+    queries would gallop over gaps that miss the cache on every probe, so
+    they are searched with batch_lower_bound, like unsorted queries.
+*/
+
+template <typename RandomIt, typename ForwardIt, typename OutputIt, typename Compare = std::less<>>
+OutputIt multi_lower_bound(RandomIt first, RandomIt last, ForwardIt queries_first, ForwardIt queries_last,
+                           OutputIt out, Compare comp = Compare()) {
+    const size_t num_queries = size_t(std::distance(queries_first, queries_last));
+    const size_t size = size_t(last - first);
+    if (size <= num_queries * GALLOP_SEARCH_MAX_KEYS_PER_QUERY and
+        std::is_sorted(queries_first, queries_last, comp))
+        return sorted_batch_lower_bound(first, last, queries_first, queries_last, out, comp);
+    return batch_lower_bound(first, last, queries_first, queries_last, out, comp);
+}
 
 /*
     binary_search
     -------------
-    It compares the target value to the middle element of the array; if they
-    are unequal, the half in which the target cannot lie is eliminated and the
-    search continues on the remaining half until it is successful. If the search
-    ends with the remaining half being empty, the target is not in the array.
+    Finds the lower bound of value among the elements at the indices
+    [low, high] of the sorted array, with branchless_lower_bound, i.e. the
+    first of them that is not less than value. Returns its index if it is
+    equal to value, so the first match if there are several, or -1 if there
+    is no match.
 */
 
 template <typename T>
 int binary_search(const T& value, const std::vector<T>& sorted_values,
         const int low, const int high) {
-    int mid = low + (high - low) / 2;
-
-    if (value == sorted_values[mid])
-        return mid;
-    else if (low <= high) {
-        if (value < sorted_values[mid]) {
-            // value must be between indices low and mid-1, if exists
-            return binary_search(value, sorted_values, low, mid - 1);
-        }
-        else if (value > sorted_values[mid]) {
-            // value must be between indices mid+1 and high, if exists
-            return binary_search(value, sorted_values, mid + 1, high);
-        }
-    }
+    if (low > high)
+        return -1;
+
+    const auto first = sorted_values.begin() + low;
+    const auto last = sorted_values.begin() + (high + 1);
+    const auto found = branchless_lower_bound(first, last, value);
+    if (found != last and *found == value)
+        return int(found - sorted_values.begin());
 
     return -1;
 }
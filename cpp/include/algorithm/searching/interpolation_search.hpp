@@ -0,0 +1,389 @@
+/*
+    Interpolation search
+    --------------------
+    Searches sorted numeric keys by estimating where a value lies from the
+    values of the keys, rather than halving the range: for a value 30% of
+    the way from the first to the last key, it looks 30% into the range.
+    On uniformly distributed keys, this takes O(log(log(N))) probes instead
+    of log2(N).
+
+    interpolation_lower_bound alternates interpolation with bisection
+    whenever a probe fails to halve the range, so skewed keys still take
+    O(log(N)) probes.
+
+    LearnedIndex fits the positions of the keys with a piecewise linear
+    function of the keys, whose error is at most max_error positions, in
+    the style of a PGM index. A search finds the segment of the value among
+    the few segments, predicts the position of the value, and searches the
+    2 * max_error + 2 keys around it. The segments are fitted in one pass,
+    and the keys can be cut into chunks that are fitted in parallel.
+
+    Time complexity
+    ---------------
+    O(log(log(N))) on average for uniform keys, and O(log(N)) in the worst
+    case, for interpolation_lower_bound. O(log(S) + log(E)) for searches in
+    a LearnedIndex of S segments with error E, and O(N) to build it.
+
+    Space complexity
+    ----------------
+    O(1) for interpolation_lower_bound, and O(N + S) for LearnedIndex, which
+    keeps a copy of the keys.
+*/
+
+#ifndef INTERPOLATION_SEARCH_HPP
+#define INTERPOLATION_SEARCH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "binary_search.hpp"
+#include "algorithm/sorting/work_stealing_pool.hpp"
+
+using std::vector;
+
+// Ranges this small are searched with branchless_lower_bound, which takes
+// fewer steps than interpolation would pay for in divisions
+const size_t INTERPOLATION_SEARCH_MIN_SIZE = 32;
+
+// Default error of a LearnedIndex: its searches read 65 keys, which for
+// 32 bit keys are five cache lines
+const size_t LEARNED_INDEX_MAX_ERROR = 32;
+
+// Chunks that a LearnedIndex fits in parallel have at least this many keys
+const size_t LEARNED_INDEX_GRAIN_SIZE = 1 << 16;
+
+/*
+    key_distance
+    ------------
+    Returns to - from, for keys from <= to, as a double. Integer keys are
+    subtracted before they are converted, so that the distance of large
+    keys is not lost to rounding, and the subtraction cannot overflow.
+*/
+
+template <typename T>
+double key_distance(const T from, const T to, std::true_type /* is integral */) {
+    using Unsigned = typename std::make_unsigned<T>::type;
+    return double(Unsigned(Unsigned(to) - Unsigned(from)));
+}
+
+template <typename T>
+double key_distance(const T from, const T to, std::false_type /* is integral */) {
+    return double(to) - double(from);
+}
+
+template <typename T>
+double key_distance(const T from, const T to) {
+    return key_distance(from, to, std::is_integral<T>());
+}
+
+
+/*
+    interpolation_lower_bound
+    -------------------------
+    Returns the first position in the range [first, last) of numeric keys
+    sorted in ascending order whose key is not less than value, or last if
+    there is none. Every step probes the position that linear interpolation
+    between the first and last key of the range predicts for value. A probe
+    that leaves more than half of the range is followed by a bisection, and
+    small ranges are finished with branchless_lower_bound.
+*/
+
+template <typename RandomIt, typename T>
+RandomIt interpolation_lower_bound(RandomIt first, RandomIt last, const T& value) {
+    using Key = typename std::iterator_traits<RandomIt>::value_type;
+    using Distance = typename std::iterator_traits<RandomIt>::difference_type;
+    static_assert(std::is_arithmetic<Key>::value, "interpolation needs numeric keys");
+
+    // The result lies in [low, high]
+    Distance low = 0;
+    Distance high = last - first;
+    while (high - low > Distance(INTERPOLATION_SEARCH_MIN_SIZE)) {
+        const Key low_key = first[low];
+        const Key high_key = first[high - 1];
+        if (!(low_key < value))
+            return first + low;
+        if (high_key < value)
+            return first + high;
+
+        // low_key < value <= high_key, so the fraction is in (0, 1], unless
+        // infinite keys make it NaN
+        double fraction = key_distance(low_key, Key(value)) / key_distance(low_key, high_key);
+        if (!(fraction >= 0 and fraction <= 1))
+            fraction = 0.5;
+        const Distance size = high - low;
+        const Distance probe = std::min(low + Distance(fraction * double(size - 1)), high - 1);
+        if (first[probe] < value)
+            low = probe + 1;
+        else
+            high = probe;
+
+        if (2 * (high - low) > size) {
+            const Distance middle = low + (high - low) / 2;
+            if (first[middle] < value)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+    }
+    return branchless_lower_bound(first + low, first + high, value);
+}
+
+
+/*
+    interpolation_search
+    --------------------
+    Returns the index of the first element of sorted_values equal to value,
+    or -1 if there is none.
+*/
+
+template <typename T>
+int interpolation_search(const T& value, const std::vector<T>& sorted_values) {
+    const auto found = interpolation_lower_bound(sorted_values.begin(), sorted_values.end(), value);
+    if (found != sorted_values.end() and *found == value)
+        return int(found - sorted_values.begin());
+
+    return -1;
+}
+
+
+/*
+    LinearSegment
+    -------------
+    A segment of the model of a LearnedIndex: keys from first_key up to the
+    first key of the next segment are predicted to lie at position
+    first_position + slope * (key - first_key).
+*/
+
+template <typename T>
+struct LinearSegment {
+    T first_key;
+    double first_position;
+    double slope;
+};
+
+
+/*
+    fit_linear_segments
+    -------------------
+    Appends segments that predict the first position of every distinct key
+    of keys[begin, end], and of keys[end] if it exists, to within max_error
+    positions. keys[begin] must be the first of its duplicates.
+
+    Every segment starts at a key, and takes the following keys as long as
+    some slope predicts all of them within max_error (the "shrinking cone"
+    of slopes): each key narrows the range of slopes, and when it would
+    empty it, the segment ends at the previous key, and the next segment
+    starts there. Consecutive segments share a key, so a value between the
+    last two keys of a segment is predicted by a segment that fits both.
+*/
+
+template <typename T>
+void fit_linear_segments(const vector<T>& keys, const size_t begin, const size_t end, const double max_error,
+                         vector<LinearSegment<T>>& segments) {
+    const double no_slope = std::numeric_limits<double>::infinity();
+    size_t anchor = begin;
+    size_t previous = begin;
+    double min_slope = 0;
+    double max_slope = no_slope;
+
+    const size_t stop = std::min(end + 1, keys.size());
+    for (size_t position = begin + 1; position < stop; position++) {
+        if (!(keys[position - 1] < keys[position]))
+            continue;   // only the first of equal keys is fitted
+
+        double distance = key_distance(keys[anchor], keys[position]);
+        double low = (double(position - anchor) - max_error) / distance;
+        double high = (double(position - anchor) + max_error) / distance;
+        if (low > max_slope or high < min_slope) {
+            segments.push_back({keys[anchor], double(anchor), (min_slope + max_slope) / 2});
+            anchor = previous;
+            distance = key_distance(keys[anchor], keys[position]);
+            low = (double(position - anchor) - max_error) / distance;
+            high = (double(position - anchor) + max_error) / distance;
+            min_slope = 0;
+            max_slope = no_slope;
+        }
+        min_slope = std::max(min_slope, low);
+        max_slope = std::min(max_slope, high);
+        previous = position;
+    }
+
+    const double slope = max_slope == no_slope ? min_slope : (min_slope + max_slope) / 2;
+    segments.push_back({keys[anchor], double(anchor), slope});
+}
+
+
+/*
+    LearnedIndex
+    ------------
+    A copy of numeric keys sorted in ascending order, with a piecewise
+    linear model of their positions, for lower_bound searches.
+*/
+
+template <typename T>
+class LearnedIndex {
+    static_assert(std::is_arithmetic<T>::value, "a learned index needs numeric keys");
+
+private:
+    vector<T> keys;
+    vector<T> segment_keys;     // the first key of every segment
+    vector<LinearSegment<T>> segments;
+    size_t max_error;
+
+    void fit_chunks(const vector<size_t>& chunk_begins, WorkStealingPool* pool);
+
+public:
+    explicit LearnedIndex(const vector<T>& sorted_keys, size_t max_error = LEARNED_INDEX_MAX_ERROR);
+    LearnedIndex(WorkStealingPool& pool, const vector<T>& sorted_keys,
+                 size_t max_error = LEARNED_INDEX_MAX_ERROR);
+    size_t lower_bound(const T& value) const;
+    size_t size() const;
+    size_t num_segments() const;
+};
+
+/*
+    Constructor
+    -----------
+    Fits the model of sorted_keys, with an error of at most max_error
+    positions, on the calling thread.
+*/
+
+template <typename T>
+LearnedIndex<T>::LearnedIndex(const vector<T>& sorted_keys, size_t max_error)
+    : keys(sorted_keys), max_error(max_error) {
+    if (!keys.empty())
+        fit_chunks(vector<size_t>(1, 0), nullptr);
+}
+
+
+/*
+    Constructor
+    -----------
+    Fits the model of sorted_keys on the threads of pool along with the
+    calling thread. The keys are cut into one chunk per thread, at the first
+    of equal keys, and the segments of every chunk are fitted independently,
+    which adds at most one segment per chunk.
+*/
+
+template <typename T>
+LearnedIndex<T>::LearnedIndex(WorkStealingPool& pool, const vector<T>& sorted_keys, size_t max_error)
+    : keys(sorted_keys), max_error(max_error) {
+    if (keys.empty())
+        return;
+
+    const size_t num_chunks = std::max(size_t(1), std::min(pool.num_workers() + 1,
+                                                           keys.size() / LEARNED_INDEX_GRAIN_SIZE));
+    vector<size_t> chunk_begins(1, 0);
+    for (size_t chunk = 1; chunk < num_chunks; chunk++) {
+        size_t begin = std::max(chunk * keys.size() / num_chunks, chunk_begins.back() + 1);
+        while (begin < keys.size() and !(keys[begin - 1] < keys[begin]))
+            begin++;
+        if (begin < keys.size())
+            chunk_begins.push_back(begin);
+    }
+    fit_chunks(chunk_begins, &pool);
+}
+
+
+/*
+    fit_chunks
+    ----------
+    Fits the segments of the chunks of keys that start at chunk_begins, on
+    the threads of pool if there is one, and joins them in order.
+*/
+
+template <typename T>
+void LearnedIndex<T>::fit_chunks(const vector<size_t>& chunk_begins, WorkStealingPool* pool) {
+    const size_t num_chunks = chunk_begins.size();
+    vector<vector<LinearSegment<T>>> chunk_segments(num_chunks);
+    auto fit_chunk = [&](const size_t chunk) {
+        const size_t end = chunk + 1 < num_chunks ? chunk_begins[chunk + 1] : keys.size() - 1;
+        fit_linear_segments(keys, chunk_begins[chunk], end, double(max_error), chunk_segments[chunk]);
+    };
+
+    if (pool != nullptr and num_chunks > 1) {
+        TaskGroup group(*pool);
+        for (size_t chunk = 1; chunk < num_chunks; chunk++)
+            group.run([chunk, &fit_chunk]() { fit_chunk(chunk); });
+        fit_chunk(0);
+        group.wait();
+    }
+    else {
+        for (size_t chunk = 0; chunk < num_chunks; chunk++)
+            fit_chunk(chunk);
+    }
+
+    for (const vector<LinearSegment<T>>& chunk : chunk_segments)
+        segments.insert(segments.end(), chunk.begin(), chunk.end());
+    for (const LinearSegment<T>& segment : segments)
+        segment_keys.push_back(segment.first_key);
+}
+
+
+/*
+    lower_bound
+    -----------
+    Returns the index of the first key that is not less than value, or
+    size() if there is none. The segment of value is found by a binary
+    search of the first keys of the segments, and its prediction by a
+    binary search of the keys within max_error of it. The prediction only
+    misses for keys with more than max_error duplicates, or through
+    rounding, and the rest of the keys is then searched instead.
+*/
+
+template <typename T>
+size_t LearnedIndex<T>::lower_bound(const T& value) const {
+    if (keys.empty() or !(keys.front() < value))
+        return 0;
+    if (keys.back() < value)
+        return keys.size();
+
+    const size_t segment = size_t(branchless_upper_bound(segment_keys.begin(), segment_keys.end(), value) -
+                                  segment_keys.begin()) - 1;
+    const LinearSegment<T>& model = segments[segment];
+    const double last_position = double(keys.size());
+    double prediction = model.first_position + model.slope * key_distance(model.first_key, value);
+    if (!(prediction > 0))
+        prediction = 0;     // also for NaN, which infinite keys can lead to
+    else if (prediction > last_position)
+        prediction = last_position;
+
+    const size_t low = size_t(std::max(prediction - double(max_error), 0.0));
+    const size_t high = size_t(std::min(prediction + double(max_error) + 2, last_position));
+    size_t found = size_t(branchless_lower_bound(keys.begin() + low, keys.begin() + high, value) - keys.begin());
+
+    if (found == low and low > 0 and !(keys[low - 1] < value))
+        found = size_t(branchless_lower_bound(keys.begin(), keys.begin() + low, value) - keys.begin());
+    else if (found == high and high < keys.size() and keys[high] < value)
+        found = size_t(branchless_lower_bound(keys.begin() + high, keys.end(), value) - keys.begin());
+    return found;
+}
+
+
+/*
+    size
+    ----
+    Returns the number of keys in the index.
+*/
+
+template <typename T>
+size_t LearnedIndex<T>::size() const {
+    return keys.size();
+}
+
+
+/*
+    num_segments
+    ------------
+    Returns the number of linear segments of the model.
+*/
+
+template <typename T>
+size_t LearnedIndex<T>::num_segments() const {
+    return segments.size();
+}
+
+#endif // INTERPOLATION_SEARCH_HPP
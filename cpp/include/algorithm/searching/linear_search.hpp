@@ -4,6 +4,14 @@
     A searching algorithm that finds the position of a target value within an
     array (sorted or otherwise).
 
+    linear_find, linear_count and linear_find_any scan any range, and compare
+    contiguous integers and floating point numbers a vector at a time when
+    AVX2 or AVX-512 is enabled (e.g. with -mavx2 or -march=native): every
+    vector of keys is compared with the value in one instruction, and the
+    comparisons are reduced to a bit mask, which is checked once per four
+    vectors, so the scan runs at about the speed of memory. linear_find of
+    bytes uses std::memchr, which the C library vectorizes.
+
     Time complexity
     ---------------
     O(N), where N is the number of elements in the array.
@@ -16,8 +24,484 @@
 #ifndef LINEAR_SEARCH_HPP
 #define LINEAR_SEARCH_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <type_traits>
 #include <vector>
 
+#if defined(__AVX2__) && defined(__GNUC__)
+#include <immintrin.h>
+#define LINEAR_SEARCH_SIMD 1
+#else
+#define LINEAR_SEARCH_SIMD 0
+#endif
+
+// Most values linear_find_any compares with a vector of keys; it compares
+// elements one by one with more values
+const size_t LINEAR_FIND_ANY_MAX_SIMD_VALUES = 8;
+
+// Number of vectors that are scanned between checks for a match
+const size_t LINEAR_SEARCH_UNROLL = 4;
+
+/*
+    HasVectorFind
+    -------------
+    Whether a range can be scanned with vector comparisons (or memchr): it
+    must be contiguous, and hold integers (but not bools) or floating point
+    numbers.
+*/
+
+template <typename It, typename Value = typename std::iterator_traits<It>::value_type>
+struct HasVectorFind : std::integral_constant<bool,
+    (std::is_pointer<It>::value or
+     std::is_same<It, typename std::vector<Value>::iterator>::value or
+     std::is_same<It, typename std::vector<Value>::const_iterator>::value) and
+    ((std::is_integral<Value>::value and !std::is_same<Value, bool>::value) or
+     std::is_same<Value, float>::value or std::is_same<Value, double>::value)> {};
+
+#if LINEAR_SEARCH_SIMD
+/*
+    Avx2IntegerLanes, Avx2FindLanes
+    -------------------------------
+    Compare 32 bytes of keys with a value at once. Avx2IntegerLanes holds the
+    broadcast and comparison of integers of each size, and Avx2FindLanes the
+    search lanes of every key type, whose equal returns a mask with
+    bits_per_lane bits set for every key that is equal to the value.
+*/
+
+template <size_t Size>
+struct Avx2IntegerLanes;
+
+template <>
+struct Avx2IntegerLanes<1> {
+    static __m256i broadcast(const int8_t value) { return _mm256_set1_epi8(value); }
+    static __m256i equal(const __m256i a, const __m256i b) { return _mm256_cmpeq_epi8(a, b); }
+};
+
+template <>
+struct Avx2IntegerLanes<2> {
+    static __m256i broadcast(const int16_t value) { return _mm256_set1_epi16(value); }
+    static __m256i equal(const __m256i a, const __m256i b) { return _mm256_cmpeq_epi16(a, b); }
+};
+
+template <>
+struct Avx2IntegerLanes<4> {
+    static __m256i broadcast(const int32_t value) { return _mm256_set1_epi32(value); }
+    static __m256i equal(const __m256i a, const __m256i b) { return _mm256_cmpeq_epi32(a, b); }
+};
+
+template <>
+struct Avx2IntegerLanes<8> {
+    static __m256i broadcast(const int64_t value) { return _mm256_set1_epi64x(value); }
+    static __m256i equal(const __m256i a, const __m256i b) { return _mm256_cmpeq_epi64(a, b); }
+};
+
+template <typename T>
+struct Avx2FindLanes {
+    using Vector = __m256i;
+    using Integer = typename std::make_signed<T>::type;
+    static const size_t width = 32 / sizeof(T);
+    static const unsigned bits_per_lane = sizeof(T);
+
+    static Vector broadcast(const T value) {
+        return Avx2IntegerLanes<sizeof(T)>::broadcast(Integer(value));
+    }
+
+    static uint64_t equal(const T* keys, const Vector value) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys));
+        return uint32_t(_mm256_movemask_epi8(Avx2IntegerLanes<sizeof(T)>::equal(block, value)));
+    }
+};
+
+// Floating point numbers are compared as numbers, not bits: NaN equals
+// nothing, and -0.0 equals 0.0, as with ==
+template <>
+struct Avx2FindLanes<float> {
+    using Vector = __m256;
+    static const size_t width = 8;
+    static const unsigned bits_per_lane = 1;
+
+    static Vector broadcast(const float value) {
+        return _mm256_set1_ps(value);
+    }
+
+    static uint64_t equal(const float* keys, const Vector value) {
+        return uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(keys), value, _CMP_EQ_OQ)));
+    }
+};
+
+template <>
+struct Avx2FindLanes<double> {
+    using Vector = __m256d;
+    static const size_t width = 4;
+    static const unsigned bits_per_lane = 1;
+
+    static Vector broadcast(const double value) {
+        return _mm256_set1_pd(value);
+    }
+
+    static uint64_t equal(const double* keys, const Vector value) {
+        return uint32_t(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(keys), value, _CMP_EQ_OQ)));
+    }
+};
+
+#if defined(__AVX512F__)
+/*
+    Avx512FindLanes
+    ---------------
+    Compares 64 bytes of 32 or 64 bit keys with a value at once, into a mask
+    with a bit per key.
+*/
+
+template <typename T, size_t Size = sizeof(T), bool IsFloating = std::is_floating_point<T>::value>
+struct Avx512FindLanes;
+
+template <typename T>
+struct Avx512FindLanes<T, 4, false> {
+    using Vector = __m512i;
+    static const size_t width = 16;
+    static const unsigned bits_per_lane = 1;
+
+    static Vector broadcast(const T value) { return _mm512_set1_epi32(int32_t(value)); }
+
+    static uint64_t equal(const T* keys, const Vector value) {
+        return _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(keys), value);
+    }
+};
+
+template <typename T>
+struct Avx512FindLanes<T, 8, false> {
+    using Vector = __m512i;
+    static const size_t width = 8;
+    static const unsigned bits_per_lane = 1;
+
+    static Vector broadcast(const T value) { return _mm512_set1_epi64(int64_t(value)); }
+
+    static uint64_t equal(const T* keys, const Vector value) {
+        return _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(keys), value);
+    }
+};
+
+template <typename T>
+struct Avx512FindLanes<T, 4, true> {
+    using Vector = __m512;
+    static const size_t width = 16;
+    static const unsigned bits_per_lane = 1;
+
+    static Vector broadcast(const float value) { return _mm512_set1_ps(value); }
+
+    static uint64_t equal(const float* keys, const Vector value) {
+        return _mm512_cmp_ps_mask(_mm512_loadu_ps(keys), value, _CMP_EQ_OQ);
+    }
+};
+
+template <typename T>
+struct Avx512FindLanes<T, 8, true> {
+    using Vector = __m512d;
+    static const size_t width = 8;
+    static const unsigned bits_per_lane = 1;
+
+    static Vector broadcast(const double value) { return _mm512_set1_pd(value); }
+
+    static uint64_t equal(const double* keys, const Vector value) {
+        return _mm512_cmp_pd_mask(_mm512_loadu_pd(keys), value, _CMP_EQ_OQ);
+    }
+};
+
+// With AVX-512, keys of at least 32 bits are compared 64 bytes at a time
+template <typename T>
+using FindLanes = typename std::conditional<sizeof(T) >= 4, Avx512FindLanes<T>, Avx2FindLanes<T>>::type;
+#else
+template <typename T>
+using FindLanes = Avx2FindLanes<T>;
+#endif
+
+/*
+    find_in_vectors
+    ---------------
+    Returns the first key of [first, last) equal to value, or last, scanning
+    LINEAR_SEARCH_UNROLL vectors between checks for a match. The tail that
+    doesn't fill a vector is scanned one key at a time.
+*/
+
+template <typename Lanes, typename T>
+const T* find_in_vectors(const T* first, const T* last, const T value) {
+    const size_t width = Lanes::width;
+    const auto needle = Lanes::broadcast(value);
+
+    for (; size_t(last - first) >= LINEAR_SEARCH_UNROLL * width; first += LINEAR_SEARCH_UNROLL * width) {
+        uint64_t masks[LINEAR_SEARCH_UNROLL];
+        uint64_t any = 0;
+        for (size_t i = 0; i < LINEAR_SEARCH_UNROLL; i++) {
+            masks[i] = Lanes::equal(first + i * width, needle);
+            any |= masks[i];
+        }
+        if (any != 0) {
+            for (size_t i = 0; i < LINEAR_SEARCH_UNROLL; i++)
+                if (masks[i] != 0)
+                    return first + i * width + size_t(__builtin_ctzll(masks[i])) / Lanes::bits_per_lane;
+        }
+    }
+
+    for (; size_t(last - first) >= width; first += width) {
+        const uint64_t mask = Lanes::equal(first, needle);
+        if (mask != 0)
+            return first + size_t(__builtin_ctzll(mask)) / Lanes::bits_per_lane;
+    }
+
+    for (; first != last; ++first)
+        if (*first == value)
+            break;
+    return first;
+}
+
+
+/*
+    count_in_vectors
+    ----------------
+    Returns the number of keys of [first, last) equal to value.
+*/
+
+template <typename Lanes, typename T>
+size_t count_in_vectors(const T* first, const T* last, const T value) {
+    const size_t width = Lanes::width;
+    const auto needle = Lanes::broadcast(value);
+
+    size_t count = 0;
+    for (; size_t(last - first) >= width; first += width)
+        count += size_t(__builtin_popcountll(Lanes::equal(first, needle)));
+    count /= Lanes::bits_per_lane;
+
+    for (; first != last; ++first)
+        count += size_t(*first == value);
+    return count;
+}
+
+
+/*
+    find_any_in_vectors
+    -------------------
+    Returns the first key of [first, last) equal to any of the num_values
+    values, or last. Every vector of keys is compared with each value, and
+    the masks are combined.
+*/
+
+template <typename Lanes, typename T>
+const T* find_any_in_vectors(const T* first, const T* last, const T* values, const size_t num_values) {
+    const size_t width = Lanes::width;
+    typename Lanes::Vector needles[LINEAR_FIND_ANY_MAX_SIMD_VALUES];
+    for (size_t j = 0; j < num_values; j++)
+        needles[j] = Lanes::broadcast(values[j]);
+
+    for (; size_t(last - first) >= width; first += width) {
+        uint64_t mask = 0;
+        for (size_t j = 0; j < num_values; j++)
+            mask |= Lanes::equal(first, needles[j]);
+        if (mask != 0)
+            return first + size_t(__builtin_ctzll(mask)) / Lanes::bits_per_lane;
+    }
+
+    for (; first != last; ++first)
+        for (size_t j = 0; j < num_values; j++)
+            if (*first == values[j])
+                return first;
+    return first;
+}
+#endif
+
+/*
+    find_value
+    ----------
+    Returns the first key of [first, last) equal to value, or last: with
+    memchr for bytes, with vectors for larger numbers if there is SIMD, and
+    one key at a time otherwise.
+*/
+
+template <typename T>
+const T* find_value(const T* first, const T* last, const T value, std::true_type /* is byte */) {
+    const void* found = std::memchr(first, static_cast<unsigned char>(value), size_t(last - first));
+    return found != nullptr ? static_cast<const T*>(found) : last;
+}
+
+template <typename T>
+const T* find_value(const T* first, const T* last, const T value, std::false_type /* is byte */) {
+#if LINEAR_SEARCH_SIMD
+    return find_in_vectors<FindLanes<T>>(first, last, value);
+#else
+    // libstdc++ unrolls std::find, which is faster than a plain loop
+    return std::find(first, last, value);
+#endif
+}
+
+/*
+    in_key_range, holds_value
+    -------------------------
+    Whether value is within the range of Key, and whether keys of type Key
+    can hold value, i.e. whether value converts to Key and back unchanged.
+    Floating point values are compared with the range of Key in their own
+    type first, since converting a value out of range, like 1e100 to int, is
+    undefined.
+*/
+
+template <typename Key, typename T, typename IsIntegerKey>
+bool in_key_range(const T& /* value */, std::false_type /* is floating point value */, IsIntegerKey) {
+    return true;
+}
+
+template <typename Key, typename T>
+bool in_key_range(const T& value, std::true_type /* is floating point value */, std::true_type /* is integer key */) {
+    // The bounds are powers of two, which T holds exactly, unlike max()
+    using Limits = std::numeric_limits<Key>;
+    return value >= T(Limits::lowest()) and value < T(Limits::max() / 2 + 1) * 2;
+}
+
+template <typename Key, typename T>
+bool in_key_range(const T& value, std::true_type /* is floating point value */, std::false_type /* is integer key */) {
+    using Wider = typename std::common_type<T, Key>::type;
+    return std::isinf(value) or !(std::abs(Wider(value)) > Wider(std::numeric_limits<Key>::max()));
+}
+
+template <typename Key, typename T>
+bool holds_value(const T& value) {
+    // Compared in their common type explicitly, as == would, without the
+    // sign comparison warnings
+    using Common = typename std::common_type<Key, T>::type;
+    return in_key_range<Key>(value, std::is_floating_point<T>(), std::is_integral<Key>()) and
+           Common(Key(value)) == Common(value);
+}
+
+
+/*
+    linear_find
+    -----------
+    Returns the first position in the range [first, last) whose element is
+    equal to value, or last if there is none, like std::find.
+
+    A value that the elements cannot hold, like 300 among bytes, is equal to
+    none of them. Otherwise it is converted to the type of the elements,
+    which compares equal to the same elements.
+*/
+
+template <typename InputIt, typename T>
+InputIt linear_find(InputIt first, InputIt last, const T& value, std::false_type /* has vector find */) {
+    for (; first != last; ++first)
+        if (*first == value)
+            break;
+    return first;
+}
+
+template <typename RandomIt, typename T>
+RandomIt linear_find(RandomIt first, RandomIt last, const T& value, std::true_type /* has vector find */) {
+    using Key = typename std::iterator_traits<RandomIt>::value_type;
+    if (first == last or !holds_value<Key>(value))
+        return last;
+    const Key key = Key(value);
+
+    const Key* keys = &*first;
+    const Key* found = find_value(keys, keys + (last - first), key, std::integral_constant<bool, sizeof(Key) == 1>());
+    return first + (found - keys);
+}
+
+template <typename InputIt, typename T>
+InputIt linear_find(InputIt first, InputIt last, const T& value) {
+    return linear_find(first, last, value, HasVectorFind<InputIt>());
+}
+
+
+/*
+    linear_count
+    ------------
+    Returns the number of elements of the range [first, last) equal to
+    value, like std::count.
+*/
+
+template <typename InputIt, typename T>
+size_t linear_count(InputIt first, InputIt last, const T& value, std::false_type /* has vector find */) {
+    size_t count = 0;
+    for (; first != last; ++first)
+        count += size_t(*first == value);
+    return count;
+}
+
+template <typename RandomIt, typename T>
+size_t linear_count(RandomIt first, RandomIt last, const T& value, std::true_type /* has vector find */) {
+    using Key = typename std::iterator_traits<RandomIt>::value_type;
+    if (first == last or !holds_value<Key>(value))
+        return 0;
+    const Key key = Key(value);
+
+#if LINEAR_SEARCH_SIMD
+    const Key* keys = &*first;
+    return count_in_vectors<FindLanes<Key>>(keys, keys + (last - first), key);
+#else
+    return linear_count(first, last, key, std::false_type());
+#endif
+}
+
+template <typename InputIt, typename T>
+size_t linear_count(InputIt first, InputIt last, const T& value) {
+    return linear_count(first, last, value, HasVectorFind<InputIt>());
+}
+
+
+/*
+    linear_find_any
+    ---------------
+    Returns the first position in the range [first, last) whose element is
+    equal to any of the values of [values_first, values_last), or last if
+    there is none, like std::find_first_of. With SIMD, up to
+    LINEAR_FIND_ANY_MAX_SIMD_VALUES values are compared with every vector of
+    elements.
+*/
+
+template <typename InputIt, typename ForwardIt>
+InputIt linear_find_any(InputIt first, InputIt last, ForwardIt values_first, ForwardIt values_last,
+                        std::false_type /* has vector find */) {
+    for (; first != last; ++first)
+        for (ForwardIt value = values_first; value != values_last; ++value)
+            if (*first == *value)
+                return first;
+    return first;
+}
+
+template <typename RandomIt, typename ForwardIt>
+RandomIt linear_find_any(RandomIt first, RandomIt last, ForwardIt values_first, ForwardIt values_last,
+                         std::true_type /* has vector find */) {
+#if LINEAR_SEARCH_SIMD
+    using Key = typename std::iterator_traits<RandomIt>::value_type;
+
+    // Values that no element can be equal to are dropped
+    Key keys_of_values[LINEAR_FIND_ANY_MAX_SIMD_VALUES];
+    size_t num_values = 0;
+    for (ForwardIt value = values_first; value != values_last; ++value) {
+        if (!holds_value<Key>(*value))
+            continue;
+        if (num_values == LINEAR_FIND_ANY_MAX_SIMD_VALUES)
+            return linear_find_any(first, last, values_first, values_last, std::false_type());
+        keys_of_values[num_values++] = Key(*value);
+    }
+    if (first == last or num_values == 0)
+        return last;
+
+    const Key* keys = &*first;
+    const Key* found = find_any_in_vectors<FindLanes<Key>>(keys, keys + (last - first), keys_of_values, num_values);
+    return first + (found - keys);
+#else
+    return linear_find_any(first, last, values_first, values_last, std::false_type());
+#endif
+}
+
+template <typename InputIt, typename ForwardIt>
+InputIt linear_find_any(InputIt first, InputIt last, ForwardIt values_first, ForwardIt values_last) {
+    return linear_find_any(first, last, values_first, values_last, HasVectorFind<InputIt>());
+}
+
+
 /*
     linear_search
     -------------
@@ -27,9 +511,9 @@
 
 template <typename T>
 int linear_search(const T& element, const std::vector<T>& values) {
-    for (size_t i = 0; i < values.size(); i++)
-        if (values[i] == element)   // it's a match!
-            return i;       // return the index at which it was found
+    const auto found = linear_find(values.begin(), values.end(), element);
+    if (found != values.end())   // it's a match!
+        return int(found - values.begin());     // return the index at which it was found
 
     return -1;  // no match is found
 }
@@ -0,0 +1,356 @@
+/*
+    American flag sort
+    ------------------
+    An in-place most significant digit radix sort. The elements are counted
+    by their first byte, and then permuted into their buckets by cycle-leader
+    swaps: the element at the head of a bucket is swapped into the bucket it
+    belongs to, until an element that belongs to the current bucket is found.
+    Every swap puts at least one element in its final bucket. Then every
+    bucket is sorted by the next byte: the largest one in a loop, and the
+    others recursively, so that keys with long common prefixes don't deepen
+    the recursion. Small buckets are insertion sorted.
+
+    Unlike LSD radix sort, it needs no buffer, so it can sort arrays that
+    barely fit in memory. Keys are extracted by a callback, and may be
+    integers, floating point numbers, strings, or tuples (and pairs) of them,
+    which are sorted lexicographically: a bucket whose elements share the
+    whole first component continues with the second one, and so on.
+
+    Time complexity
+    ---------------
+    O(N * W), where N is the number of elements and W the length of the keys
+    in bytes. Recursion stops as soon as buckets get small, so usually only
+    the first few bytes are looked at.
+
+    Space complexity
+    ----------------
+    O(log(N)) stack frames per key component, with a small histogram each,
+    as the recursion only enters buckets smaller than the largest one.
+*/
+
+#ifndef AMERICAN_FLAG_SORT_HPP
+#define AMERICAN_FLAG_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "insertion_sort.hpp"
+#include "radix_sort.hpp"
+#include "utils.hpp"
+
+using std::vector;
+
+// Buckets of at most this many elements are insertion sorted
+const long AMERICAN_FLAG_SORT_INSERTION_THRESHOLD = 32;
+
+/*
+    MsdDigits
+    ---------
+    Splits a key component into byte digits, from the most significant one:
+      - integers and floating point numbers are split into sizeof(T) digits
+        of their RadixTraits encoding, so they sort like in radix_sort
+      - strings have a digit 0 after their end, which sorts before any
+        character (digit c + 1), so prefixes come first
+    is_last tells whether all keys in a bucket share the whole component.
+*/
+template <typename T, typename Enable = void>
+struct MsdDigits {
+    using Bits = typename RadixTraits<T>::Bits;
+    static const size_t num_buckets = 256;
+
+    static size_t digit(const T& key, const size_t depth) {
+        const size_t shift = (sizeof(Bits) - 1 - depth) * 8;
+        return (RadixTraits<T>::encode(key) >> shift) & 0xFF;
+    }
+
+    static bool is_last(size_t /* digit */, const size_t depth) {
+        return depth + 1 == sizeof(Bits);
+    }
+
+    static bool less(const T& a, const T& b) {
+        return RadixTraits<T>::encode(a) < RadixTraits<T>::encode(b);
+    }
+};
+
+template <>
+struct MsdDigits<std::string> {
+    static const size_t num_buckets = 257;
+
+    static size_t digit(const std::string& key, const size_t depth) {
+        return depth < key.size() ? size_t((unsigned char) key[depth]) + 1 : 0;
+    }
+
+    static bool is_last(const size_t digit, size_t /* depth */) {
+        return digit == 0;
+    }
+
+    static bool less(const std::string& a, const std::string& b) {
+        return a < b;       // characters compare as unsigned char
+    }
+};
+
+/*
+    MsdKeyComponents
+    ----------------
+    Gives access to the components of a key: tuples and pairs have one per
+    element (which may be references, as created by std::tie), other keys
+    are a single component.
+*/
+template <typename Key>
+struct MsdKeyComponents {
+    static const size_t size = 1;
+
+    template <size_t Index>
+    using Type = Key;
+
+    template <size_t Index>
+    static const Key& get(const Key& key) {
+        return key;
+    }
+};
+
+template <typename... Types>
+struct MsdKeyComponents<std::tuple<Types...>> {
+    static const size_t size = sizeof...(Types);
+
+    template <size_t Index>
+    using Type = typename std::decay<typename std::tuple_element<Index, std::tuple<Types...>>::type>::type;
+
+    template <size_t Index>
+    static const Type<Index>& get(const std::tuple<Types...>& key) {
+        return std::get<Index>(key);
+    }
+};
+
+template <typename First, typename Second>
+struct MsdKeyComponents<std::pair<First, Second>> {
+    static const size_t size = 2;
+
+    template <size_t Index>
+    using Type = typename std::decay<typename std::tuple_element<Index, std::pair<First, Second>>::type>::type;
+
+    template <size_t Index>
+    static const Type<Index>& get(const std::pair<First, Second>& key) {
+        return std::get<Index>(key);
+    }
+};
+
+/*
+    AmericanFlagSorter
+    ------------------
+    Sorts ranges by the keys that key_of extracts from their elements, one
+    key component at a time.
+*/
+
+template <typename RandomIt, typename KeyOf>
+class AmericanFlagSorter {
+    using Key = typename std::decay<decltype(std::declval<KeyOf&>()(*std::declval<RandomIt>()))>::type;
+    using Components = MsdKeyComponents<Key>;
+
+    template <size_t Index>
+    using InRange = std::integral_constant<bool, (Index < Components::size)>;
+
+    KeyOf key_of;
+    bool descending;
+
+    template <size_t Index>
+    void sort_component(RandomIt first, RandomIt last, size_t depth, std::true_type);
+    template <size_t Index>
+    void sort_component(RandomIt, RandomIt, size_t, std::false_type) {}
+
+    template <size_t Index>
+    bool key_less(const Key& a, const Key& b, std::true_type) const;
+    template <size_t Index>
+    bool key_less(const Key&, const Key&, std::false_type) const { return false; }
+
+    public:
+        AmericanFlagSorter(KeyOf key_of, bool descending);
+
+        void sort(RandomIt first, RandomIt last);
+};
+
+
+/*
+    Constructor
+    -----------
+*/
+
+template <typename RandomIt, typename KeyOf>
+AmericanFlagSorter<RandomIt, KeyOf>::AmericanFlagSorter(KeyOf key_of, bool descending)
+    : key_of(key_of), descending(descending) {}
+
+
+/*
+    sort
+    ----
+    Sorts [first, last), starting with the most significant byte of the
+    first key component.
+*/
+
+template <typename RandomIt, typename KeyOf>
+void AmericanFlagSorter<RandomIt, KeyOf>::sort(RandomIt first, RandomIt last) {
+    sort_component<0>(first, last, 0, InRange<0>());
+}
+
+
+/*
+    sort_component
+    --------------
+    Sorts [first, last), whose keys all share the components before Index and
+    the first depth digits of component Index.
+*/
+
+template <typename RandomIt, typename KeyOf>
+template <size_t Index>
+void AmericanFlagSorter<RandomIt, KeyOf>::sort_component(RandomIt first, RandomIt last,
+                                                         size_t depth, std::true_type) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    using Digits = MsdDigits<typename Components::template Type<Index>>;
+    const size_t num_buckets = Digits::num_buckets;
+
+    // Buckets are numbered in the order they are output
+    auto bucket_of = [&](const Key& key) {
+        const size_t digit = Digits::digit(Components::template get<Index>(key), depth);
+        return descending ? num_buckets - 1 - digit : digit;
+    };
+    auto is_last = [&](const size_t bucket) {
+        return Digits::is_last(descending ? num_buckets - 1 - bucket : bucket, depth);
+    };
+
+    size_t heads[num_buckets];
+    size_t tails[num_buckets];
+    while (true) {
+        const long size = last - first;
+        if (size <= AMERICAN_FLAG_SORT_INSERTION_THRESHOLD) {
+            insertion_sort(first, last, [&](const Value& a, const Value& b) {
+                return descending ? key_less<Index>(key_of(b), key_of(a), InRange<Index>())
+                                  : key_less<Index>(key_of(a), key_of(b), InRange<Index>());
+            });
+            return;
+        }
+
+        std::fill(heads, heads + num_buckets, 0);
+        for (RandomIt it = first; it != last; ++it)
+            heads[bucket_of(key_of(*it))]++;
+
+        // If all keys share this digit, move on to the next one
+        const size_t first_bucket = bucket_of(key_of(*first));
+        if (heads[first_bucket] == size_t(size)) {
+            if (is_last(first_bucket)) {
+                sort_component<Index + 1>(first, last, 0, InRange<Index + 1>());
+                return;
+            }
+            depth++;
+            continue;
+        }
+
+        // Turn the counts into the bounds of each bucket
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+            tails[bucket] = offset + heads[bucket];
+            heads[bucket] = offset;
+            offset = tails[bucket];
+        }
+
+        // Swap every element into its bucket, filling the buckets in order
+        for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+            while (heads[bucket] < tails[bucket]) {
+                const size_t target = bucket_of(key_of(first[heads[bucket]]));
+                if (target == bucket)
+                    heads[bucket]++;
+                else
+                    std::swap(first[heads[bucket]], first[heads[target]++]);
+            }
+        }
+
+        // heads[bucket] is now the end of the bucket. Every bucket but the
+        // largest is sorted recursively, and the largest by the next iteration
+        auto bucket_begin = [&](const size_t bucket) {
+            return bucket == 0 ? 0 : heads[bucket - 1];
+        };
+        size_t largest = 0;
+        for (size_t bucket = 1; bucket < num_buckets; bucket++)
+            if (heads[bucket] - bucket_begin(bucket) > heads[largest] - bucket_begin(largest))
+                largest = bucket;
+
+        for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+            const size_t begin = bucket_begin(bucket);
+            const size_t end = heads[bucket];
+            if (end - begin > 1 and bucket != largest) {
+                if (is_last(bucket))
+                    sort_component<Index + 1>(first + begin, first + end, 0, InRange<Index + 1>());
+                else
+                    sort_component<Index>(first + begin, first + end, depth + 1, InRange<Index>());
+            }
+        }
+
+        const RandomIt largest_first = first + bucket_begin(largest);
+        const RandomIt largest_last = first + heads[largest];
+        if (is_last(largest)) {
+            sort_component<Index + 1>(largest_first, largest_last, 0, InRange<Index + 1>());
+            return;
+        }
+        first = largest_first;
+        last = largest_last;
+        depth++;
+    }
+}
+
+
+/*
+    key_less
+    --------
+    Compares keys by their components from Index on, in the order of their
+    digits.
+*/
+
+template <typename RandomIt, typename KeyOf>
+template <size_t Index>
+bool AmericanFlagSorter<RandomIt, KeyOf>::key_less(const Key& a, const Key& b, std::true_type) const {
+    using Digits = MsdDigits<typename Components::template Type<Index>>;
+    const auto& component_a = Components::template get<Index>(a);
+    const auto& component_b = Components::template get<Index>(b);
+
+    if (Digits::less(component_a, component_b))
+        return true;
+    if (Digits::less(component_b, component_a))
+        return false;
+    return key_less<Index + 1>(a, b, InRange<Index + 1>());
+}
+
+
+/*
+    american_flag_sort
+    ------------------
+    Sorts the range [first, last) in place by the keys that key_of extracts
+    from its elements (by default the elements themselves), in ascending
+    order, or in descending order if order is -1. The sort is not stable.
+    To avoid copying string keys, key_of should return references, e.g.
+        [](const Person& p) -> const std::string& { return p.name; }
+        [](const Person& p) { return std::tie(p.last_name, p.age); }
+*/
+template <typename RandomIt, typename KeyOf = RadixIdentity>
+void american_flag_sort(RandomIt first, RandomIt last, KeyOf key_of = KeyOf(), const int order = 1) {
+    AmericanFlagSorter<RandomIt, KeyOf> sorter(key_of, order == -1);
+    sorter.sort(first, last);
+}
+
+/*
+    american_flag_sort
+    ------------------
+    Wrapper function. Only the sorted values are shown, as the permutation
+    steps are not meaningful states on their own.
+*/
+void american_flag_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    american_flag_sort(values.begin(), values.end(), RadixIdentity(), order);
+
+    if (to_show_state)
+        display_state(values);
+}
+
+#endif // AMERICAN_FLAG_SORT_HPP
@@ -17,25 +17,33 @@
 #ifndef BUBBLE_SORT_HPP
 #define BUBBLE_SORT_HPP
 
+#include <functional>
 #include <vector>
 #include "utils.hpp"
 
 using std::vector;
 
-void bubble_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
-    bool swapped;
-    size_t i, j;
-
-    for (i = 0; i < values.size() - 1; i++) {
-        swapped = false;
-        for (j = 0; i + j < values.size() - 1; j++) {
-            // 'order' is -1 for descending, so the inequality is reversed:
-            if (order * values[j] > order * values[j+1]) {
-                swap(values[j], values[j+1]);
+/*
+    bubble_sort
+    -----------
+    Sorts the range [first, last) according to comp, a strict weak ordering.
+    show_state is called after every swap.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void bubble_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                 StepCallback show_state = StepCallback()) {
+    if (last - first < 2)
+        return;
+
+    // after each pass, the largest remaining element has sunk to 'end'
+    for (RandomIt end = last - 1; end != first; --end) {
+        bool swapped = false;
+        for (RandomIt it = first; it != end; ++it) {
+            if (comp(*(it + 1), *it)) {
+                std::iter_swap(it, it + 1);
                 swapped = true;
-
-                if (to_show_state)
-                    display_state(values);
+                show_state();
             }
         }
         if (!swapped)
@@ -43,4 +51,11 @@ void bubble_sort(vector<int>& values, const int order = 1, const bool to_show_st
     }
 }
 
+// Wrapper function
+void bubble_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        bubble_sort(values.begin(), values.end(), comp, show_state);
+    });
+}
+
 #endif // BUBBLE_SORT_HPP
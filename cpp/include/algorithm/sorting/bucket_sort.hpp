@@ -1,18 +1,22 @@
 /*
     Bucket sort
     ----------------------
-    Bucket sort, or bin sort, is an integer sorting algorithm that works by
-    distributing the elements of an array into a number of buckets. Each 
-    is then sorted individually using a different sorting algorithm. 
-    Insertion sort is used in this implementation, but other sorting 
-    algorithms can be used, too.
+    Bucket sort, or bin sort, is a sorting algorithm that works by
+    distributing the elements of an array into a number of buckets, each
+    covering an equal part of the range of the keys. Each is then sorted
+    individually using a different sorting algorithm.
+
+    The buckets are laid out in one contiguous array: their sizes are counted
+    first, and every element is then moved straight to its place in its
+    bucket. Small buckets are insertion sorted, and larger ones (when the keys
+    are not evenly distributed) tim sorted, so the sort is stable.
 
     This is a linear sorting algorithm for evenly distributed items.
 
     Time complexity
     ---------------
-    O(N ^ 2) worst case
-    O(N + N^2 / k + k) average case when k is the number of buckets, 
+    O(N * log(N)) worst case
+    O(N + N^2 / k + k) average case when k is the number of buckets,
     which is O(n) if K ~ N
 
     Space complexity
@@ -23,85 +27,208 @@
 #ifndef BUCKET_SORT_HPP
 #define BUCKET_SORT_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <list>
-#include "utils.hpp"
 #include "insertion_sort.hpp"
+#include "radix_sort.hpp"
+#include "sorting_network.hpp"
+#include "tim_sort.hpp"
+#include "utils.hpp"
 
 using std::vector;
-using std::list;
 
-void bucket_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+// Average number of elements per bucket
+const size_t BUCKET_SORT_BUCKET_SIZE = 4;
 
-    if (values.empty()) {
-        return;
+// Buckets of at most this many elements are insertion sorted, larger ones tim sorted
+const long BUCKET_SORT_INSERTION_THRESHOLD = 16;
+
+/*
+    BucketIndex
+    -----------
+    Maps keys in [min_key, max_key] to num_buckets buckets of equal width,
+    keeping their order. Integers are mapped exactly, using their unsigned
+    distance from min_key (see RadixTraits), so that even 64 bit keys don't
+    lose precision.
+*/
+template <typename Key, typename Enable = void>
+struct BucketIndex {
+    using Bits = typename RadixTraits<Key>::Bits;
+
+    Bits min_bits;
+    uint64_t width;
+
+    BucketIndex(const Key min_key, const Key max_key, const size_t num_buckets)
+        : min_bits(RadixTraits<Key>::encode(min_key)),
+          width(uint64_t(Bits(RadixTraits<Key>::encode(max_key) - min_bits)) / num_buckets + 1) {}
+
+    bool is_valid() const {
+        return true;
     }
 
-    auto max_value = values[0], min_value = values[0];
-    int negative_count = 0, positive_count = 0;
+    size_t operator()(const Key key) const {
+        return size_t(uint64_t(Bits(RadixTraits<Key>::encode(key) - min_bits)) / width);
+    }
+};
 
-    for (int i : values) {
-        max_value = std::max(max_value, i);
-        min_value = std::min(min_value, i);
-        negative_count += i < 0;
-        positive_count += i >= 0;
+/*
+    BucketIndex
+    -----------
+    Floating point keys are mapped in their own precision. Halving the keys
+    keeps their differences from overflowing. The mapping is invalid if the
+    range is so small that its reciprocal overflows.
+*/
+template <typename Key>
+struct BucketIndex<Key, typename std::enable_if<std::is_floating_point<Key>::value>::type> {
+    Key half_min;
+    Key scale;
+    size_t last_bucket;
+
+    BucketIndex(const Key min_key, const Key max_key, const size_t num_buckets)
+        : half_min(min_key / 2), scale(Key(num_buckets) / (max_key / 2 - min_key / 2)),
+          last_bucket(num_buckets - 1) {}
+
+    bool is_valid() const {
+        return std::isfinite(scale);
     }
 
-    // The number of negative buckets will be the number of negative elements
-    vector<list<int>> negative_buckets(negative_count);
+    size_t operator()(const Key key) const {
+        const Key position = (key / 2 - half_min) * scale;
+        return position < Key(last_bucket) ? size_t(position) : last_bucket;
+    }
+};
 
-    // The number of positive buckets will be the number of positive elements
-    vector<list<int>> positive_buckets(positive_count);
+/*
+    sort_bucket
+    -----------
+    Sorts one bucket stably with the kernel suited to its size: small buckets
+    with insertion sort, or a sorting network if there is one for them.
+*/
+template <typename RandomIt, typename Compare>
+void sort_bucket(RandomIt first, RandomIt last, Compare comp) {
+    if (last - first <= BUCKET_SORT_INSERTION_THRESHOLD)
+        small_sort(first, last, comp);
+    else
+        tim_sort(first, last, comp);
+}
 
-    // Insert the items into their appropriate bucket
-    for (float i : values) {
-        if (i > 0) {
-            // As the bucket index grows, elements get larger
-            float bucket_index = (positive_buckets.size() * i / max_value) - 1; 
-            positive_buckets[static_cast<int>(bucket_index)].push_back(i);
+/*
+    sort_buckets
+    ------------
+    Sorts the buckets starting at buckets, where ends[i] is the end of
+    bucket i. Elements that are their own keys are compared with std::less
+    or std::greater, rather than comp, so that small_sort can sort buckets
+    of 32 bit integers with a sorting network.
+*/
+template <typename Value, typename Compare>
+void sort_buckets(Value* buckets, const vector<size_t>& ends, Compare comp, int /* order */,
+                  std::false_type /* identity keys */) {
+    size_t begin = 0;
+    for (const size_t end : ends) {
+        if (end - begin > 1)
+            sort_bucket(buckets + begin, buckets + end, comp);
+        begin = end;
+    }
+}
 
-        } else if (i < 0) {
-            // As the bucket index grows, elements get smaller
-            float bucket_index = (negative_buckets.size() * i / min_value) - 1; 
-            negative_buckets[static_cast<int>(bucket_index)].push_back(i);
+template <typename Value, typename Compare>
+void sort_buckets(Value* buckets, const vector<size_t>& ends, Compare /* comp */, const int order,
+                  std::true_type /* identity keys */) {
+    if (order == -1)
+        sort_buckets(buckets, ends, std::greater<Value>(), order, std::false_type());
+    else
+        sort_buckets(buckets, ends, std::less<Value>(), order, std::false_type());
+}
+
+/*
+    bucket_sort
+    -----------
+    Stably sorts the range [first, last) by the arithmetic keys that key_of
+    extracts from its elements (by default the elements themselves), in
+    ascending order, or in descending order if order is -1. Floating point
+    keys must not be NaN. Elements must be default constructible, for the
+    buckets.
+*/
+template <typename RandomIt, typename KeyOf = RadixIdentity>
+void bucket_sort(RandomIt first, RandomIt last, KeyOf key_of = KeyOf(), const int order = 1) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    using Key = typename std::decay<decltype(key_of(*first))>::type;
+    static_assert(std::is_arithmetic<Key>::value, "bucket sort needs arithmetic keys");
+
+    const size_t size = last - first;
+    if (size < 2)
+        return;
 
-        } else {
-            // Special case for 0
-            positive_buckets[0].push_back(i);
-        }
+    Key min_key = key_of(*first);
+    Key max_key = min_key;
+    for (RandomIt it = first + 1; it != last; ++it) {
+        const Key key = key_of(*it);
+        if (key < min_key)
+            min_key = key;
+        else if (key > max_key)
+            max_key = key;
+    }
+    if (!(min_key < max_key))
+        return;
+
+    auto comp = [&](const Value& a, const Value& b) {
+        return order == -1 ? key_of(b) < key_of(a) : key_of(a) < key_of(b);
     };
 
-    values.clear();
-    
-    auto sort_buckets_and_unify = [&](auto it_start, auto it_end) {
-        for_each(it_start, it_end,[&](auto bucket) {
-            
-            // Sort each bucket individually using internal file insertion_sort.hpp
-            // Note that other sorting algorithms can also be used
-            vector<int> sorted(bucket.size());
-            sorted.assign(begin(bucket), end(bucket));
-            insertion_sort(sorted, order, false);
-
-            // Insert the sorted bucket result into the original values vector
-            values.insert(end(values), begin(sorted), end(sorted));
-
-            if (to_show_state) {
-                display_state(values);
-            }
-        });
+    const size_t num_buckets = std::max<size_t>(2, size / BUCKET_SORT_BUCKET_SIZE);
+    const BucketIndex<Key> bucket_index(min_key, max_key, num_buckets);
+    if (!bucket_index.is_valid()) {
+        sort_bucket(first, last, comp);
+        return;
+    }
+
+    // Buckets are numbered in the order they are output
+    auto bucket_of = [&](const Value& value) {
+        const size_t bucket = bucket_index(key_of(value));
+        return order == -1 ? num_buckets - 1 - bucket : bucket;
     };
 
-    if (order == 1) {
-        // 1 means ascending, so we should start from the smallest negative
-        // element and end with the largest positive element
-        sort_buckets_and_unify(rbegin(negative_buckets), rend(negative_buckets));
-        sort_buckets_and_unify(begin(positive_buckets), end(positive_buckets));
-    } else {
-        // -1 means descending, so we should start from the largest positive
-        // element and end with the smallest negative element
-        sort_buckets_and_unify(rbegin(positive_buckets), rend(positive_buckets));
-        sort_buckets_and_unify(begin(negative_buckets), end(negative_buckets));
+    // Count the bucket sizes, and turn them into the bucket starts
+    vector<size_t> starts(num_buckets, 0);
+    for (RandomIt it = first; it != last; ++it)
+        starts[bucket_of(*it)]++;
+
+    size_t offset = 0;
+    for (size_t& start : starts) {
+        const size_t bucket_size = start;
+        start = offset;
+        offset += bucket_size;
     }
+
+    // Insert the items into their appropriate bucket, after which starts[i]
+    // is the end of bucket i
+    std::unique_ptr<Value[]> buckets(new Value[size]);
+    for (RandomIt it = first; it != last; ++it)
+        buckets[starts[bucket_of(*it)]++] = std::move(*it);
+
+    sort_buckets(buckets.get(), starts, comp, order, std::is_same<KeyOf, RadixIdentity>());
+
+    std::move(buckets.get(), buckets.get() + size, first);
+}
+
+/*
+    bucket_sort
+    -----------
+    Wrapper function. Only the sorted values are shown.
+*/
+void bucket_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    bucket_sort(values.begin(), values.end(), RadixIdentity(), order);
+
+    if (to_show_state)
+        display_state(values);
 }
 
 #endif // BUCKET_SORT_HPP
@@ -14,11 +14,17 @@
 	O(1)
 */
 
-#include <iostream>
+#ifndef COMB_SORT_HPP
+#define COMB_SORT_HPP
+
+#include <cmath>
+#include <functional>
 #include <vector>
 
 #include "./utils.hpp"
 
+using std::vector;
+
 unsigned int get_next_gap(unsigned int gap) {
     double shrink_factor = 1.3; // approximation of optimal factor
     gap = floor(gap / shrink_factor);
@@ -30,22 +36,39 @@ unsigned int get_next_gap(unsigned int gap) {
     return gap;
 }
 
-void comb_sort (vector<int>& input, const int order = 1, const bool to_show_state = false) {
-    unsigned int gap = input.size();
+/*
+	comb_sort
+	---------
+	Sorts the range [first, last) according to comp. show_state is called after
+	every comparison.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void comb_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+               StepCallback show_state = StepCallback()) {
+    const size_t size = last - first;
+    unsigned int gap = size;
     bool swapped = true;
 
     // Continue while gap is larger than one or there was a swap on previous iteration
     while (gap > 1 || swapped) {
         gap = get_next_gap(gap);
         swapped = false;
-        for (int i = 0; i + gap < input.size(); i++) {
-            if (order * input[i] > order * input[i+gap]) {
-                swap(input[i], input[i+gap]);
+        for (size_t i = 0; i + gap < size; i++) {
+            if (comp(first[i + gap], first[i])) {
+                std::iter_swap(first + i, first + i + gap);
                 swapped = true;
             }
-            if (to_show_state) {
-                display_state(input);
-            }
+            show_state();
         }
     }
 }
+
+// Wrapper function
+void comb_sort(vector<int>& input, const int order = 1, const bool to_show_state = false) {
+    sort_in_order(input, order, to_show_state, [&](auto comp, auto show_state) {
+        comb_sort(input.begin(), input.end(), comp, show_state);
+    });
+}
+
+#endif // COMB_SORT_HPP
@@ -5,79 +5,306 @@
     that have each distinct key value, and using arithmetic on those counts to
     determine the positions of each key value in the output sequence.
 
+    The counts take memory proportional to the range of the keys, so a single
+    outlier could make it allocate gigabytes. If the range is large compared
+    to the number of elements, the elements are radix sorted instead. For
+    small inputs, the counters are only as wide as needed to count all the
+    elements (8, 16 or 32 bits), so that more of them fit in the cache.
+
+    counting_sort_by_key sorts keys and values kept in separate arrays, and
+    counting_argsort returns the sorting permutation.
+
     Time complexity
     ---------------
     O(N + R), where N is the number of elements and R is the range of input.
 
     Space complexity
     ----------------
-    O(N + K), where N is the number of elements and K the size of the frequency array.
+    O(N + R), for the output buffer and the frequency array. Integers sorted
+    by themselves need no buffer: the sorted values are rewritten from the
+    frequencies.
 */
 
 #ifndef COUNTING_SORT_HPP
 #define COUNTING_SORT_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#include "radix_sort.hpp"
 #include "utils.hpp"
 
 using std::vector;
 
-void counting_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
-    int min_value = values[0];
-    int max_value = values[0];
-
-    // Find minimum and maximum values in input vector
-    for (int value: values) {
-        if (value < min_value) {
-            min_value = value;
-        }
-        else if (value > max_value) {
-            max_value = value;
-        }
+// Key ranges below this many values are always counted
+const size_t COUNTING_SORT_MIN_RANGE = 1 << 16;
+
+// Larger key ranges are counted only if they are at most this many times the
+// number of elements; otherwise, the elements are radix sorted
+const size_t COUNTING_SORT_RANGE_FACTOR = 4;
+
+/*
+    count_keys
+    ----------
+    Returns the frequency of every key index in [first, last), where index_of
+    maps the elements to [0, num_keys).
+*/
+template <typename Counter, typename RandomIt, typename IndexOf>
+vector<Counter> count_keys(RandomIt first, RandomIt last, const size_t num_keys, IndexOf index_of) {
+    vector<Counter> freq(num_keys, 0);
+    for (; first != last; ++first)
+        ++freq[index_of(*first)];
+    return freq;
+}
+
+/*
+    counting_sort_by_index
+    ----------------------
+    Stably sorts [first, last) by the key indices that index_of maps the
+    elements to, moving them through a buffer.
+*/
+template <typename Counter, typename RandomIt, typename IndexOf, typename Key>
+void counting_sort_by_index(RandomIt first, RandomIt last, const size_t num_keys, IndexOf index_of,
+                            Key /* lowest */, int /* order */, std::false_type /* rewrite values */) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    vector<Counter> freq = count_keys<Counter>(first, last, num_keys, index_of);
+
+    // freq[i] will now be the number of elements with lower key indices
+    Counter offset = 0;
+    for (Counter& count : freq) {
+        const Counter key_count = count;
+        count = offset;
+        offset = Counter(offset + key_count);
+    }
+
+    // Place elements in sorted order, iterating forwards to maintain stability
+    const size_t size = last - first;
+    std::unique_ptr<Value[]> sorted(new Value[size]);
+    for (RandomIt it = first; it != last; ++it)
+        sorted[freq[index_of(*it)]++] = std::move(*it);
+
+    std::move(sorted.get(), sorted.get() + size, first);
+}
+
+/*
+    counting_sort_by_index
+    ----------------------
+    Sorts integers [first, last) by themselves, where index_of maps the values
+    to [0, num_keys) and first_value is the value of index 0: the values are
+    rewritten in order (descending if order is -1), as often as they occur.
+*/
+template <typename Counter, typename RandomIt, typename IndexOf, typename Key>
+void counting_sort_by_index(RandomIt first, RandomIt last, const size_t num_keys, IndexOf index_of,
+                            Key first_value, const int order, std::true_type /* rewrite values */) {
+    const vector<Counter> freq = count_keys<Counter>(first, last, num_keys, index_of);
+
+    Key value = first_value;
+    for (size_t index = 0; index < num_keys; index++) {
+        first = std::fill_n(first, freq[index], value);
+        if (index + 1 < num_keys)
+            value = order == -1 ? Key(value - 1) : Key(value + 1);
     }
+}
+
+/*
+    counting_sort_with_counters
+    ---------------------------
+    Counting sorts [first, last) whose keys lie in [min_key, max_key], with
+    counters of type Counter, which must be able to hold the number of
+    elements.
+*/
+template <typename Counter, typename RandomIt, typename KeyOf, typename Key>
+void counting_sort_with_counters(RandomIt first, RandomIt last, KeyOf key_of, const int order,
+                                 const Key min_key, const Key max_key) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    using Traits = RadixTraits<Key>;
+    using RewriteValues = std::integral_constant<bool, std::is_same<KeyOf, RadixIdentity>::value
+                                                       and std::is_integral<Value>::value>;
+
+    // Key indices are offsets of the keys from the first key in sorted order
+    const auto min_bits = Traits::encode(min_key);
+    const auto max_bits = Traits::encode(max_key);
+    const size_t num_keys = size_t(max_bits - min_bits) + 1;
+    auto index_of = [&](const Value& value) {
+        const auto bits = Traits::encode(key_of(value));
+        return size_t(order == -1 ? max_bits - bits : bits - min_bits);
+    };
+
+    counting_sort_by_index<Counter>(first, last, num_keys, index_of,
+                                    order == -1 ? max_key : min_key, order, RewriteValues());
+}
 
-    // Calculate unique values in input vector
-    const int unique_values = max_value - min_value + 1;
+/*
+    counting_sort
+    -------------
+    Stably sorts the range [first, last) by the integer keys that key_of
+    extracts from its elements (by default the elements themselves), in
+    ascending order, or in descending order if order is -1. Keys spread over
+    a range much larger than the number of elements are radix sorted
+    instead. Elements must be default constructible, for the buffer.
+*/
+template <typename RandomIt, typename KeyOf = RadixIdentity>
+void counting_sort(RandomIt first, RandomIt last, KeyOf key_of = KeyOf(), const int order = 1) {
+    using Key = typename std::decay<decltype(key_of(*first))>::type;
+    static_assert(std::is_integral<Key>::value, "counting sort needs integer keys");
+
+    const size_t size = last - first;
+    if (size < 2)
+        return;
+
+    // Find minimum and maximum keys
+    Key min_key = key_of(*first);
+    Key max_key = min_key;
+    for (RandomIt it = first + 1; it != last; ++it) {
+        const Key key = key_of(*it);
+        if (key < min_key)
+            min_key = key;
+        else if (key > max_key)
+            max_key = key;
+    }
 
-    // Calculate frequencies of each unique value in input vector
-    // freq[0] is number of min_value occurrences and so on
-    vector<int> freq(unique_values, 0);
-    for (int value: values) {
-        ++freq[value - min_value];
+    // Compared as unsigned, since the range may not fit in Key
+    const size_t range = size_t(RadixTraits<Key>::encode(max_key) - RadixTraits<Key>::encode(min_key));
+    if (range >= std::max(COUNTING_SORT_MIN_RANGE, COUNTING_SORT_RANGE_FACTOR * size)) {
+        radix_sort(first, last, key_of, order);
+        return;
     }
 
-    // Start and end indices, for calculating cumulative frequency
-    long start = 1;
-    long end = freq.size();
+    if (size <= std::numeric_limits<uint8_t>::max())
+        counting_sort_with_counters<uint8_t>(first, last, key_of, order, min_key, max_key);
+    else if (size <= std::numeric_limits<uint16_t>::max())
+        counting_sort_with_counters<uint16_t>(first, last, key_of, order, min_key, max_key);
+    else if (size <= std::numeric_limits<uint32_t>::max())
+        counting_sort_with_counters<uint32_t>(first, last, key_of, order, min_key, max_key);
+    else
+        counting_sort_with_counters<size_t>(first, last, key_of, order, min_key, max_key);
+}
 
-    // If order is reversed, the indices are reversed too
-    if (order == -1) {      // 'order' is -1 for descending, 1 for ascending
-        start = freq.size() - 2;
-        end = -1;
+/*
+    counting_sort_by_key_with_counters
+    ----------------------------------
+    Counting sorts the integer keys [keys_first, keys_last), which lie in
+    [min_key, max_key], and the values starting at values_first along with
+    them, with counters of type Counter. Only the values are moved, through a
+    buffer; the keys are rewritten from their frequencies.
+*/
+template <typename Counter, typename KeyIt, typename ValueIt, typename Key>
+void counting_sort_by_key_with_counters(KeyIt keys_first, KeyIt keys_last, ValueIt values_first,
+                                        const int order, const Key min_key, const Key max_key) {
+    using Value = typename std::iterator_traits<ValueIt>::value_type;
+    using Traits = RadixTraits<Key>;
+
+    const auto min_bits = Traits::encode(min_key);
+    const auto max_bits = Traits::encode(max_key);
+    const size_t num_keys = size_t(max_bits - min_bits) + 1;
+    auto index_of = [&](const Key key) {
+        const auto bits = Traits::encode(key);
+        return size_t(order == -1 ? max_bits - bits : bits - min_bits);
+    };
+
+    const vector<Counter> freq = count_keys<Counter>(keys_first, keys_last, num_keys, index_of);
+    vector<Counter> starts(num_keys);
+    Counter offset = 0;
+    for (size_t index = 0; index < num_keys; index++) {
+        starts[index] = offset;
+        offset = Counter(offset + freq[index]);
     }
 
-    // Calculate cumulative frequency:
-    // freq[i] will now be the number of elements in the sorted array that are
-    // less than or equal to value[i]
-    for (long i = start; i != end; i += order) {
-        freq[i] += freq[i - order];
+    // Place the values in sorted order, iterating forwards to maintain stability
+    const size_t size = keys_last - keys_first;
+    std::unique_ptr<Value[]> sorted(new Value[size]);
+    ValueIt value = values_first;
+    for (KeyIt key = keys_first; key != keys_last; ++key, ++value)
+        sorted[starts[index_of(*key)]++] = std::move(*value);
+    std::move(sorted.get(), sorted.get() + size, values_first);
+
+    Key key = order == -1 ? max_key : min_key;
+    for (size_t index = 0; index < num_keys; index++) {
+        keys_first = std::fill_n(keys_first, freq[index], key);
+        if (index + 1 < num_keys)
+            key = order == -1 ? Key(key - 1) : Key(key + 1);
     }
+}
+
+/*
+    counting_sort_by_key
+    --------------------
+    Stably sorts the integer keys [keys_first, keys_last) in ascending order,
+    or in descending order if order is -1, and applies the same permutation
+    to the values starting at values_first, which stay in their own array.
+    Keys spread over a range much larger than their number are radix sorted
+    instead. Values must be default constructible, for the buffer.
+*/
+template <typename KeyIt, typename ValueIt>
+void counting_sort_by_key(KeyIt keys_first, KeyIt keys_last, ValueIt values_first, const int order = 1) {
+    using Key = typename std::iterator_traits<KeyIt>::value_type;
+    static_assert(std::is_integral<Key>::value, "counting sort needs integer keys");
 
-    // Place values in sorted order by iterating input vector in reversed order,
-    // to maintain sorting stability
-    vector<int> sorted(values.size());
-    int value;
-    for (auto iter = values.rbegin(); iter != values.rend(); ++iter) {
-        value = *iter;
-        sorted[freq[value - min_value] - 1] = value;
-        --freq[value - min_value];
-
-        if (to_show_state) {
-            display_state(sorted);
-        }
+    const size_t size = keys_last - keys_first;
+    if (size < 2)
+        return;
+
+    const auto bounds = std::minmax_element(keys_first, keys_last);
+    const Key min_key = *bounds.first;
+    const Key max_key = *bounds.second;
+
+    const size_t range = size_t(RadixTraits<Key>::encode(max_key) - RadixTraits<Key>::encode(min_key));
+    if (range >= std::max(COUNTING_SORT_MIN_RANGE, COUNTING_SORT_RANGE_FACTOR * size)) {
+        radix_sort_by_key(keys_first, keys_last, values_first, order);
+        return;
     }
 
-    values.assign(sorted.begin(), sorted.end());
+    if (size <= std::numeric_limits<uint8_t>::max())
+        counting_sort_by_key_with_counters<uint8_t>(keys_first, keys_last, values_first, order, min_key, max_key);
+    else if (size <= std::numeric_limits<uint16_t>::max())
+        counting_sort_by_key_with_counters<uint16_t>(keys_first, keys_last, values_first, order, min_key, max_key);
+    else if (size <= std::numeric_limits<uint32_t>::max())
+        counting_sort_by_key_with_counters<uint32_t>(keys_first, keys_last, values_first, order, min_key, max_key);
+    else
+        counting_sort_by_key_with_counters<size_t>(keys_first, keys_last, values_first, order, min_key, max_key);
+}
+
+/*
+    counting_argsort
+    ----------------
+    Returns the permutation that stably sorts the range [first, last) by the
+    integer keys that key_of extracts from its elements. The range is not
+    modified.
+*/
+template <typename RandomIt, typename KeyOf = RadixIdentity>
+vector<size_t> counting_argsort(RandomIt first, RandomIt last, KeyOf key_of = KeyOf(), const int order = 1) {
+    using Key = typename std::decay<decltype(key_of(*first))>::type;
+
+    vector<Key> keys;
+    keys.reserve(last - first);
+    for (RandomIt it = first; it != last; ++it)
+        keys.push_back(key_of(*it));
+
+    vector<size_t> indices(keys.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    counting_sort_by_key(keys.begin(), keys.end(), indices.begin(), order);
+    return indices;
+}
+
+/*
+    counting_sort
+    -------------
+    Wrapper function. The values are rewritten from the frequencies in one
+    go, so only the sorted values are shown.
+*/
+void counting_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    counting_sort(values.begin(), values.end(), RadixIdentity(), order);
+
+    if (to_show_state)
+        display_state(values);
 }
 
 #endif // COUNTING_SORT_HPP
@@ -0,0 +1,685 @@
+/*
+    External sort
+    -------------
+    Sorts files of fixed-size records that don't fit in memory, with an
+    external merge sort in two phases:
+      1. run generation: the input is read a memory budget at a time, and
+         each of these runs is merge sorted and spilled to disk
+      2. merging: the runs are merged in one pass by a loser tree (see
+         k_way_merge.hpp), reading each run and writing the output in large
+         blocks. If there are too many runs to merge at once, for the
+         blocks to stay large, groups of them are merged into longer runs
+         first.
+
+    All runs are stored in one temporary file, so that the number of open
+    files stays the same however large the input is.
+
+    The file operations run on a background thread, overlapping with the
+    sorting and merging: while one run is sorted, the next one is read and
+    the previous one is written, and during merges, every run reads its next
+    block while its current one is being merged, and the output is written
+    a block behind. That way, the sort is bound by the bandwidth of the disk.
+
+    Records are read and written as raw bytes, so they must be trivially
+    copyable, and default constructible, for the buffers. The sort is stable.
+
+    Time complexity
+    ---------------
+    O(N * log(N)) comparisons, and O(N * log_F(N / M)) record transfers,
+    where N is the number of records, M the number of records that fit in
+    memory and F the number of runs merged at once. Two passes over the data
+    suffice for N up to F * M.
+
+    Space complexity
+    ----------------
+    O(M) memory, and O(N) disk space for the runs.
+*/
+
+#ifndef EXTERNAL_SORT_HPP
+#define EXTERNAL_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if !defined(_WIN32)
+#include <sys/types.h>
+#endif
+#include "k_way_merge.hpp"
+#include "merge_sort.hpp"
+#include "utils.hpp"
+#include "work_stealing_pool.hpp"
+
+using std::vector;
+
+// Memory used by default for runs and buffers: 256 MiB
+const size_t EXTERNAL_SORT_MEMORY_BYTES = size_t(256) << 20;
+
+// Largest block read from or written to a file at once
+const size_t EXTERNAL_SORT_BLOCK_BYTES = size_t(4) << 20;
+
+// Most runs merged at once, which keeps the blocks read from them large
+const size_t EXTERNAL_SORT_MAX_FAN_IN = 128;
+
+/*
+    make_temp_file
+    --------------
+    Creates a temporary file, which is deleted once closed, or throws
+    std::runtime_error.
+*/
+FileHandle make_temp_file() {
+    FileHandle file(std::tmpfile());
+    if (!file)
+        throw std::runtime_error("external sort: cannot create a temporary file");
+    return file;
+}
+
+/*
+    read_records
+    ------------
+    Reads up to count records from file into records, and returns the number
+    of records read, which is less than count only at the end of the file.
+*/
+template <typename Record>
+size_t read_records(std::FILE* file, Record* records, const size_t count) {
+    const size_t num_read = std::fread(records, sizeof(Record), count, file);
+    if (num_read < count and std::ferror(file))
+        throw std::runtime_error("external sort: read failed");
+    return num_read;
+}
+
+/*
+    write_records
+    -------------
+    Writes count records to file. records may be null if count is 0.
+*/
+template <typename Record>
+void write_records(std::FILE* file, const Record* records, const size_t count) {
+    if (count > 0 and std::fwrite(records, sizeof(Record), count, file) != count)
+        throw std::runtime_error("external sort: write failed");
+}
+
+/*
+    seek_record
+    -----------
+    Moves the position of file to its record at index. fseek takes a long,
+    which is 32 bits on some targets, so the offset is passed as a 64 bit
+    file offset where the platform has one, and offsets that still don't fit
+    throw rather than seek to the wrong record.
+*/
+template <typename Record>
+void seek_record(std::FILE* file, const size_t index) {
+#if defined(_WIN32)
+    using FileOffset = __int64;
+#else
+    using FileOffset = off_t;
+#endif
+
+    if (std::uintmax_t(index) > std::uintmax_t(std::numeric_limits<FileOffset>::max()) / sizeof(Record))
+        throw std::runtime_error("external sort: file offset out of range");
+    const FileOffset offset = FileOffset(index) * FileOffset(sizeof(Record));
+
+#if defined(_WIN32)
+    const int result = _fseeki64(file, offset, SEEK_SET);
+#else
+    const int result = fseeko(file, offset, SEEK_SET);
+#endif
+    if (result != 0)
+        throw std::runtime_error("external sort: seek failed");
+}
+
+/*
+    BackgroundIo
+    ------------
+    Runs one file operation at a time on a pool, and rethrows its error, if
+    any, once it is waited for. Operations still running are waited for when
+    it is destroyed, so they never outlive the buffers they use.
+*/
+
+class BackgroundIo {
+    TaskGroup group;
+    std::exception_ptr error;
+
+    public:
+        explicit BackgroundIo(WorkStealingPool& pool);
+        ~BackgroundIo();
+
+        template <typename F>
+        void run(F operation);
+        void wait();
+};
+
+
+/*
+    Constructor
+    -----------
+*/
+
+BackgroundIo::BackgroundIo(WorkStealingPool& pool) : group(pool) {}
+
+
+/*
+    Destructor
+    ----------
+    Waits for the operation in progress. Its error, if any, is dropped.
+*/
+
+BackgroundIo::~BackgroundIo() {
+    group.wait();
+}
+
+
+/*
+    run
+    ---
+    Starts an operation. The previous one must have been waited for.
+*/
+
+template <typename F>
+void BackgroundIo::run(F operation) {
+    group.run([this, operation]() {
+        try {
+            operation();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+    });
+}
+
+
+/*
+    wait
+    ----
+    Returns once the operation in progress has finished, or rethrows its
+    error.
+*/
+
+void BackgroundIo::wait() {
+    group.wait();
+    if (error) {
+        std::exception_ptr failed = error;
+        error = nullptr;
+        std::rethrow_exception(failed);
+    }
+}
+
+
+/*
+    RunReader
+    ---------
+    Reads the records of a run, stored in a file along with other runs, a
+    block at a time, while the next block is read in the background. Readers
+    of the same file share a mutex, as each seeks to its own run. Iterator
+    is an input iterator over the records left, which compares equal to
+    Iterator() at the end.
+*/
+
+template <typename Record>
+class RunReader {
+    std::FILE* file;
+    std::mutex& file_mutex;
+    size_t next_record;         // in the file
+    size_t num_unread;
+    vector<Record> block;
+    vector<Record> next_block;
+    size_t position;
+    size_t size;
+    size_t next_size;
+    bool prefetching;
+    BackgroundIo prefetch;
+
+    size_t read_block(vector<Record>& records);
+    void read_next_block();
+
+    public:
+        class Iterator {
+            RunReader* reader;
+
+            public:
+                explicit Iterator(RunReader* reader = nullptr) : reader(reader) {}
+
+                const Record& operator*() const { return reader->front(); }
+                Iterator& operator++() { reader->pop(); return *this; }
+
+                bool operator==(const Iterator& other) const {
+                    const bool at_end = !reader or reader->empty();
+                    const bool other_at_end = !other.reader or other.reader->empty();
+                    return at_end == other_at_end and (at_end or reader == other.reader);
+                }
+                bool operator!=(const Iterator& other) const { return !(*this == other); }
+        };
+
+        RunReader(std::FILE* file, std::mutex& file_mutex, size_t first, size_t size,
+                  size_t block_size, WorkStealingPool& io_pool);
+
+        bool empty() const;
+        const Record& front() const;
+        void pop();
+        Iterator begin();
+};
+
+
+/*
+    Constructor
+    -----------
+    Reads the first block of the size records of file starting at record
+    first, and starts reading the second one.
+*/
+
+template <typename Record>
+RunReader<Record>::RunReader(std::FILE* file, std::mutex& file_mutex, const size_t first, const size_t size,
+                             const size_t block_size, WorkStealingPool& io_pool)
+    : file(file), file_mutex(file_mutex), next_record(first), num_unread(size),
+      block(block_size), next_block(block_size), position(0), size(0), next_size(0), prefetching(false),
+      prefetch(io_pool) {
+    this->size = read_block(block);
+    read_next_block();
+}
+
+
+/*
+    read_block
+    ----------
+    Reads the next block of the run into records, and returns its size.
+*/
+
+template <typename Record>
+size_t RunReader<Record>::read_block(vector<Record>& records) {
+    const size_t count = std::min(records.size(), num_unread);
+    if (count == 0)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(file_mutex);
+    seek_record<Record>(file, next_record);
+    if (read_records(file, records.data(), count) != count)
+        throw std::runtime_error("external sort: run is truncated");
+
+    next_record += count;
+    num_unread -= count;
+    return count;
+}
+
+
+/*
+    read_next_block
+    ---------------
+    Starts reading the block after the current one, if there is one. No
+    block may be being read.
+*/
+
+template <typename Record>
+void RunReader<Record>::read_next_block() {
+    prefetching = num_unread > 0;
+    if (prefetching)
+        prefetch.run([this]() { next_size = read_block(next_block); });
+}
+
+
+/*
+    empty
+    -----
+    Whether all records of the run have been read.
+*/
+
+template <typename Record>
+bool RunReader<Record>::empty() const {
+    return position == size;
+}
+
+
+/*
+    front
+    -----
+    Returns the next record of the run, which must not be empty.
+*/
+
+template <typename Record>
+const Record& RunReader<Record>::front() const {
+    return block[position];
+}
+
+
+/*
+    pop
+    ---
+    Moves on to the next record. At the end of a block, the block read in
+    the background takes its place, and the one after it is started.
+*/
+
+template <typename Record>
+void RunReader<Record>::pop() {
+    if (++position < size or !prefetching)
+        return;
+
+    prefetch.wait();
+    std::swap(block, next_block);
+    size = next_size;
+    position = 0;
+    read_next_block();
+}
+
+
+/*
+    begin
+    -----
+    Returns an iterator to the next record of the run.
+*/
+
+template <typename Record>
+typename RunReader<Record>::Iterator RunReader<Record>::begin() {
+    return Iterator(this);
+}
+
+
+/*
+    RunWriter
+    ---------
+    Writes records to a file a block at a time, while the next block is
+    being filled.
+*/
+
+template <typename Record>
+class RunWriter {
+    std::FILE* file;
+    vector<Record> block;
+    vector<Record> written_block;
+    size_t size;
+    BackgroundIo writes;
+
+    void write_block();
+
+    public:
+        RunWriter(std::FILE* file, size_t block_size, WorkStealingPool& io_pool);
+
+        void push(const Record& record);
+        void flush();
+};
+
+
+/*
+    Constructor
+    -----------
+*/
+
+template <typename Record>
+RunWriter<Record>::RunWriter(std::FILE* file, const size_t block_size, WorkStealingPool& io_pool)
+    : file(file), block(block_size), written_block(block_size), size(0), writes(io_pool) {}
+
+
+/*
+    push
+    ----
+    Appends a record, and starts writing the block once it is full.
+*/
+
+template <typename Record>
+void RunWriter<Record>::push(const Record& record) {
+    block[size++] = record;
+    if (size == block.size())
+        write_block();
+}
+
+
+/*
+    write_block
+    -----------
+    Starts writing the current block, once the previous one is written.
+*/
+
+template <typename Record>
+void RunWriter<Record>::write_block() {
+    writes.wait();
+    std::swap(block, written_block);
+
+    const size_t num_records = size;
+    writes.run([this, num_records]() {
+        write_records(file, written_block.data(), num_records);
+    });
+    size = 0;
+}
+
+
+/*
+    flush
+    -----
+    Writes all records pushed so far, and returns once they are written.
+*/
+
+template <typename Record>
+void RunWriter<Record>::flush() {
+    write_block();
+    writes.wait();
+}
+
+
+/*
+    ExternalSorter
+    --------------
+    Sorts records from a source into a file, in memory_bytes of memory. The
+    source is called as read(records, count), and returns the number of
+    records it stored in records, which is less than count only at its end.
+*/
+
+template <typename Record, typename Compare>
+class ExternalSorter {
+    static_assert(std::is_trivially_copyable<Record>::value, "records must be trivially copyable");
+
+    // A sorted run of size records of run_file, starting at record first
+    struct Run {
+        size_t first;
+        size_t size;
+    };
+
+    Compare comp;
+    size_t memory_bytes;
+    WorkStealingPool io_pool;
+    FileHandle run_file;
+    vector<Run> runs;
+
+    template <typename Source>
+    void generate_runs(Source& read, std::FILE* output);
+    void merge_runs(size_t first, size_t last, std::FILE* output);
+
+    public:
+        ExternalSorter(Compare comp, size_t memory_bytes);
+
+        template <typename Source>
+        void sort(Source read, std::FILE* output);
+};
+
+
+/*
+    Constructor
+    -----------
+    Starts the thread that reads and writes files in the background.
+*/
+
+template <typename Record, typename Compare>
+ExternalSorter<Record, Compare>::ExternalSorter(Compare comp, const size_t memory_bytes)
+    : comp(comp), memory_bytes(memory_bytes), io_pool(1) {}
+
+
+/*
+    sort
+    ----
+    Sorts the records of read into output, which must be open for writing.
+*/
+
+template <typename Record, typename Compare>
+template <typename Source>
+void ExternalSorter<Record, Compare>::sort(Source read, std::FILE* output) {
+    generate_runs(read, output);
+
+    // Merge groups of runs into longer ones, until they can all be merged at once
+    while (runs.size() > EXTERNAL_SORT_MAX_FAN_IN) {
+        FileHandle merged_file = make_temp_file();
+        vector<Run> merged_runs;
+        size_t merged_size = 0;
+        for (size_t first = 0; first < runs.size(); first += EXTERNAL_SORT_MAX_FAN_IN) {
+            const size_t last = std::min(first + EXTERNAL_SORT_MAX_FAN_IN, runs.size());
+            merge_runs(first, last, merged_file.get());
+
+            const size_t size = runs[last - 1].first + runs[last - 1].size - runs[first].first;
+            merged_runs.push_back(Run{merged_size, size});
+            merged_size += size;
+        }
+        run_file = std::move(merged_file);
+        runs = std::move(merged_runs);
+    }
+
+    if (!runs.empty())
+        merge_runs(0, runs.size(), output);
+    runs.clear();
+    run_file.reset();
+
+    if (std::fflush(output) != 0)
+        throw std::runtime_error("external sort: write failed");
+}
+
+
+/*
+    generate_runs
+    -------------
+    Splits the records of read into sorted runs, written one after another to
+    a temporary file. Four buffers rotate: one is read into and one written out in the
+    background, while one is merge sorted using the last one. If all records
+    fit in one run, it is written to output directly.
+*/
+
+template <typename Record, typename Compare>
+template <typename Source>
+void ExternalSorter<Record, Compare>::generate_runs(Source& read, std::FILE* output) {
+    const size_t run_size = std::max<size_t>(1, memory_bytes / sizeof(Record) / 4);
+    vector<Record> reading(run_size);
+    vector<Record> sorting(run_size);
+    vector<Record> scratch(run_size);
+    vector<Record> writing(run_size);
+
+    size_t num_sorting = read(sorting.data(), run_size);
+    size_t num_read = 0;
+    size_t num_writing = 0;
+
+    BackgroundIo reads(io_pool);
+    BackgroundIo writes(io_pool);
+    while (num_sorting > 0) {
+        reads.run([&]() { num_read = read(reading.data(), run_size); });
+        merge_sort_with_buffer(sorting.begin(), sorting.begin() + num_sorting, scratch.begin(), comp);
+        reads.wait();
+        writes.wait();
+
+        std::FILE* file = output;
+        if (!runs.empty() or num_read > 0) {
+            if (!run_file)
+                run_file = make_temp_file();
+            file = run_file.get();
+            runs.push_back(Run{runs.empty() ? 0 : runs.back().first + runs.back().size, num_sorting});
+        }
+
+        std::swap(writing, sorting);
+        num_writing = num_sorting;
+        writes.run([&, file]() { write_records(file, writing.data(), num_writing); });
+
+        std::swap(sorting, reading);
+        num_sorting = num_read;
+    }
+    writes.wait();
+}
+
+
+/*
+    merge_runs
+    ----------
+    Merges runs[first, last) into output, at its current position. Every
+    run and the output get two blocks (one in use, one read or written in
+    the background) of an equal share of the memory.
+*/
+
+template <typename Record, typename Compare>
+void ExternalSorter<Record, Compare>::merge_runs(const size_t first, const size_t last, std::FILE* output) {
+    using Iterator = typename RunReader<Record>::Iterator;
+
+    const size_t num_blocks = 2 * (last - first + 1);
+    const size_t block_size = std::max<size_t>(1, std::min(memory_bytes / num_blocks,
+                                                           EXTERNAL_SORT_BLOCK_BYTES) / sizeof(Record));
+
+    std::mutex run_file_mutex;
+    vector<std::unique_ptr<RunReader<Record>>> readers;
+    vector<std::pair<Iterator, Iterator>> ranges;
+    for (size_t run = first; run < last; run++) {
+        readers.emplace_back(new RunReader<Record>(run_file.get(), run_file_mutex, runs[run].first,
+                                                   runs[run].size, block_size, io_pool));
+        ranges.emplace_back(readers.back()->begin(), Iterator());
+    }
+
+    RunWriter<Record> writer(output, block_size, io_pool);
+    LoserTree<Iterator, Compare> tree(ranges.begin(), ranges.end(), comp);
+    while (!tree.empty()) {
+        writer.push(*tree.top());
+        tree.pop();
+    }
+    writer.flush();
+}
+
+
+/*
+    external_sort
+    -------------
+    Stably sorts the records of type Record in the file input, from its
+    current position to its end, into the file output, according to comp,
+    using about memory_bytes of memory. Both files must be open in binary
+    mode, and must be different files.
+*/
+template <typename Record, typename Compare = std::less<>>
+void external_sort(std::FILE* input, std::FILE* output, Compare comp = Compare(),
+                   const size_t memory_bytes = EXTERNAL_SORT_MEMORY_BYTES) {
+    ExternalSorter<Record, Compare> sorter(comp, memory_bytes);
+    sorter.sort([input](Record* records, const size_t count) {
+        return read_records(input, records, count);
+    }, output);
+}
+
+/*
+    external_sort
+    -------------
+    Stably sorts the records of type Record in the file at input_path into
+    a new file at output_path, which must be a different file.
+*/
+template <typename Record, typename Compare = std::less<>>
+void external_sort(const std::string& input_path, const std::string& output_path,
+                   Compare comp = Compare(), const size_t memory_bytes = EXTERNAL_SORT_MEMORY_BYTES) {
+    FileHandle input = open_values_file(input_path, "rb");
+    FileHandle output = open_values_file(output_path, "wb");
+    external_sort<Record>(input.get(), output.get(), comp, memory_bytes);
+}
+
+/*
+    external_sort
+    -------------
+    Stably sorts the records [first, last) in memory, e.g. a file mapped with
+    mmap, into the file output, without modifying them. Only memory_bytes of
+    them are copied at a time, so the pages already sorted can be evicted.
+*/
+template <typename Record, typename Compare = std::less<>>
+void external_sort(const Record* first, const Record* last, std::FILE* output,
+                   Compare comp = Compare(), const size_t memory_bytes = EXTERNAL_SORT_MEMORY_BYTES) {
+    ExternalSorter<Record, Compare> sorter(comp, memory_bytes);
+    sorter.sort([&first, last](Record* records, const size_t count) {
+        const size_t num_read = std::min<size_t>(count, last - first);
+        std::copy(first, first + num_read, records);
+        first += num_read;
+        return num_read;
+    }, output);
+}
+
+#endif // EXTERNAL_SORT_HPP
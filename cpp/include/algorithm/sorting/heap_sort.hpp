@@ -3,6 +3,8 @@
     ---------
     A comparison-based sorting algorithm that uses an array-implemented heap to
     sort a list of integers.
+    dary_heap_sort uses a heap with 4 (or Arity) children per node instead,
+    which is shallower and faster on ranges larger than the cache.
 
     Time complexity
     ---------------
@@ -16,6 +18,12 @@
 #ifndef HEAP_SORT_HPP
 #define HEAP_SORT_HPP
 
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
 #include <vector>
 #include "utils.hpp"
 
@@ -24,24 +32,240 @@ using std::vector;
 /*
     heapify
     -------
-    Creates a max heap from a vector of integers.
+    Sifts the element at index parent down the heap stored in [first, first + last],
+    so that no element comes before its children according to comp (i.e. a max
+    heap for std::less).
 */
-void heapify(vector<int>& heap, int parent, const int last) {
-    int child = parent*2 + 1;
+template <typename RandomIt, typename Distance, typename Compare>
+void heapify(RandomIt first, Distance parent, const Distance last, Compare comp) {
+    Distance child = parent*2 + 1;
     while (child <= last) {    // travel down the children
-        if (child + 1 <= last and heap[child + 1] > heap[child]) {
+        if (child + 1 <= last and comp(first[child], first[child + 1])) {
             child++;    // child is now the larger of its siblings
         }
 
-        if (heap[parent] < heap[child]) {
-            swap(heap[parent], heap[child]);    // if the parent is smaller, swap it with its child
+        if (!comp(first[parent], first[child])) {
+            break;      // the parent is already in place
         }
+        std::iter_swap(first + parent, first + child);    // if the parent is smaller, swap it with its child
 
         parent = child;
         child = parent*2 + 1;
     }
 }
 
+/*
+    build_heap
+    ----------
+    Makes an ordered heap out of [first, last) by heapifying from the highest
+    indexed non-leaf node to the top node (*first).
+*/
+template <typename RandomIt, typename Compare, typename StepCallback>
+void build_heap(RandomIt first, RandomIt last, Compare comp, StepCallback show_state) {
+    using Distance = typename std::iterator_traits<RandomIt>::difference_type;
+    const Distance size = last - first;
+
+    for (Distance curr_node = size/2 - 1; curr_node >= 0; curr_node--) {
+        heapify(first, curr_node, size - 1, comp);    // last element = heap size - 1
+        show_state();
+    }
+}
+
+/*
+    drain_heap
+    ----------
+    Repeatedly moves the top of the heap [first, last) behind the shrinking heap
+    and calls heapify to restore it, which leaves the range sorted.
+*/
+template <typename RandomIt, typename Compare, typename StepCallback>
+void drain_heap(RandomIt first, RandomIt last, Compare comp, StepCallback show_state) {
+    using Distance = typename std::iterator_traits<RandomIt>::difference_type;
+
+    for (Distance last_index = (last - first) - 1; last_index > 0; ) {
+        std::iter_swap(first, first + last_index);
+        last_index--;
+        heapify(first, Distance(0), last_index, comp);
+        show_state();
+    }
+}
+
+/*
+    heap_sort
+    ---------
+    Sorts the range [first, last) according to comp by building a heap and
+    draining it. show_state is called after every heapify.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void heap_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+               StepCallback show_state = StepCallback()) {
+    build_heap(first, last, comp, show_state);
+    drain_heap(first, last, comp, show_state);
+}
+
+// Number of children of every node in the heaps of dary_heap_sort. With 4
+// children, the children of a node, and for 32 bit keys also all its
+// grandchildren, are at most two cache lines apart.
+const unsigned HEAP_SORT_ARITY = 4;
+
+// Nodes whose children are this many nodes ahead of the current one have
+// them prefetched while the heap is built
+const long HEAP_SORT_PREFETCH_DISTANCE = 16;
+
+/*
+    prefetch_element
+    ----------------
+    Hints the processor to load the cache line that holds *it.
+*/
+template <typename RandomIt>
+void prefetch_element(RandomIt it) {
+#if defined(__GNUC__)
+    __builtin_prefetch(std::addressof(*it));
+#else
+    (void)it;
+#endif
+}
+
+/*
+    LastInBlock
+    -----------
+    find returns the index of the element that comes last according to comp
+    among the Size elements starting at first[block], or of the first such
+    element if several are equal. The elements are compared in a tournament,
+    and every match picks its winner with arithmetic instead of a branch,
+    since the outcomes are random.
+*/
+template <unsigned Size>
+struct LastInBlock {
+    template <typename RandomIt, typename Distance, typename Compare>
+    static Distance find(RandomIt first, const Distance block, Compare comp) {
+        const Distance left = LastInBlock<Size / 2>::find(first, block, comp);
+        const Distance right = LastInBlock<Size - Size / 2>::find(first, block + Distance(Size / 2), comp);
+        return left + (right - left) * Distance(comp(first[left], first[right]));
+    }
+};
+
+template <>
+struct LastInBlock<1> {
+    template <typename RandomIt, typename Distance, typename Compare>
+    static Distance find(RandomIt, const Distance block, Compare) {
+        return block;
+    }
+};
+
+/*
+    dary_sift_down
+    --------------
+    Puts value in the hole at index top of the Arity-ary heap [first, first +
+    size), using Floyd's bottom-up method: the hole is first moved down to a
+    leaf, always towards the child that comes last, which takes Arity - 1
+    comparisons per level and none against value. value is then sifted up
+    from the leaf, which usually ends after one or two levels, since most
+    elements of a heap are near its leaves. The grandchildren of the hole are
+    prefetched on the way down.
+
+    The root has the Arity - 1 children [1, Arity), and every other node n
+    the Arity children [Arity*n, Arity*n + Arity), so that the children of a
+    node, and also its grandchildren, fill blocks that are aligned like the
+    range. The parent of node n is n / Arity.
+*/
+template <unsigned Arity, typename RandomIt, typename Distance, typename Value, typename Compare>
+void dary_sift_down(RandomIt first, const Distance top, const Distance size, Value value, Compare comp) {
+    Distance hole = top;
+
+    if (hole == 0) {
+        if (size < 2) {
+            first[0] = std::move(value);
+            return;
+        }
+
+        Distance last_child = 1;
+        for (Distance other = 2; other < std::min(Distance(Arity), size); other++)
+            last_child = comp(first[last_child], first[other]) ? other : last_child;
+        first[0] = std::move(first[last_child]);
+        hole = last_child;
+    }
+
+    for (Distance child = Arity*hole; child < size; child = Arity*hole) {
+        const Distance grandchild = Arity*child;
+        if (grandchild < size) {
+            prefetch_element(first + grandchild);
+            prefetch_element(first + std::min(grandchild + Distance(Arity*Arity - 1), size - 1));
+        }
+
+        Distance last_child = child;
+        if (size - child >= Distance(Arity)) {
+            last_child = LastInBlock<Arity>::find(first, child, comp);
+        }
+        else {
+            for (Distance other = child + 1; other < size; other++)
+                last_child = comp(first[last_child], first[other]) ? other : last_child;
+        }
+
+        first[hole] = std::move(first[last_child]);
+        hole = last_child;
+    }
+
+    while (hole > top) {
+        const Distance parent = hole / Arity;
+        if (!comp(first[parent], value))
+            break;
+        first[hole] = std::move(first[parent]);
+        hole = parent;
+    }
+    first[hole] = std::move(value);
+}
+
+/*
+    dary_heap_sort
+    --------------
+    Sorts the range [first, last) according to comp, like heap_sort, with a
+    heap whose nodes have Arity children instead of two. The heap is half as
+    deep (for Arity 4), so popping an element moves it through fewer
+    levels, each of which is a cache miss once the heap is larger than the
+    cache. Sift-downs use Floyd's bottom-up method, which saves most of the
+    comparisons against the sifted element. show_state is called after the
+    heap has been built and after every element has been popped.
+*/
+template <unsigned Arity = HEAP_SORT_ARITY, typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void dary_heap_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                    StepCallback show_state = StepCallback()) {
+    using Distance = typename std::iterator_traits<RandomIt>::difference_type;
+    static_assert(Arity >= 2, "heap nodes need at least two children");
+
+    const Distance size = last - first;
+    if (size < 2)
+        return;
+
+    // Build the heap bottom up, prefetching the children of the nodes that
+    // are sifted down next
+    for (Distance node = (size - 1) / Arity; node >= 0; node--) {
+        if (node > HEAP_SORT_PREFETCH_DISTANCE)
+            prefetch_element(first + Arity*(node - HEAP_SORT_PREFETCH_DISTANCE));
+        dary_sift_down<Arity>(first, node, size, std::move(first[node]), comp);
+    }
+    show_state();
+
+    // Move the top behind the shrinking heap, and fill its hole with the
+    // element that was there
+    for (Distance heap_size = size - 1; heap_size > 0; heap_size--) {
+        auto value = std::move(first[heap_size]);
+        first[heap_size] = std::move(first[0]);
+        dary_sift_down<Arity>(first, Distance(0), heap_size, std::move(value), comp);
+        show_state();
+    }
+}
+
+/*
+    heapify
+    -------
+    Creates a max heap from a vector of integers.
+*/
+void heapify(vector<int>& heap, int parent, const int last) {
+    heapify(heap.begin(), parent, last, std::less<int>());
+}
+
 /*
     sort
     ----
@@ -50,18 +274,11 @@ void heapify(vector<int>& heap, int parent, const int last) {
 */
 void sort(vector<int> &heap, const int size, const bool to_show_state = false) {
     if (to_show_state) {
-        cout << "\nPerforming heap sort on the heap...\n";
+        std::fputs("\nPerforming heap sort on the heap...\n", stdout);
+        drain_heap(heap.begin(), heap.begin() + size, std::less<int>(), StateDisplay{heap});
     }
-
-    int last = size - 1;
-    while (last >= 0) {
-        swap(heap[0], heap[last]);
-        last--;
-        heapify(heap, 0, last);
-
-        if (to_show_state) {
-            display_state(heap);
-        }
+    else {
+        drain_heap(heap.begin(), heap.begin() + size, std::less<int>(), NoStateDisplay());
     }
 }
 
@@ -72,19 +289,13 @@ void sort(vector<int> &heap, const int size, const bool to_show_state = false) {
     to the top node (heap[0]).
 */
 void make_heap(vector<int>& heap, const int size, const bool to_show_state = false) {
-    if (to_show_state)
-        cout << "\nMaking initial heap...\n";
-
-    for (int curr_node = size/2 - 1; curr_node >= 0; curr_node--) {
-        heapify(heap, curr_node, size - 1);    //last_element = heap_size - 1
-
-        if (to_show_state) {
-            display_state(heap);
-        }
-    }
-
     if (to_show_state) {
-        cout << "Initial heap has been made.\n";
+        std::fputs("\nMaking initial heap...\n", stdout);
+        build_heap(heap.begin(), heap.begin() + size, std::less<int>(), StateDisplay{heap});
+        std::fputs("Initial heap has been made.\n", stdout);
+    }
+    else {
+        build_heap(heap.begin(), heap.begin() + size, std::less<int>(), NoStateDisplay());
     }
 }
 
@@ -94,14 +305,9 @@ void make_heap(vector<int>& heap, const int size, const bool to_show_state = fal
     Combines the sorting and heapifying functionality into one function
 */
 void heap_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
-    size_t size = values.size();
-    make_heap(values, size, to_show_state);
-    sort(values, size, to_show_state);
-
-    // Reverse for descending, if necessary
-    if (order == -1) {
-        reverse(values.begin(), values.end());
-    }
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        heap_sort(values.begin(), values.end(), comp, show_state);
+    });
 }
 
 #endif // HEAP_SORT_HPP
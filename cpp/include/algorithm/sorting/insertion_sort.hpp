@@ -16,6 +16,9 @@
 #ifndef INSERTION_SORT_HPP
 #define INSERTION_SORT_HPP
 
+#include <functional>
+#include <iterator>
+#include <utility>
 #include <vector>
 #include "utils.hpp"
 
@@ -25,26 +28,64 @@ using std::vector;
     Insertion sort
     --------------
     Builds a sorted list by finding elements based on their value and placing them in the sorted list.
+    The range [first, last) is sorted stably according to comp, and show_state
+    is called after each element has been inserted.
 */
-void insertion_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
-    size_t i, j;
-    int currentValue;
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void insertion_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                    StepCallback show_state = StepCallback()) {
+    if (first == last)
+        return;
 
-    for (i = 1; i < values.size(); i++) {
-        j = i;
-        currentValue = values[j];
+    for (RandomIt i = first + 1; i != last; ++i) {
+        auto current_value = std::move(*i);
+        RandomIt j = i;
 
-        // 'order' is -1 for descending, so the inequality is reversed:
-        while (j > 0 && (order * values[j-1] > order * currentValue)) {
-            values[j] = values[j-1];
-            j--;
+        // shift greater elements one position to the right
+        while (j != first and comp(current_value, *(j - 1))) {
+            *j = std::move(*(j - 1));
+            --j;
         }
-        values[j] = currentValue;
+        *j = std::move(current_value);
+
+        show_state();
+    }
+}
 
-        if (to_show_state) {
-            display_state(values);
+/*
+    insertion_sort_by_key
+    ---------------------
+    Stably sorts the keys [keys_first, keys_last) according to comp, and
+    moves the values starting at values_first along with them.
+*/
+template <typename KeyIt, typename ValueIt, typename Compare = std::less<>>
+void insertion_sort_by_key(KeyIt keys_first, KeyIt keys_last, ValueIt values_first,
+                           Compare comp = Compare()) {
+    if (keys_first == keys_last)
+        return;
+
+    for (KeyIt i = keys_first + 1; i != keys_last; ++i) {
+        auto current_key = std::move(*i);
+        auto current_value = std::move(values_first[i - keys_first]);
+        KeyIt j = i;
+
+        // shift greater keys, and their values, one position to the right
+        while (j != keys_first and comp(current_key, *(j - 1))) {
+            *j = std::move(*(j - 1));
+            values_first[j - keys_first] = std::move(values_first[j - keys_first - 1]);
+            --j;
         }
+        *j = std::move(current_key);
+        values_first[j - keys_first] = std::move(current_value);
     }
 }
 
+// Wrapper function
+void insertion_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        insertion_sort(values.begin(), values.end(), comp, show_state);
+    });
+}
+
 #endif // INSERTION_SORT_HPP
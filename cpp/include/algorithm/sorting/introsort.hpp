@@ -0,0 +1,95 @@
+/*
+    Introsort
+    ---------
+    A hybrid of quick sort, heap sort and insertion sort. It quick sorts the
+    input using ninther pivots and Hoare partitioning, sorts small partitions
+    with insertion sort, and switches to heap sort for any partition once the
+    recursion gets deeper than 2 * log2(N), which would mean the pivots are
+    consistently bad. Only the smaller side of each partition is sorted
+    recursively, so the call stack never grows beyond O(log(N)).
+
+    Time complexity
+    ---------------
+    O(N * log(N)), where N is the number of elements, in the worst case.
+
+    Space complexity
+    ----------------
+    O(log(N)), for the recursion.
+*/
+
+#ifndef INTROSORT_HPP
+#define INTROSORT_HPP
+
+#include <functional>
+#include <vector>
+#include "heap_sort.hpp"
+#include "insertion_sort.hpp"
+#include "quick_sort.hpp"
+#include "utils.hpp"
+
+using std::vector;
+
+// Partitions with at most this many elements are insertion sorted
+const long INTROSORT_INSERTION_THRESHOLD = 16;
+
+/*
+    introsort_loop
+    --------------
+    Sorts [first, last), falling back to heap sort after depth_limit more
+    levels of partitioning. show_state is called after every partition step.
+*/
+template <typename RandomIt, typename Compare, typename StepCallback>
+void introsort_loop(RandomIt first, RandomIt last, int depth_limit, Compare comp,
+                    StepCallback show_state) {
+    while (last - first > INTROSORT_INSERTION_THRESHOLD) {
+        if (depth_limit == 0) {
+            heap_sort(first, last, comp);
+            show_state();
+            return;
+        }
+        depth_limit--;
+
+        std::iter_swap(first, ninther(first, last, comp));
+        RandomIt pivot = hoare_partition(first, last, comp);
+        show_state();
+
+        // Recurse into the smaller side, and keep looping on the larger one
+        if (pivot - first < last - pivot) {
+            introsort_loop(first, pivot, depth_limit, comp, show_state);
+            first = pivot + 1;
+        }
+        else {
+            introsort_loop(pivot + 1, last, depth_limit, comp, show_state);
+            last = pivot;
+        }
+    }
+
+    insertion_sort(first, last, comp);
+    show_state();
+}
+
+/*
+    introsort
+    ---------
+    Sorts the range [first, last) according to comp.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void introsort(RandomIt first, RandomIt last, Compare comp = Compare(),
+               StepCallback show_state = StepCallback()) {
+    // depth limit is 2 * floor(log2(N))
+    int depth_limit = 0;
+    for (auto size = last - first; size > 1; size /= 2)
+        depth_limit += 2;
+
+    introsort_loop(first, last, depth_limit, comp, show_state);
+}
+
+// Wrapper function
+void introsort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        introsort(values.begin(), values.end(), comp, show_state);
+    });
+}
+
+#endif // INTROSORT_HPP
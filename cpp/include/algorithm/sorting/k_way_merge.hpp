@@ -0,0 +1,252 @@
+/*
+    K-way merge
+    -----------
+    Merges k sorted runs into one sorted sequence in a single pass. Merging
+    them pairwise takes log(k) passes over all the data instead, which for
+    hundreds of runs that don't fit in the cache means reading and writing
+    everything from memory about eight times over.
+
+    The next element is chosen with a tournament tree of losers: the runs
+    are its leaves, and every internal node holds the run that lost the
+    match played there, while the overall winner is kept above the root.
+    After the winner's head is output, only the matches on the path from its
+    leaf to the root are replayed, against the losers stored there, which
+    takes log(k) comparisons and no swaps of siblings, unlike a binary heap.
+    Ties go to the run that comes first, so the merge is stable.
+
+    Time complexity
+    ---------------
+    O(N * log(K)), where N is the total number of elements and K the number
+    of runs.
+
+    Space complexity
+    ----------------
+    O(K), for the tree.
+*/
+
+#ifndef K_WAY_MERGE_HPP
+#define K_WAY_MERGE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+/*
+    LoserTree
+    ---------
+    Repeatedly selects the run whose head goes first, among the runs
+    [first_run, last_run) given as iterator pairs.
+*/
+
+template <typename InputIt, typename Compare>
+class LoserTree {
+    // Node 0 holds the winner, and nodes 1 .. k - 1 the losers of the
+    // internal nodes; the children of node n are 2n and 2n + 1, and run i is
+    // leaf k + i. Every node keeps the head of its run along with the run's
+    // index, so that the heads of the matches to replay can be loaded without
+    // waiting for the outcomes of the previous matches.
+    vector<InputIt> heads;
+    vector<size_t> runs;
+    vector<InputIt> ends;
+    Compare comp;
+
+    bool beats(InputIt head, size_t run, InputIt other_head, size_t other_run) const;
+
+    public:
+        template <typename RunIt>
+        LoserTree(RunIt first_run, RunIt last_run, Compare comp);
+
+        bool empty() const;
+        size_t winner() const;
+        InputIt& top();
+        void pop();
+};
+
+
+/*
+    Constructor
+    -----------
+    Plays all the matches bottom up, keeping the winners of the internal
+    nodes in a temporary array. The runs are pairs of iterators.
+*/
+
+template <typename InputIt, typename Compare>
+template <typename RunIt>
+LoserTree<InputIt, Compare>::LoserTree(RunIt first_run, RunIt last_run, Compare comp) : comp(comp) {
+    vector<InputIt> firsts;
+    for (; first_run != last_run; ++first_run) {
+        firsts.push_back(first_run->first);
+        ends.push_back(first_run->second);
+    }
+
+    const size_t num_runs = ends.size();
+    if (num_runs == 0)
+        return;
+
+    // Winners of the nodes, by run index
+    vector<size_t> winners(2 * num_runs);
+    for (size_t run = 0; run < num_runs; run++)
+        winners[num_runs + run] = run;
+
+    heads.assign(num_runs, firsts[0]);
+    runs.assign(num_runs, 0);
+    for (size_t node = num_runs; node-- > 1;) {
+        const size_t left = winners[2 * node];
+        const size_t right = winners[2 * node + 1];
+        const bool left_wins = beats(firsts[left], left, firsts[right], right);
+        winners[node] = left_wins ? left : right;
+        runs[node] = left_wins ? right : left;
+        heads[node] = firsts[runs[node]];
+    }
+
+    runs[0] = num_runs > 1 ? winners[1] : 0;
+    heads[0] = firsts[runs[0]];
+}
+
+
+/*
+    beats
+    -----
+    Whether head, the head of run, goes before other_head, the head of
+    other_run. Exhausted runs lose every match, and ties go to the run that
+    comes first.
+*/
+
+template <typename InputIt, typename Compare>
+bool LoserTree<InputIt, Compare>::beats(const InputIt head, const size_t run,
+                                        const InputIt other_head, const size_t other_run) const {
+    if (head == ends[run])
+        return false;
+    if (other_head == ends[other_run])
+        return true;
+    return run < other_run ? !comp(*other_head, *head) : comp(*head, *other_head);
+}
+
+
+/*
+    empty
+    -----
+    Whether all runs are exhausted.
+*/
+
+template <typename InputIt, typename Compare>
+bool LoserTree<InputIt, Compare>::empty() const {
+    return heads.empty() or heads[0] == ends[runs[0]];
+}
+
+
+/*
+    winner
+    ------
+    Returns the index of the run whose head goes first.
+*/
+
+template <typename InputIt, typename Compare>
+size_t LoserTree<InputIt, Compare>::winner() const {
+    return runs[0];
+}
+
+
+/*
+    top
+    ---
+    Returns the iterator to the head of the winning run. The tree must not
+    be empty.
+*/
+
+template <typename InputIt, typename Compare>
+InputIt& LoserTree<InputIt, Compare>::top() {
+    return heads[0];
+}
+
+
+/*
+    pop
+    ---
+    Advances the winning run, and replays its matches up to the root. The
+    tree must not be empty. The players of a match are put in run order
+    with conditional moves, so that a match takes a single comparison.
+*/
+
+template <typename InputIt, typename Compare>
+void LoserTree<InputIt, Compare>::pop() {
+    InputIt winner_head = heads[0];
+    size_t winner_run = runs[0];
+    ++winner_head;
+
+    bool winner_exhausted = winner_head == ends[winner_run];
+    for (size_t node = (runs.size() + winner_run) / 2; node >= 1; node /= 2) {
+        const InputIt loser_head = heads[node];
+        const size_t loser_run = runs[node];
+        if (loser_head == ends[loser_run])
+            continue;
+
+        bool loser_wins = true;
+        if (!winner_exhausted) {
+            const bool loser_first = loser_run < winner_run;
+            const InputIt first = loser_first ? loser_head : winner_head;
+            const InputIt second = loser_first ? winner_head : loser_head;
+            loser_wins = comp(*second, *first) != loser_first;
+        }
+
+        heads[node] = loser_wins ? winner_head : loser_head;
+        runs[node] = loser_wins ? winner_run : loser_run;
+        winner_head = loser_wins ? loser_head : winner_head;
+        winner_run = loser_wins ? loser_run : winner_run;
+        winner_exhausted = winner_exhausted and !loser_wins;
+    }
+
+    heads[0] = winner_head;
+    runs[0] = winner_run;
+}
+
+
+/*
+    k_way_merge
+    -----------
+    Stably merges the sorted runs [first_run, last_run), given as pairs of
+    input iterators, into the range starting at out, according to comp.
+    Elements are copied; runs of std::move_iterator move them. Returns the
+    end of the output range.
+*/
+template <typename RunIt, typename OutputIt, typename Compare = std::less<>>
+OutputIt k_way_merge(RunIt first_run, RunIt last_run, OutputIt out, Compare comp = Compare()) {
+    using InputIt = typename std::iterator_traits<RunIt>::value_type::first_type;
+
+    LoserTree<InputIt, Compare> tree(first_run, last_run, comp);
+    while (!tree.empty()) {
+        *out++ = *tree.top();
+        tree.pop();
+    }
+    return out;
+}
+
+/*
+    k_way_merge
+    -----------
+    Returns the stable merge of the sorted vectors runs, according to comp.
+*/
+template <typename T, typename Compare = std::less<>>
+vector<T> k_way_merge(const vector<vector<T>>& runs, Compare comp = Compare()) {
+    using InputIt = typename vector<T>::const_iterator;
+
+    size_t size = 0;
+    vector<std::pair<InputIt, InputIt>> ranges;
+    ranges.reserve(runs.size());
+    for (const vector<T>& run : runs) {
+        size += run.size();
+        ranges.emplace_back(run.begin(), run.end());
+    }
+
+    vector<T> merged;
+    merged.reserve(size);
+    k_way_merge(ranges.begin(), ranges.end(), std::back_inserter(merged), comp);
+    return merged;
+}
+
+#endif // K_WAY_MERGE_HPP
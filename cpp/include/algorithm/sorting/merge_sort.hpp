@@ -4,6 +4,8 @@
     An efficient, comparison-based, divide and conquer sorting algorithm.
     It divides input array into two halves, recursively calls itself for the two halves and
     then merges the two sorted halves.
+    Ranges of 32 or 64 bit integers are merged a vector at a time, with a
+    bitonic merge network (see sorting_network.hpp).
 
     Time complexity
     ---------------
@@ -12,71 +14,340 @@
     Space complexity
     ----------------
     O(N), where N is the number of elements.
-    This space is used for merging two halves of the array.
+    This space is used for merging two halves of the array. It is allocated
+    once per sort, or passed in by the caller.
 */
 
 #ifndef MERGE_SORT_HPP
 #define MERGE_SORT_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#include "insertion_sort.hpp"
+#include "sorting_network.hpp"
 #include "utils.hpp"
 
 using std::vector;
 
-// Merge sorted halves
-void merge(vector<int>& values, const size_t start, const size_t end, const int order = 1) {
-    size_t mid = (start + end) / 2;
-    size_t index1 = start;
-    size_t index2 = mid + 1;
-
-    vector<int> temp_vect(end - start + 1);
-    for (int& next_val: temp_vect) {
-        if (index1 > mid) {
-            // First part has ended, copy from the second part
-            next_val = values[index2++];
-        }
-        else if (index2 > end) {
-            // Second part has ended, copy from the first part
-            next_val = values[index1++];
-        }
-        else {
-            // Copy the value that's next in order
-            // 'order' is -1 for descending, so the inequality is reversed:
-            if (order * values[index1] < order * values[index2]) {
-                next_val = values[index1++];
-            }
-            else {
-                next_val = values[index2++];
-            }
-        }
+/*
+    merge_halves
+    ------------
+    Merges the sorted ranges [first, middle) and [middle, last) into one sorted
+    range. On ties, elements from the first half go first, which keeps merge
+    sort stable.
+*/
+template <typename RandomIt, typename Compare>
+void merge_halves(RandomIt first, RandomIt middle, RandomIt last, Compare comp) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    RandomIt left = first;
+    RandomIt right = middle;
+
+    vector<Value> temp_vect;
+    temp_vect.reserve(last - first);
+    while (left != middle and right != last) {
+        // Copy the value that's next in order
+        if (comp(*right, *left))
+            temp_vect.push_back(std::move(*right++));
+        else
+            temp_vect.push_back(std::move(*left++));
     }
 
-    size_t s = start;
-    for (int sorted_value: temp_vect)
-        values[s++] = sorted_value;
+    // One of the halves has ended, copy the rest of the other one
+    while (left != middle)
+        temp_vect.push_back(std::move(*left++));
+    while (right != last)
+        temp_vect.push_back(std::move(*right++));
+
+    std::move(temp_vect.begin(), temp_vect.end(), first);
 }
 
-// Carry out merge sort
-void merge_sort_range(vector<int>& values, const size_t start, const size_t end,
-                      const int order = 1, const bool to_show_state = false) {
-    if (start < end) {
-        size_t mid = (start + end) / 2;
+/*
+    merge_into
+    ----------
+    Stably merges the sorted ranges [first1, last1) and [first2, last2) into
+    the range starting at out, moving the elements. Returns the end of the
+    output range.
+*/
+template <typename InputIt1, typename InputIt2, typename OutputIt, typename Compare>
+OutputIt merge_into(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2,
+                    OutputIt out, Compare comp, std::false_type /* has merge network */) {
+    while (first1 != last1 and first2 != last2) {
+        if (comp(*first2, *first1))
+            *out++ = std::move(*first2++);
+        else
+            *out++ = std::move(*first1++);
+    }
 
-        merge_sort_range(values, start, mid, order, to_show_state);
-        merge_sort_range(values, mid + 1, end, order, to_show_state);
+    out = std::move(first1, last1, out);
+    return std::move(first2, last2, out);
+}
+
+template <typename InputIt1, typename InputIt2, typename OutputIt, typename Compare>
+OutputIt merge_into(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2,
+                    OutputIt out, Compare comp, std::true_type /* has merge network */) {
+    if (first1 == last1 or first2 == last2)
+        return merge_into(first1, last1, first2, last2, out, comp, std::false_type());
+
+    // Equal integers are indistinguishable, so the merge needn't be stable
+    const auto size = (last1 - first1) + (last2 - first2);
+    bitonic_merge(&*first1, &*first1 + (last1 - first1), &*first2, &*first2 + (last2 - first2), &*out, comp);
+    return out + size;
+}
+
+template <typename InputIt1, typename InputIt2, typename OutputIt, typename Compare>
+OutputIt merge_into(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2,
+                    OutputIt out, Compare comp) {
+    return merge_into(first1, last1, first2, last2, out, comp,
+                      HasMergeNetwork<InputIt1, InputIt2, OutputIt, Compare>());
+}
+
+// Ranges with at most this many elements are insertion sorted (or sorted by a
+// sorting network, see small_sort)
+const long MERGE_SORT_INSERTION_THRESHOLD = 16;
 
-        merge(values, start, end, order);
+template <typename RandomIt, typename BufferIt, typename Compare, typename StepCallback>
+void merge_sort_range_into(RandomIt first, RandomIt last, BufferIt out, Compare comp,
+                           StepCallback show_state);
 
-        if (to_show_state) {
-            display_state(values);
-        }
+/*
+    merge_sort_range
+    ----------------
+    Stably sorts [first, last), using the range of the same size starting at
+    buffer as scratch space. The halves are sorted into the buffer and then
+    merged back, so the two ranges swap roles at every level of the recursion,
+    and no level has to copy its result back.
+*/
+template <typename RandomIt, typename BufferIt, typename Compare, typename StepCallback>
+void merge_sort_range(RandomIt first, RandomIt last, BufferIt buffer, Compare comp,
+                      StepCallback show_state) {
+    const auto size = last - first;
+    if (size <= MERGE_SORT_INSERTION_THRESHOLD) {
+        small_sort(first, last, comp);
+        return;
     }
+
+    const auto half = (size + 1) / 2;
+    merge_sort_range_into(first, first + half, buffer, comp, show_state);
+    merge_sort_range_into(first + half, last, buffer + half, comp, show_state);
+
+    merge_into(buffer, buffer + half, buffer + half, buffer + size, first, comp);
+    show_state();
+}
+
+/*
+    merge_sort_range_into
+    ---------------------
+    Stably sorts the elements of [first, last) into the range of the same size
+    starting at out, using [first, last) as scratch space.
+*/
+template <typename RandomIt, typename BufferIt, typename Compare, typename StepCallback>
+void merge_sort_range_into(RandomIt first, RandomIt last, BufferIt out, Compare comp,
+                           StepCallback show_state) {
+    const auto size = last - first;
+    if (size <= MERGE_SORT_INSERTION_THRESHOLD) {
+        small_sort(first, last, comp);
+        std::move(first, last, out);
+        return;
+    }
+
+    const auto half = (size + 1) / 2;
+    merge_sort_range(first, first + half, out, comp, show_state);
+    merge_sort_range(first + half, last, out + half, comp, show_state);
+
+    merge_into(first, first + half, first + half, last, out, comp);
+}
+
+/*
+    merge_sort_with_buffer
+    ----------------------
+    Stably sorts the range [first, last) according to comp, using the caller's
+    scratch space starting at buffer, which must hold at least last - first
+    elements. It does not allocate any memory. show_state is called after
+    every merge into [first, last).
+*/
+template <typename RandomIt, typename BufferIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void merge_sort_with_buffer(RandomIt first, RandomIt last, BufferIt buffer,
+                            Compare comp = Compare(), StepCallback show_state = StepCallback()) {
+    merge_sort_range(first, last, buffer, comp, show_state);
+}
+
+/*
+    merge_sort
+    ----------
+    Stably sorts the range [first, last) according to comp. show_state is
+    called after every merge into [first, last).
+
+    A single buffer is allocated, by moving the elements into it. Sorting
+    the buffer's elements into [first, last) then needs no extra pass, and
+    the elements do not have to be default constructible.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void merge_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                StepCallback show_state = StepCallback()) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    if (last - first <= MERGE_SORT_INSERTION_THRESHOLD) {
+        small_sort(first, last, comp);
+        show_state();
+        return;
+    }
+
+    vector<Value> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+    merge_sort_range_into(buffer.begin(), buffer.end(), first, comp, show_state);
+    show_state();
+}
+
+/*
+    merge_halves_by_key_into
+    ------------------------
+    Stably merges the sorted keys [keys, keys + half) and [keys + half,
+    keys + size), with the values starting at values, into the ranges starting
+    at keys_out and values_out.
+*/
+template <typename KeyIt, typename ValueIt, typename KeyOutIt, typename ValueOutIt,
+          typename Compare>
+void merge_halves_by_key_into(KeyIt keys, ValueIt values, const long half, const long size,
+                              KeyOutIt keys_out, ValueOutIt values_out, Compare comp) {
+    long left = 0;
+    long right = half;
+    for (; left < half and right < size; ++keys_out, ++values_out) {
+        // on ties, the left half goes first
+        const long next = comp(keys[right], keys[left]) ? right++ : left++;
+        *keys_out = std::move(keys[next]);
+        *values_out = std::move(values[next]);
+    }
+
+    std::move(values + left, values + half, values_out);
+    std::move(keys + left, keys + half, keys_out);
+    std::move(values + right, values + size, values_out + (half - left));
+    std::move(keys + right, keys + size, keys_out + (half - left));
+}
+
+template <typename KeyIt, typename ValueIt, typename KeyOutIt, typename ValueOutIt,
+          typename Compare>
+void merge_sort_by_key_range_into(KeyIt keys, ValueIt values, long size,
+                                  KeyOutIt keys_out, ValueOutIt values_out, Compare comp);
+
+/*
+    merge_sort_by_key_range
+    -----------------------
+    Like merge_sort_range, for the keys [keys, keys + size) and the values
+    starting at values, with one buffer for each.
+*/
+template <typename KeyIt, typename ValueIt, typename KeyBufferIt, typename ValueBufferIt,
+          typename Compare>
+void merge_sort_by_key_range(KeyIt keys, ValueIt values, const long size,
+                             KeyBufferIt key_buffer, ValueBufferIt value_buffer, Compare comp) {
+    if (size <= MERGE_SORT_INSERTION_THRESHOLD) {
+        insertion_sort_by_key(keys, keys + size, values, comp);
+        return;
+    }
+
+    const long half = (size + 1) / 2;
+    merge_sort_by_key_range_into(keys, values, half, key_buffer, value_buffer, comp);
+    merge_sort_by_key_range_into(keys + half, values + half, size - half,
+                                 key_buffer + half, value_buffer + half, comp);
+
+    merge_halves_by_key_into(key_buffer, value_buffer, half, size, keys, values, comp);
+}
+
+/*
+    merge_sort_by_key_range_into
+    ----------------------------
+    Like merge_sort_range_into, for the keys [keys, keys + size) and the
+    values starting at values.
+*/
+template <typename KeyIt, typename ValueIt, typename KeyOutIt, typename ValueOutIt,
+          typename Compare>
+void merge_sort_by_key_range_into(KeyIt keys, ValueIt values, const long size,
+                                  KeyOutIt keys_out, ValueOutIt values_out, Compare comp) {
+    if (size <= MERGE_SORT_INSERTION_THRESHOLD) {
+        insertion_sort_by_key(keys, keys + size, values, comp);
+        std::move(keys, keys + size, keys_out);
+        std::move(values, values + size, values_out);
+        return;
+    }
+
+    const long half = (size + 1) / 2;
+    merge_sort_by_key_range(keys, values, half, keys_out, values_out, comp);
+    merge_sort_by_key_range(keys + half, values + half, size - half,
+                            keys_out + half, values_out + half, comp);
+
+    merge_halves_by_key_into(keys, values, half, size, keys_out, values_out, comp);
+}
+
+/*
+    merge_sort_by_key
+    -----------------
+    Stably sorts the keys [keys_first, keys_last) according to comp, and
+    applies the same permutation to the values starting at values_first.
+    Keys and values stay in separate arrays, and each gets its own buffer,
+    so comparisons only touch the keys.
+*/
+template <typename KeyIt, typename ValueIt, typename Compare = std::less<>>
+void merge_sort_by_key(KeyIt keys_first, KeyIt keys_last, ValueIt values_first,
+                       Compare comp = Compare()) {
+    using Key = typename std::iterator_traits<KeyIt>::value_type;
+    using Value = typename std::iterator_traits<ValueIt>::value_type;
+
+    const long size = keys_last - keys_first;
+    if (size <= MERGE_SORT_INSERTION_THRESHOLD) {
+        insertion_sort_by_key(keys_first, keys_last, values_first, comp);
+        return;
+    }
+
+    vector<Key> key_buffer(std::make_move_iterator(keys_first), std::make_move_iterator(keys_last));
+    vector<Value> value_buffer(std::make_move_iterator(values_first),
+                               std::make_move_iterator(values_first + size));
+    merge_sort_by_key_range_into(key_buffer.begin(), value_buffer.begin(), size,
+                                 keys_first, values_first, comp);
+}
+
+/*
+    merge_argsort
+    -------------
+    Returns the permutation that stably sorts the range [first, last)
+    according to comp: the index of the first element in sorted order, then
+    of the second one, and so on. The range is not modified.
+*/
+template <typename RandomIt, typename Compare = std::less<>>
+vector<size_t> merge_argsort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    vector<Value> keys(first, last);
+    vector<size_t> indices(keys.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    merge_sort_by_key(keys.begin(), keys.end(), indices.begin(), comp);
+    return indices;
+}
+
+// Merge sorted halves
+void merge(vector<int>& values, const size_t start, const size_t end, const int order = 1) {
+    auto first = values.begin() + start;
+    auto middle = values.begin() + (start + end) / 2 + 1;
+    auto last = values.begin() + end + 1;
+
+    // 'order' is -1 for descending, so the comparator is reversed:
+    if (order == -1)
+        merge_halves(first, middle, last, std::greater<int>());
+    else
+        merge_halves(first, middle, last, std::less<int>());
 }
 
 // Wrapper function
 void merge_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
-    size_t size = values.size();
-    merge_sort_range(values, 0, size - 1, order, to_show_state);
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        merge_sort(values.begin(), values.end(), comp, show_state);
+    });
 }
 
 #endif // MERGE_SORT_HPP
@@ -0,0 +1,235 @@
+/*
+    Parallel merge sort
+    -------------------
+    A multithreaded, stable merge sort. The two halves of every range are
+    sorted concurrently as fork-join tasks on a work-stealing pool, until the
+    ranges are small enough (the grain size) to be merge sorted sequentially.
+
+    The merges are parallel too, as otherwise the final merges would run on a
+    single thread. The output of a merge is cut into equal pieces, and the
+    co-rank of each cut (how many of the elements before it come from the
+    first half) is found by binary search. Every piece can then be merged
+    independently.
+
+    Time complexity
+    ---------------
+    O(N * log(N)) work, and O(log(N)^3) span, where N is the number of elements.
+
+    Space complexity
+    ----------------
+    O(N), for the merge buffer.
+*/
+
+#ifndef PARALLEL_MERGE_SORT_HPP
+#define PARALLEL_MERGE_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "merge_sort.hpp"
+#include "utils.hpp"
+#include "work_stealing_pool.hpp"
+
+using std::vector;
+
+// Ranges of at most this many elements are sorted or merged sequentially
+const size_t PARALLEL_MERGE_SORT_GRAIN_SIZE = 1 << 14;
+
+// Merges are cut into at most this many pieces per thread
+const size_t PARALLEL_MERGE_PIECES_PER_THREAD = 4;
+
+/*
+    co_rank
+    -------
+    Returns how many of the first k elements of the stable merge of the sorted
+    ranges a (of size a_size) and b (of size b_size) come from a.
+*/
+template <typename RandomIt1, typename RandomIt2, typename Compare>
+size_t co_rank(const size_t k, RandomIt1 a, const size_t a_size,
+               RandomIt2 b, const size_t b_size, Compare comp) {
+    size_t low = k > b_size ? k - b_size : 0;
+    size_t high = std::min(k, a_size);
+
+    // Find the smallest i for which a[i] does not precede b[k - i - 1]
+    while (low < high) {
+        const size_t i = low + (high - low) / 2;
+        const size_t j = k - i;
+        if (!comp(b[j - 1], a[i]))
+            low = i + 1;    // a[i] is merged before b[j - 1], so i is too small
+        else
+            high = i;
+    }
+    return low;
+}
+
+/*
+    parallel_merge
+    --------------
+    Stably merges the sorted ranges a (of size a_size) and b (of size b_size)
+    into the range starting at out, moving the elements, using the pool's
+    threads for large ranges.
+*/
+template <typename RandomIt1, typename RandomIt2, typename OutputIt, typename Compare>
+void parallel_merge(RandomIt1 a, const size_t a_size, RandomIt2 b, const size_t b_size,
+                    OutputIt out, Compare comp, WorkStealingPool& pool, const size_t grain_size) {
+    const size_t total = a_size + b_size;
+    const size_t max_pieces = PARALLEL_MERGE_PIECES_PER_THREAD * (pool.num_workers() + 1);
+    const size_t num_pieces = std::max<size_t>(1, std::min(total / grain_size, max_pieces));
+
+    auto merge_piece = [=](const size_t piece) {
+        const size_t k_begin = total * piece / num_pieces;
+        const size_t k_end = total * (piece + 1) / num_pieces;
+        const size_t i_begin = co_rank(k_begin, a, a_size, b, b_size, comp);
+        const size_t i_end = co_rank(k_end, a, a_size, b, b_size, comp);
+
+        merge_into(a + i_begin, a + i_end, b + (k_begin - i_begin), b + (k_end - i_end),
+                   out + k_begin, comp);
+    };
+
+    TaskGroup group(pool);
+    for (size_t piece = 1; piece < num_pieces; piece++)
+        group.run([=]() { merge_piece(piece); });
+    merge_piece(0);
+    group.wait();
+}
+
+/*
+    parallel_move
+    -------------
+    Moves the range [first, last) to the range starting at out, in pieces of
+    at least grain_size elements.
+*/
+template <typename InputIt, typename OutputIt>
+void parallel_move(InputIt first, InputIt last, OutputIt out,
+                   WorkStealingPool& pool, const size_t grain_size) {
+    const size_t size = last - first;
+
+    TaskGroup group(pool);
+    for (size_t begin = grain_size; begin < size; begin += grain_size) {
+        const size_t end = std::min(size, begin + grain_size);
+        group.run([=]() { std::move(first + begin, first + end, out + begin); });
+    }
+    std::move(first, first + std::min(size, grain_size), out);
+    group.wait();
+}
+
+template <typename RandomIt, typename BufferIt, typename Compare>
+void parallel_merge_sort_range_into(RandomIt first, RandomIt last, BufferIt out, Compare comp,
+                                    WorkStealingPool& pool, const size_t grain_size);
+
+/*
+    parallel_merge_sort_range
+    -------------------------
+    Sorts [first, last), using the range starting at buffer (of the same size)
+    as scratch space. The halves are sorted into the buffer and merged back,
+    so the two ranges swap roles at every level, like in merge_sort_range,
+    and no level copies its result back.
+*/
+template <typename RandomIt, typename BufferIt, typename Compare>
+void parallel_merge_sort_range(RandomIt first, RandomIt last, BufferIt buffer, Compare comp,
+                               WorkStealingPool& pool, const size_t grain_size) {
+    const size_t size = last - first;
+    if (size <= grain_size) {
+        merge_sort_with_buffer(first, last, buffer, comp);
+        return;
+    }
+
+    const size_t half = size / 2;
+    const RandomIt middle = first + half;
+
+    // Sort the first half on another thread (if one is idle), and the second here
+    TaskGroup group(pool);
+    group.run([=, &pool]() {
+        parallel_merge_sort_range_into(first, middle, buffer, comp, pool, grain_size);
+    });
+    parallel_merge_sort_range_into(middle, last, buffer + half, comp, pool, grain_size);
+    group.wait();
+
+    parallel_merge(buffer, half, buffer + half, size - half, first, comp, pool, grain_size);
+}
+
+/*
+    parallel_merge_sort_range_into
+    ------------------------------
+    Sorts the elements of [first, last) into the range of the same size
+    starting at out, using [first, last) as scratch space.
+*/
+template <typename RandomIt, typename BufferIt, typename Compare>
+void parallel_merge_sort_range_into(RandomIt first, RandomIt last, BufferIt out, Compare comp,
+                                    WorkStealingPool& pool, const size_t grain_size) {
+    const size_t size = last - first;
+    if (size <= grain_size) {
+        merge_sort_range_into(first, last, out, comp, NoStateDisplay());
+        return;
+    }
+
+    const size_t half = size / 2;
+    const RandomIt middle = first + half;
+
+    TaskGroup group(pool);
+    group.run([=, &pool]() {
+        parallel_merge_sort_range(first, middle, out, comp, pool, grain_size);
+    });
+    parallel_merge_sort_range(middle, last, out + half, comp, pool, grain_size);
+    group.wait();
+
+    parallel_merge(first, half, middle, size - half, out, comp, pool, grain_size);
+}
+
+/*
+    parallel_merge_sort
+    -------------------
+    Stably sorts the range [first, last) according to comp, using the threads
+    of pool along with the calling thread. Elements must be default
+    constructible, for the merge buffer.
+*/
+template <typename RandomIt, typename Compare = std::less<>>
+void parallel_merge_sort(WorkStealingPool& pool, RandomIt first, RandomIt last,
+                         Compare comp = Compare(),
+                         const size_t grain_size = PARALLEL_MERGE_SORT_GRAIN_SIZE) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    vector<Value> buffer(last - first);
+    parallel_merge_sort_range(first, last, buffer.begin(), comp, pool, std::max<size_t>(grain_size, 1));
+}
+
+/*
+    parallel_merge_sort
+    -------------------
+    Stably sorts the range [first, last) according to comp on num_threads
+    threads (the calling thread included), or on as many threads as the
+    hardware supports if num_threads is 0.
+*/
+template <typename RandomIt, typename Compare = std::less<>>
+void parallel_merge_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                         size_t num_threads = 0,
+                         const size_t grain_size = PARALLEL_MERGE_SORT_GRAIN_SIZE) {
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    WorkStealingPool pool(num_threads - 1);
+    parallel_merge_sort(pool, first, last, comp, grain_size);
+}
+
+/*
+    parallel_merge_sort
+    -------------------
+    Wrapper function. As the halves are sorted concurrently, there are no
+    intermediate states; only the sorted values are shown.
+*/
+void parallel_merge_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    // 'order' is -1 for descending, so the comparator is reversed:
+    if (order == -1)
+        parallel_merge_sort(values.begin(), values.end(), std::greater<int>());
+    else
+        parallel_merge_sort(values.begin(), values.end(), std::less<int>());
+
+    if (to_show_state)
+        display_state(values);
+}
+
+#endif // PARALLEL_MERGE_SORT_HPP
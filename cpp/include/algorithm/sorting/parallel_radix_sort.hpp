@@ -0,0 +1,270 @@
+/*
+    Parallel radix sort
+    -------------------
+    A multithreaded LSD radix sort. The input is cut into one chunk per
+    thread, and each pass runs in two parallel steps:
+      1. every thread counts the digits of its own chunk
+      2. a prefix sum over the digits, and then over the chunks, gives every
+         thread private offsets to write each bucket to, so that threads
+         scatter their chunks without synchronization, and the sort stays
+         stable.
+
+    Scattering writes to 2^D places at once, which thrashes the TLB and
+    makes every write a partial cache line write. So each thread first moves
+    elements into small write-combining buffers, one per bucket, and copies a
+    buffer out as a whole once it's full.
+
+    Time complexity
+    ---------------
+    O(W/D * N) work and O(W/D * (N/T + T * 2^D)) span, where N is the number
+    of keys, W the width of the keys in bits, D the width of the digits, and
+    T the number of threads.
+
+    Space complexity
+    ----------------
+    O(N + T * 2^D * (W/D + B)), for the buffer, the histograms and the write
+    combining buffers of B elements.
+*/
+
+#ifndef PARALLEL_RADIX_SORT_HPP
+#define PARALLEL_RADIX_SORT_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "parallel_merge_sort.hpp"
+#include "radix_sort.hpp"
+#include "utils.hpp"
+#include "work_stealing_pool.hpp"
+
+using std::vector;
+
+// Chunks have at least this many elements; smaller inputs are sorted sequentially
+const size_t PARALLEL_RADIX_SORT_GRAIN_SIZE = 1 << 16;
+
+// Size of the write-combining buffer of each bucket: two cache lines
+const size_t PARALLEL_RADIX_SORT_STAGING_BYTES = 128;
+
+/*
+    parallel_for_chunks
+    -------------------
+    Calls f(chunk) for every chunk in [0, num_chunks), on the pool's threads
+    and the calling thread, and returns once all calls have finished.
+*/
+template <typename F>
+void parallel_for_chunks(WorkStealingPool& pool, const size_t num_chunks, F f) {
+    TaskGroup group(pool);
+    for (size_t chunk = 1; chunk < num_chunks; chunk++)
+        group.run([chunk, &f]() { f(chunk); });
+    f(0);
+    group.wait();
+}
+
+/*
+    radix_scatter_staged
+    --------------------
+    Like radix_scatter, but gathers the elements of each bucket in a
+    write-combining buffer of capacity elements first (staging holds
+    2^DigitBits of them, and fill their 2^DigitBits sizes), and moves them
+    out in blocks.
+*/
+template <unsigned DigitBits, typename InputIt, typename OutputIt, typename StagingIt, typename RadixKey>
+void radix_scatter_staged(InputIt first, InputIt last, OutputIt out, size_t* offsets,
+                          const unsigned shift, RadixKey radix_key,
+                          StagingIt staging, size_t* fill, const size_t capacity) {
+    const size_t num_buckets = size_t(1) << DigitBits;
+    const size_t mask = num_buckets - 1;
+    std::fill(fill, fill + num_buckets, 0);
+
+    for (; first != last; ++first) {
+        const size_t bucket = (radix_key(*first) >> shift) & mask;
+        StagingIt block = staging + bucket * capacity;
+        block[fill[bucket]++] = std::move(*first);
+
+        if (fill[bucket] == capacity) {
+            std::move(block, block + capacity, out + offsets[bucket]);
+            offsets[bucket] += capacity;
+            fill[bucket] = 0;
+        }
+    }
+
+    // Flush the partially filled buffers
+    for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+        StagingIt block = staging + bucket * capacity;
+        std::move(block, block + fill[bucket], out + offsets[bucket]);
+    }
+}
+
+/*
+    parallel_radix_sort_with_buffer
+    -------------------------------
+    Stably sorts the range [first, last) by the keys that key_of extracts from
+    its elements, like radix_sort_with_buffer, using the threads of pool along
+    with the calling thread.
+*/
+template <unsigned DigitBits = RADIX_SORT_DIGIT_BITS, typename RandomIt, typename BufferIt,
+          typename KeyOf = RadixIdentity>
+void parallel_radix_sort_with_buffer(WorkStealingPool& pool, RandomIt first, RandomIt last,
+                                     BufferIt buffer, KeyOf key_of = KeyOf(), const int order = 1) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    using Key = typename std::decay<decltype(key_of(*first))>::type;
+    using Bits = typename RadixTraits<Key>::Bits;
+
+    const size_t size = last - first;
+    const size_t num_chunks = std::min(pool.num_workers() + 1, size / PARALLEL_RADIX_SORT_GRAIN_SIZE);
+    if (num_chunks <= 1) {
+        radix_sort_with_buffer<DigitBits>(first, last, buffer, key_of, order);
+        return;
+    }
+
+    const size_t num_buckets = size_t(1) << DigitBits;
+    const unsigned num_passes = (sizeof(Bits) * CHAR_BIT + DigitBits - 1) / DigitBits;
+    const size_t capacity = std::max<size_t>(1, PARALLEL_RADIX_SORT_STAGING_BYTES / sizeof(Value));
+
+    const Bits flip = order == -1 ? Bits(~Bits(0)) : Bits(0);
+    auto radix_key = [&](const Value& value) {
+        return Bits(RadixTraits<Key>::encode(key_of(value)) ^ flip);
+    };
+    auto chunk_begin = [&](const size_t chunk) {
+        return size * chunk / num_chunks;
+    };
+
+    // Write-combining buffers and their sizes for every chunk (so for every
+    // thread), allocated once for all passes, with every bucket's buffer
+    // starting a cache line
+    const size_t staging_size = num_buckets * capacity;
+    vector<Value> staging(num_chunks * staging_size + CACHE_LINE_BYTES / sizeof(Value));
+    Value* const staging_begin = staging.data() + cache_line_offset(staging.data());
+    vector<size_t> fills(num_chunks * num_buckets);
+
+    // Histograms of all digits of every chunk, in one pass over the input
+    vector<vector<size_t>> counts(num_chunks, vector<size_t>(num_passes * num_buckets, 0));
+    parallel_for_chunks(pool, num_chunks, [&](const size_t chunk) {
+        radix_histograms<DigitBits>(first + chunk_begin(chunk), first + chunk_begin(chunk + 1),
+                                    counts[chunk].data(), num_passes, radix_key);
+    });
+
+    const Bits first_bits = radix_key(*first);
+    bool scattered = false;
+    bool in_buffer = false;
+    for (unsigned pass = 0; pass < num_passes; pass++) {
+        const unsigned shift = pass * DigitBits;
+        const size_t first_bucket = (first_bits >> shift) & (num_buckets - 1);
+
+        // The totals don't depend on the order of the elements
+        size_t first_bucket_total = 0;
+        for (size_t chunk = 0; chunk < num_chunks; chunk++)
+            first_bucket_total += counts[chunk][pass * num_buckets + first_bucket];
+        if (first_bucket_total == size)
+            continue;
+
+        // After the first scatter, the chunks hold different elements, so
+        // the digits of this pass are counted again
+        if (scattered) {
+            parallel_for_chunks(pool, num_chunks, [&](const size_t chunk) {
+                size_t* chunk_counts = counts[chunk].data() + pass * num_buckets;
+                auto digit_key = [&](const Value& value) {
+                    return Bits(radix_key(value) >> shift);
+                };
+
+                std::fill(chunk_counts, chunk_counts + num_buckets, 0);
+                if (in_buffer)
+                    radix_histograms<DigitBits>(buffer + chunk_begin(chunk), buffer + chunk_begin(chunk + 1),
+                                                chunk_counts, 1, digit_key);
+                else
+                    radix_histograms<DigitBits>(first + chunk_begin(chunk), first + chunk_begin(chunk + 1),
+                                                chunk_counts, 1, digit_key);
+            });
+        }
+
+        // Every chunk writes a bucket after the same bucket of the previous chunks
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+            for (size_t chunk = 0; chunk < num_chunks; chunk++) {
+                size_t& count = counts[chunk][pass * num_buckets + bucket];
+                const size_t chunk_count = count;
+                count = offset;
+                offset += chunk_count;
+            }
+        }
+
+        parallel_for_chunks(pool, num_chunks, [&](const size_t chunk) {
+            size_t* offsets = counts[chunk].data() + pass * num_buckets;
+            Value* const chunk_buffers = staging_begin + chunk * staging_size;
+            size_t* const chunk_fills = fills.data() + chunk * num_buckets;
+            if (in_buffer)
+                radix_scatter_staged<DigitBits>(buffer + chunk_begin(chunk), buffer + chunk_begin(chunk + 1),
+                                                first, offsets, shift, radix_key,
+                                                chunk_buffers, chunk_fills, capacity);
+            else
+                radix_scatter_staged<DigitBits>(first + chunk_begin(chunk), first + chunk_begin(chunk + 1),
+                                                buffer, offsets, shift, radix_key,
+                                                chunk_buffers, chunk_fills, capacity);
+        });
+        scattered = true;
+        in_buffer = !in_buffer;
+    }
+
+    if (in_buffer)
+        parallel_move(buffer, buffer + size, first, pool, PARALLEL_RADIX_SORT_GRAIN_SIZE);
+}
+
+/*
+    parallel_radix_sort
+    -------------------
+    Stably sorts the range [first, last) by the keys that key_of extracts from
+    its elements, using the threads of pool along with the calling thread.
+    Elements must be default constructible, for the buffer.
+*/
+template <unsigned DigitBits = RADIX_SORT_DIGIT_BITS, typename RandomIt,
+          typename KeyOf = RadixIdentity>
+void parallel_radix_sort(WorkStealingPool& pool, RandomIt first, RandomIt last,
+                         KeyOf key_of = KeyOf(), const int order = 1) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    const size_t size = last - first;
+    if (size < 2)
+        return;
+
+    std::unique_ptr<Value[]> buffer(new Value[size]);
+    parallel_radix_sort_with_buffer<DigitBits>(pool, first, last, buffer.get(), key_of, order);
+}
+
+/*
+    parallel_radix_sort
+    -------------------
+    Stably sorts the range [first, last) on num_threads threads (the calling
+    thread included), or on as many threads as the hardware supports if
+    num_threads is 0.
+*/
+template <unsigned DigitBits = RADIX_SORT_DIGIT_BITS, typename RandomIt,
+          typename KeyOf = RadixIdentity>
+void parallel_radix_sort(RandomIt first, RandomIt last, KeyOf key_of = KeyOf(),
+                         const int order = 1, size_t num_threads = 0) {
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    WorkStealingPool pool(num_threads - 1);
+    parallel_radix_sort<DigitBits>(pool, first, last, key_of, order);
+}
+
+/*
+    parallel_radix_sort
+    -------------------
+    Wrapper function. Only the sorted values are shown.
+*/
+void parallel_radix_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    parallel_radix_sort(values.begin(), values.end(), RadixIdentity(), order);
+
+    if (to_show_state)
+        display_state(values);
+}
+
+#endif // PARALLEL_RADIX_SORT_HPP
@@ -0,0 +1,301 @@
+/*
+    Partial sort and selection
+    --------------------------
+    Finds the K elements that come first in a range, without sorting the rest.
+
+    introselect puts the element that would be at a given position of the
+    sorted range there, with the smaller elements before it and the larger
+    ones after it. It is quickselect (partitioning around a ninther pivot and
+    continuing in the side that holds the position only), which takes linear
+    time on average. If the partitions keep coming out unbalanced, it
+    switches to median of medians pivots, which guarantee linear time.
+
+    partial_introsort sorts the first K elements by selecting them and then
+    sorting only them, in O(N + K * log(K)). heap_partial_sort does the same
+    with a heap of K elements, in O(N * log(K)) but a single pass. TopK
+    selects the first K elements of a stream, which need not fit in memory,
+    in amortized constant time per element.
+
+    Time complexity
+    ---------------
+    introselect: O(N).
+    partial_introsort: O(N + K * log(K)).
+    heap_partial_sort: O(N * log(K)).
+    where N is the number of elements, and K the number of elements to sort.
+
+    Space complexity
+    ----------------
+    O(log(N)) for introselect and partial_introsort, O(1) for heap_partial_sort,
+    and O(K) for TopK.
+*/
+
+#ifndef PARTIAL_SORT_HPP
+#define PARTIAL_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "heap_sort.hpp"
+#include "insertion_sort.hpp"
+#include "introsort.hpp"
+#include "quick_sort.hpp"
+#include "utils.hpp"
+
+using std::vector;
+
+// Ranges with at most this many elements are insertion sorted by introselect
+const long INTROSELECT_INSERTION_THRESHOLD = 16;
+
+// Size of the groups whose medians make up the median of medians
+const long MEDIAN_OF_MEDIANS_GROUP_SIZE = 5;
+
+template <typename RandomIt, typename Compare>
+void median_of_medians_select(RandomIt first, RandomIt nth, RandomIt last, Compare comp);
+
+/*
+    median_of_medians
+    -----------------
+    Returns the position of a pivot for the range [first, last) that has at
+    least 3/10 of the elements on each side of it: the median of the medians
+    of groups of 5 elements. The medians are moved to the front of the range.
+*/
+template <typename RandomIt, typename Compare>
+RandomIt median_of_medians(RandomIt first, RandomIt last, Compare comp) {
+    RandomIt medians_last = first;
+    for (RandomIt group = first; group != last; ) {
+        const RandomIt group_last = last - group > MEDIAN_OF_MEDIANS_GROUP_SIZE
+                                  ? group + MEDIAN_OF_MEDIANS_GROUP_SIZE : last;
+        insertion_sort(group, group_last, comp);
+        std::iter_swap(medians_last++, group + (group_last - group) / 2);
+        group = group_last;
+    }
+
+    const RandomIt median = first + (medians_last - first) / 2;
+    median_of_medians_select(first, median, medians_last, comp);
+    return median;
+}
+
+/*
+    median_of_medians_select
+    ------------------------
+    Like introselect, but always partitions around the median of medians,
+    which takes linear time in the worst case, with a larger constant factor.
+*/
+template <typename RandomIt, typename Compare>
+void median_of_medians_select(RandomIt first, RandomIt nth, RandomIt last, Compare comp) {
+    while (last - first > INTROSELECT_INSERTION_THRESHOLD) {
+        std::iter_swap(first, median_of_medians(first, last, comp));
+        const RandomIt pivot = hoare_partition(first, last, comp);
+
+        if (pivot == nth)
+            return;
+        if (nth < pivot)
+            last = pivot;
+        else
+            first = pivot + 1;
+    }
+
+    insertion_sort(first, last, comp);
+}
+
+/*
+    introselect_loop
+    ----------------
+    Selects the nth element of [first, last), falling back to median of
+    medians pivots after depth_limit more levels of partitioning.
+*/
+template <typename RandomIt, typename Compare>
+void introselect_loop(RandomIt first, RandomIt nth, RandomIt last, int depth_limit, Compare comp) {
+    while (last - first > INTROSELECT_INSERTION_THRESHOLD) {
+        if (depth_limit == 0) {
+            median_of_medians_select(first, nth, last, comp);
+            return;
+        }
+        depth_limit--;
+
+        std::iter_swap(first, ninther(first, last, comp));
+        const RandomIt pivot = hoare_partition(first, last, comp);
+
+        // Only the side that holds nth is partitioned further
+        if (pivot == nth)
+            return;
+        if (nth < pivot)
+            last = pivot;
+        else
+            first = pivot + 1;
+    }
+
+    insertion_sort(first, last, comp);
+}
+
+/*
+    introselect
+    -----------
+    Rearranges the range [first, last) so that *nth is the element that would
+    be there if the range were sorted according to comp, no element of
+    [first, nth) comes after it, and no element of (nth, last) comes before
+    it. Does nothing if nth is last.
+*/
+template <typename RandomIt, typename Compare = std::less<>>
+void introselect(RandomIt first, RandomIt nth, RandomIt last, Compare comp = Compare()) {
+    if (nth == last)
+        return;
+
+    // depth limit is 2 * floor(log2(N)), like introsort's
+    int depth_limit = 0;
+    for (auto size = last - first; size > 1; size /= 2)
+        depth_limit += 2;
+
+    introselect_loop(first, nth, last, depth_limit, comp);
+}
+
+/*
+    partial_introsort
+    -----------------
+    Sorts the middle - first elements of [first, last) that come first
+    according to comp into [first, middle), and leaves the others in
+    [middle, last) in an unspecified order. They are selected by introselect,
+    and then introsorted.
+*/
+template <typename RandomIt, typename Compare = std::less<>>
+void partial_introsort(RandomIt first, RandomIt middle, RandomIt last, Compare comp = Compare()) {
+    if (first == middle)
+        return;
+
+    introselect(first, middle - 1, last, comp);
+    introsort(first, middle - 1, comp);
+}
+
+/*
+    heap_partial_sort
+    -----------------
+    Like partial_introsort, with a heap of the middle - first elements that
+    come first among those seen so far: each following element that comes
+    before the heap's top replaces it. The range is read once, in order.
+*/
+template <typename RandomIt, typename Compare = std::less<>>
+void heap_partial_sort(RandomIt first, RandomIt middle, RandomIt last, Compare comp = Compare()) {
+    using Distance = typename std::iterator_traits<RandomIt>::difference_type;
+
+    if (first == middle)
+        return;
+
+    build_heap(first, middle, comp, NoStateDisplay());
+    const Distance last_index = (middle - first) - 1;
+    for (RandomIt it = middle; it != last; ++it) {
+        if (comp(*it, *first)) {
+            std::iter_swap(it, first);
+            heapify(first, Distance(0), last_index, comp);
+        }
+    }
+    drain_heap(first, middle, comp, NoStateDisplay());
+}
+
+/*
+    TopK
+    ----
+    Keeps the k elements that come first according to comp among all the
+    elements pushed so far. Candidates are appended to a buffer of up to 2k
+    elements; when it is full, the k first ones are selected with introselect
+    and the rest dropped, which costs O(k) per k elements pushed. Afterwards,
+    elements that do not come before the last one kept are rejected at once.
+*/
+
+template <typename T, typename Compare = std::less<>>
+class TopK {
+    size_t k;
+    Compare comp;
+    vector<T> candidates;
+
+    // Whether candidates[k - 1] is a bound that the elements to keep must beat
+    bool is_bounded;
+
+    void shrink();
+
+    public:
+        explicit TopK(size_t k, Compare comp = Compare());
+
+        void push(T value);
+        template <typename InputIt>
+        void push(InputIt first, InputIt last);
+
+        vector<T> sorted() const;
+};
+
+
+/*
+    Constructor
+    -----------
+*/
+
+template <typename T, typename Compare>
+TopK<T, Compare>::TopK(size_t k, Compare comp) : k(k), comp(comp), is_bounded(false) {}
+
+
+/*
+    shrink
+    ------
+    Selects the k first candidates, drops the others, and keeps the last of
+    the k as the bound.
+*/
+
+template <typename T, typename Compare>
+void TopK<T, Compare>::shrink() {
+    introselect(candidates.begin(), candidates.begin() + (k - 1), candidates.end(), comp);
+    candidates.erase(candidates.begin() + k, candidates.end());
+    is_bounded = true;
+}
+
+
+/*
+    push
+    ----
+    Adds value to the candidates, unless k elements that come before it, or
+    are equal to it, have been pushed already.
+*/
+
+template <typename T, typename Compare>
+void TopK<T, Compare>::push(T value) {
+    if (k == 0 or (is_bounded and !comp(value, candidates[k - 1])))
+        return;
+
+    candidates.push_back(std::move(value));
+    if (candidates.size() == 2 * k)
+        shrink();
+}
+
+
+/*
+    push
+    ----
+    Pushes the elements of [first, last).
+*/
+
+template <typename T, typename Compare>
+template <typename InputIt>
+void TopK<T, Compare>::push(InputIt first, InputIt last) {
+    for (; first != last; ++first)
+        push(*first);
+}
+
+
+/*
+    sorted
+    ------
+    Returns the min(k, number of elements pushed) elements that come first,
+    sorted according to comp. Equal elements may come in any order.
+*/
+
+template <typename T, typename Compare>
+vector<T> TopK<T, Compare>::sorted() const {
+    vector<T> result = candidates;
+    const size_t size = std::min(k, result.size());
+    partial_introsort(result.begin(), result.begin() + size, result.end(), comp);
+    result.erase(result.begin() + size, result.end());
+    return result;
+}
+
+#endif // PARTIAL_SORT_HPP
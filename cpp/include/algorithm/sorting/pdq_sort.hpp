@@ -0,0 +1,486 @@
+/*
+    Pattern-defeating quick sort
+    ----------------------------
+    A quick sort variant (pdqsort, by Orson Peters) that combines introsort's
+    worst case guarantee with linear time on common patterns:
+
+    - Partitions of elements that are all equal to the pivot are put aside in
+      a single pass, so inputs with many duplicates take O(N * K) time, where
+      K is the number of distinct values.
+    - If a partition step did not need to swap anything, both sides are
+      probably sorted already, and a bounded insertion sort finishes them.
+    - Badly unbalanced partitions shuffle a few elements to break up the
+      pattern that caused them, and heap sort takes over after log2(N) of them.
+
+    For arithmetic keys compared with std::less or std::greater, partitioning
+    uses the branchless block scheme from BlockQuicksort (Edelkamp & Weiß):
+    the positions of elements that are on the wrong side are first collected
+    into small offset buffers, using the result of each comparison as an
+    integer instead of a branch, and are then swapped in bulk. This avoids
+    the branch mispredictions that dominate the classic partition loop on
+    random input.
+
+    Time complexity
+    ---------------
+    O(N * log(N)) in the worst case, O(N) for sorted, reverse sorted or
+    all-equal input, where N is the number of elements.
+
+    Space complexity
+    ----------------
+    O(log(N)), for the recursion.
+*/
+
+#ifndef PDQ_SORT_HPP
+#define PDQ_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "heap_sort.hpp"
+#include "insertion_sort.hpp"
+#include "utils.hpp"
+
+using std::vector;
+
+// Partitions with fewer elements than this are insertion sorted
+const long PDQ_INSERTION_SORT_THRESHOLD = 24;
+
+// Partitions with more elements than this use a pseudomedian of nine as pivot
+const long PDQ_NINTHER_THRESHOLD = 128;
+
+// Maximum number of element moves allowed when finishing a partition that
+// looks sorted with insertion sort
+const long PDQ_PARTIAL_INSERTION_SORT_LIMIT = 8;
+
+// Number of elements scanned per offset block in block partitioning
+const size_t PDQ_BLOCK_SIZE = 64;
+
+/*
+    sort3
+    -----
+    Sorts the three elements *a, *b and *c according to comp.
+*/
+template <typename RandomIt, typename Compare>
+void sort3(RandomIt a, RandomIt b, RandomIt c, Compare comp) {
+    if (comp(*b, *a))
+        std::iter_swap(a, b);
+    if (comp(*c, *b))
+        std::iter_swap(b, c);
+    if (comp(*b, *a))
+        std::iter_swap(a, b);
+}
+
+/*
+    unguarded_insertion_sort
+    ------------------------
+    Insertion sort that does not check for the beginning of the range. It may
+    only be used when *(first - 1) does not come after any element of
+    [first, last) according to comp, so that it stops every scan.
+*/
+template <typename RandomIt, typename Compare>
+void unguarded_insertion_sort(RandomIt first, RandomIt last, Compare comp) {
+    if (first == last)
+        return;
+
+    for (RandomIt current = first + 1; current != last; ++current) {
+        if (comp(*current, *(current - 1))) {
+            auto value = std::move(*current);
+            RandomIt hole = current;
+            do {
+                *hole = std::move(*(hole - 1));
+                --hole;
+            } while (comp(value, *(hole - 1)));
+            *hole = std::move(value);
+        }
+    }
+}
+
+/*
+    partial_insertion_sort
+    ----------------------
+    Insertion sorts [first, last), but gives up once more than
+    PDQ_PARTIAL_INSERTION_SORT_LIMIT elements had to be moved. Returns whether
+    the range was sorted completely.
+*/
+template <typename RandomIt, typename Compare>
+bool partial_insertion_sort(RandomIt first, RandomIt last, Compare comp) {
+    if (first == last)
+        return true;
+
+    long moves = 0;
+    for (RandomIt current = first + 1; current != last; ++current) {
+        if (comp(*current, *(current - 1))) {
+            auto value = std::move(*current);
+            RandomIt hole = current;
+            do {
+                *hole = std::move(*(hole - 1));
+                --hole;
+            } while (hole != first and comp(value, *(hole - 1)));
+            *hole = std::move(value);
+            moves += current - hole;
+        }
+
+        if (moves > PDQ_PARTIAL_INSERTION_SORT_LIMIT)
+            return false;
+    }
+    return true;
+}
+
+/*
+    swap_offsets
+    ------------
+    Swaps num pairs of elements found by block partitioning: the elements at
+    first + offsets_left[i] with the elements at last - offsets_right[i]. If
+    use_swaps is false, the pairs are rotated as one cycle, which needs fewer
+    moves than individual swaps.
+*/
+template <typename RandomIt>
+void swap_offsets(RandomIt first, RandomIt last, const unsigned char* offsets_left,
+                  const unsigned char* offsets_right, const size_t num, const bool use_swaps) {
+    if (use_swaps) {
+        // A cyclic rotation would not put equal numbers of elements back in
+        // place, which is needed for descending input to stay linear
+        for (size_t i = 0; i < num; i++)
+            std::iter_swap(first + offsets_left[i], last - offsets_right[i]);
+    }
+    else if (num > 0) {
+        RandomIt left = first + offsets_left[0];
+        RandomIt right = last - offsets_right[0];
+        auto temp = std::move(*left);
+        *left = std::move(*right);
+        for (size_t i = 1; i < num; i++) {
+            left = first + offsets_left[i];
+            *right = std::move(*left);
+            right = last - offsets_right[i];
+            *left = std::move(*right);
+        }
+        *right = std::move(temp);
+    }
+}
+
+/*
+    pdq_partition_right
+    -------------------
+    Partitions [first, last) around the pivot *first, putting elements equal
+    to the pivot on its right. The median of three pivot selection guarantees
+    there is an element not less than the pivot in the range, which stops the
+    first scan. Returns the pivot's final position, and whether the range
+    was already partitioned (no element had to be swapped).
+
+    With Branchless set, the elements between the first pair of misplaced
+    elements are partitioned in blocks of PDQ_BLOCK_SIZE.
+*/
+template <bool Branchless, typename RandomIt, typename Compare>
+std::pair<RandomIt, bool> pdq_partition_right(RandomIt first, RandomIt last, Compare comp) {
+    auto pivot = std::move(*first);
+    RandomIt left = first;
+    RandomIt right = last;
+
+    // Find the first element not less than the pivot, and the last element
+    // less than the pivot. The second scan is guarded only if there was no
+    // element less than the pivot on the left.
+    while (comp(*++left, pivot)) {}
+    if (left - 1 == first) {
+        while (left < right and !comp(*--right, pivot)) {}
+    }
+    else {
+        while (!comp(*--right, pivot)) {}
+    }
+
+    // If the first pair of misplaced elements cross, there is nothing to swap
+    const bool already_partitioned = left >= right;
+
+    if (!already_partitioned and Branchless) {
+        std::iter_swap(left, right);
+        ++left;
+
+        alignas(64) unsigned char offsets_left[PDQ_BLOCK_SIZE];
+        alignas(64) unsigned char offsets_right[PDQ_BLOCK_SIZE];
+        RandomIt offsets_left_base = left;
+        RandomIt offsets_right_base = right;
+        size_t num_left = 0, num_right = 0, start_left = 0, start_right = 0;
+
+        while (left < right) {
+            // Decide how many elements to scan for each offset block; a block
+            // that still holds unswapped offsets is not refilled
+            const size_t num_unknown = right - left;
+            const size_t left_split = num_left == 0 ? (num_right == 0 ? num_unknown / 2 : num_unknown) : 0;
+            const size_t right_split = num_right == 0 ? (num_unknown - left_split) : 0;
+
+            // Record the offsets of misplaced elements without branching: the
+            // offset is always written, but only kept if the comparison says so
+            const size_t left_scan = std::min(left_split, PDQ_BLOCK_SIZE);
+            for (size_t i = 0; i < left_scan; i++) {
+                offsets_left[num_left] = static_cast<unsigned char>(i);
+                num_left += !comp(*left, pivot);
+                ++left;
+            }
+            const size_t right_scan = std::min(right_split, PDQ_BLOCK_SIZE);
+            for (size_t i = 1; i <= right_scan; i++) {
+                offsets_right[num_right] = static_cast<unsigned char>(i);
+                num_right += comp(*--right, pivot);
+            }
+
+            // Swap as many misplaced pairs as both blocks allow
+            const size_t num = std::min(num_left, num_right);
+            swap_offsets(offsets_left_base, offsets_right_base,
+                         offsets_left + start_left, offsets_right + start_right,
+                         num, num_left == num_right);
+            num_left -= num;
+            num_right -= num;
+            start_left += num;
+            start_right += num;
+
+            if (num_left == 0) {
+                start_left = 0;
+                offsets_left_base = left;
+            }
+            if (num_right == 0) {
+                start_right = 0;
+                offsets_right_base = right;
+            }
+        }
+
+        // One block may still hold misplaced elements; move them next to the
+        // boundary, starting from the ones furthest inside
+        if (num_left) {
+            while (num_left--)
+                std::iter_swap(offsets_left_base + offsets_left[start_left + num_left], --right);
+            left = right;
+        }
+        if (num_right) {
+            while (num_right--) {
+                std::iter_swap(offsets_right_base - offsets_right[start_right + num_right], left);
+                ++left;
+            }
+            right = left;
+        }
+    }
+    else {
+        // Swap misplaced pairs; previously swapped elements guard both scans
+        while (left < right) {
+            std::iter_swap(left, right);
+            while (comp(*++left, pivot)) {}
+            while (!comp(*--right, pivot)) {}
+        }
+    }
+
+    // Place the pivot in its proper place
+    RandomIt pivot_position = left - 1;
+    *first = std::move(*pivot_position);
+    *pivot_position = std::move(pivot);
+
+    return std::make_pair(pivot_position, already_partitioned);
+}
+
+/*
+    pdq_partition_left
+    ------------------
+    Partitions [first, last) around the pivot *first, putting elements equal
+    to the pivot on its left, and returns the pivot's final position. Used
+    when the pivot equals the element before the range, which means that no
+    element of the range is less than the pivot: the left side then holds
+    only elements equal to the pivot, and needs no further sorting.
+*/
+template <typename RandomIt, typename Compare>
+RandomIt pdq_partition_left(RandomIt first, RandomIt last, Compare comp) {
+    auto pivot = std::move(*first);
+    RandomIt left = first;
+    RandomIt right = last;
+
+    while (comp(pivot, *--right)) {}
+    if (right + 1 == last) {
+        while (left < right and !comp(pivot, *++left)) {}
+    }
+    else {
+        while (!comp(pivot, *++left)) {}
+    }
+
+    while (left < right) {
+        std::iter_swap(left, right);
+        while (comp(pivot, *--right)) {}
+        while (!comp(pivot, *++left)) {}
+    }
+
+    // Place the pivot in its proper place
+    RandomIt pivot_position = right;
+    *first = std::move(*pivot_position);
+    *pivot_position = std::move(pivot);
+
+    return pivot_position;
+}
+
+/*
+    break_patterns
+    --------------
+    Swaps a few elements of a badly partitioned side [first, last) with
+    elements a quarter of the way in, so that the next pivot is unlikely to be
+    as bad as the previous one.
+*/
+template <typename RandomIt>
+void break_patterns(RandomIt first, RandomIt last) {
+    const auto size = last - first;
+    if (size < PDQ_INSERTION_SORT_THRESHOLD)
+        return;
+
+    const auto quarter = size / 4;
+    std::iter_swap(first, first + quarter);
+    std::iter_swap(last - 1, last - quarter);
+    if (size > PDQ_NINTHER_THRESHOLD) {
+        std::iter_swap(first + 1, first + (quarter + 1));
+        std::iter_swap(first + 2, first + (quarter + 2));
+        std::iter_swap(last - 2, last - (quarter + 1));
+        std::iter_swap(last - 3, last - (quarter + 2));
+    }
+}
+
+/*
+    pdq_sort_loop
+    -------------
+    Sorts [first, last), sorting left partitions recursively and looping on
+    right ones. bad_allowed is the number of unbalanced partitions left before
+    switching to heap sort. If leftmost is false, *(first - 1) is the pivot
+    of an enclosing partition step, so it is not greater than any element of
+    the range.
+*/
+template <bool Branchless, typename RandomIt, typename Compare, typename StepCallback>
+void pdq_sort_loop(RandomIt first, RandomIt last, Compare comp, int bad_allowed,
+                   bool leftmost, StepCallback show_state) {
+    while (true) {
+        const auto size = last - first;
+
+        if (size < PDQ_INSERTION_SORT_THRESHOLD) {
+            if (leftmost)
+                insertion_sort(first, last, comp);
+            else
+                unguarded_insertion_sort(first, last, comp);
+            show_state();
+            return;
+        }
+
+        // Choose the pivot as the median of three, or the pseudomedian of
+        // nine for large ranges, and move it to the front
+        const auto half = size / 2;
+        if (size > PDQ_NINTHER_THRESHOLD) {
+            sort3(first, first + half, last - 1, comp);
+            sort3(first + 1, first + (half - 1), last - 2, comp);
+            sort3(first + 2, first + (half + 1), last - 3, comp);
+            sort3(first + (half - 1), first + half, first + (half + 1), comp);
+            std::iter_swap(first, first + half);
+        }
+        else {
+            sort3(first + half, first, last - 1, comp);
+        }
+
+        // If the pivot equals the element before the range, the range holds no
+        // smaller elements: skip over all elements equal to the pivot at once
+        if (!leftmost and !comp(*(first - 1), *first)) {
+            first = pdq_partition_left(first, last, comp) + 1;
+            show_state();
+            continue;
+        }
+
+        auto partition_result = pdq_partition_right<Branchless>(first, last, comp);
+        const RandomIt pivot = partition_result.first;
+        const bool already_partitioned = partition_result.second;
+        show_state();
+
+        const auto left_size = pivot - first;
+        const auto right_size = last - (pivot + 1);
+        if (left_size < size / 8 or right_size < size / 8) {
+            // Too many unbalanced partitions: fall back to heap sort to
+            // guarantee O(N * log(N))
+            if (--bad_allowed == 0) {
+                heap_sort(first, last, comp);
+                show_state();
+                return;
+            }
+            break_patterns(first, pivot);
+            break_patterns(pivot + 1, last);
+        }
+        else if (already_partitioned and partial_insertion_sort(first, pivot, comp)
+                 and partial_insertion_sort(pivot + 1, last, comp)) {
+            // The partition looked sorted, and it was
+            show_state();
+            return;
+        }
+
+        pdq_sort_loop<Branchless>(first, pivot, comp, bad_allowed, leftmost, show_state);
+        first = pivot + 1;
+        leftmost = false;
+    }
+}
+
+/*
+    IsBranchlessFriendly
+    --------------------
+    Whether block partitioning pays off: comparisons must be cheap and free of
+    side effects, which holds for arithmetic keys under std::less or
+    std::greater.
+*/
+template <typename Value, typename Compare>
+struct IsBranchlessFriendly : std::false_type {};
+
+template <typename Value, typename T>
+struct IsBranchlessFriendly<Value, std::less<T>> : std::is_arithmetic<Value> {};
+
+template <typename Value, typename T>
+struct IsBranchlessFriendly<Value, std::greater<T>> : std::is_arithmetic<Value> {};
+
+/*
+    pdq_sort
+    --------
+    Sorts the range [first, last) according to comp. show_state is called after
+    every partition step.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void pdq_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+              StepCallback show_state = StepCallback()) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    if (last - first < 2)
+        return;
+
+    // heap sort takes over after log2(N) unbalanced partitions
+    int bad_allowed = 0;
+    for (auto size = last - first; size > 1; size /= 2)
+        bad_allowed++;
+
+    pdq_sort_loop<IsBranchlessFriendly<Value, Compare>::value>(
+        first, last, comp, bad_allowed, true, show_state);
+}
+
+/*
+    pdq_sort_branchless
+    -------------------
+    Like pdq_sort, but always uses block partitioning. Only worth it if comp
+    is cheap: for expensive comparisons, the offset bookkeeping costs more than
+    the branch mispredictions it saves.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void pdq_sort_branchless(RandomIt first, RandomIt last, Compare comp = Compare(),
+                         StepCallback show_state = StepCallback()) {
+    if (last - first < 2)
+        return;
+
+    int bad_allowed = 0;
+    for (auto size = last - first; size > 1; size /= 2)
+        bad_allowed++;
+
+    pdq_sort_loop<true>(first, last, comp, bad_allowed, true, show_state);
+}
+
+// Wrapper function
+void pdq_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        pdq_sort(values.begin(), values.end(), comp, show_state);
+    });
+}
+
+#endif // PDQ_SORT_HPP
@@ -19,63 +19,266 @@
 #ifndef QUICK_SORT_HPP
 #define QUICK_SORT_HPP
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdlib>      // rand(), srand()
 #include <ctime>        // time()
+#include <functional>
+#include <iterator>
+#include <numeric>
 #include <vector>
+#include "insertion_sort.hpp"
+#include "sorting_network.hpp"
 #include "utils.hpp"
 
 using std::vector;
 
-// Partition set based on pivot
-size_t partition(vector<int>& values, const size_t start, const size_t end, const int order = 1) {
-    // Choose a random index between start & end
-    size_t random_index = start + (rand() % (end - start + 1));
-
-    // Swap the value there with the first value in given range
-    swap(values[random_index], values[start]);
+/*
+    lomuto_partition
+    ----------------
+    Partitions the non-empty range [first, last) around a randomly chosen pivot
+    and returns the pivot's final position. Elements that come before the
+    pivot according to comp end up on its left, all others on its right.
+*/
+template <typename RandomIt, typename Compare>
+RandomIt lomuto_partition(RandomIt first, RandomIt last, Compare comp) {
+    // Choose a random element, and move it to the front of the range
+    RandomIt random_position = first + (rand() % (last - first));
+    std::iter_swap(random_position, first);
 
     // Make that value the pivot element
-    int pivot = values[start];
-
-    size_t i = start + 1;
-    for (size_t j = start + 1; j <= end; j++)  {
-            // Place elements which are less than the pivot on one side,
-            // and those which are greater on the other
-        if (order * values[j] < order * pivot) {
-            swap(values[i], values[j]);
-            i++;
+    const RandomIt pivot = first;
+
+    RandomIt boundary = first + 1;
+    for (RandomIt it = first + 1; it != last; ++it) {
+        // Place elements which are less than the pivot on one side,
+        // and those which are greater on the other
+        if (comp(*it, *pivot)) {
+            std::iter_swap(boundary, it);
+            ++boundary;
         }
     }
 
     // Place the pivot in its proper place
-    swap(values[start], values[i-1]);
+    std::iter_swap(pivot, boundary - 1);
 
-    return i-1;     // pivot's index
+    return boundary - 1;
 }
 
-// Carry out quick sort algorithm
-void quick_sort_internal(vector<int>& values, const int start, const int end, const int order = 1,
-                const bool to_show_state = false) {
-    if (start < end) {
-        size_t pivot_index = partition(values, start, end, order);
+/*
+    median_of_three
+    ---------------
+    Returns the position of the median of *a, *b and *c according to comp.
+*/
+template <typename RandomIt, typename Compare>
+RandomIt median_of_three(RandomIt a, RandomIt b, RandomIt c, Compare comp) {
+    if (comp(*a, *b)) {
+        if (comp(*b, *c))
+            return b;                   // a < b < c
+        return comp(*a, *c) ? c : a;    // a < b, c <= b
+    }
+    if (comp(*a, *c))
+        return a;                       // b <= a < c
+    return comp(*b, *c) ? c : b;        // b <= a, c <= a
+}
+
+// Ranges at least this large use a ninther instead of a median of three
+const long NINTHER_THRESHOLD = 128;
+
+/*
+    ninther
+    -------
+    Returns the position of a pivot for the non-empty range [first, last): the
+    median of the first, middle and last elements for small ranges, or Tukey's
+    ninther (the median of three medians of three) for large ones. Unlike a
+    random pivot, this stays close to the true median on sorted, reverse
+    sorted and nearly sorted input.
+*/
+template <typename RandomIt, typename Compare>
+RandomIt ninther(RandomIt first, RandomIt last, Compare comp) {
+    const auto size = last - first;
+    const RandomIt middle = first + size / 2;
+    const RandomIt back = last - 1;
+
+    if (size < NINTHER_THRESHOLD)
+        return median_of_three(first, middle, back, comp);
+
+    const auto eighth = size / 8;
+    return median_of_three(
+        median_of_three(first, first + eighth, first + 2*eighth, comp),
+        median_of_three(middle - eighth, middle, middle + eighth, comp),
+        median_of_three(back - 2*eighth, back - eighth, back, comp),
+        comp);
+}
+
+/*
+    hoare_partition
+    ---------------
+    Partitions the non-empty range [first, last) around the pivot *first and
+    returns the pivot's final position. Elements on its left do not come after
+    it according to comp, and elements on its right do not come before it.
+    Both scans stop at elements equal to the pivot, so ranges with many
+    duplicates are still split in the middle.
+*/
+template <typename RandomIt, typename Compare>
+RandomIt hoare_partition(RandomIt first, RandomIt last, Compare comp) {
+    RandomIt left = first;
+    RandomIt right = last;
+
+    while (true) {
+        do {
+            ++left;
+        } while (left != last and comp(*left, *first));
+        do {
+            --right;
+        } while (comp(*first, *right));     // stops at the pivot at the latest
+
+        if (!(left < right))
+            break;
+        std::iter_swap(left, right);
+    }
+
+    // Place the pivot in its proper place
+    std::iter_swap(first, right);
+
+    return right;
+}
+
+/*
+    quick_sort
+    ----------
+    Sorts the range [first, last) according to comp. show_state is called after
+    every partition has been sorted.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void quick_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                StepCallback show_state = StepCallback()) {
+    // Small ranges of 32 bit integers are sorted at once by a SIMD sorting network
+    if (HasSortingNetwork<RandomIt, Compare>::value and last - first <= long(SORTING_NETWORK_MAX_SIZE)) {
+        small_sort(first, last, comp);
+        show_state();
+        return;
+    }
+
+    if (last - first > 1) {
+        RandomIt pivot = lomuto_partition(first, last, comp);
 
         // Sort values to the left of pivot
-        quick_sort_internal(values, start, pivot_index-1, order, to_show_state);
+        quick_sort(first, pivot, comp, show_state);
 
         // Sort values to the right of pivot
-        quick_sort_internal(values, pivot_index+1, end, order, to_show_state);
+        quick_sort(pivot + 1, last, comp, show_state);
+
+        show_state();
+    }
+}
+
+// Ranges with at most this many keys are insertion sorted by quick_sort_by_key
+const long QUICK_SORT_BY_KEY_INSERTION_THRESHOLD = 16;
+
+/*
+    hoare_partition_by_key
+    ----------------------
+    Like hoare_partition, for the keys [keys_first, keys_last) around the
+    pivot *keys_first, swapping the values starting at values_first along
+    with them.
+*/
+template <typename KeyIt, typename ValueIt, typename Compare>
+KeyIt hoare_partition_by_key(KeyIt keys_first, KeyIt keys_last, ValueIt values_first, Compare comp) {
+    KeyIt left = keys_first;
+    KeyIt right = keys_last;
+
+    while (true) {
+        do {
+            ++left;
+        } while (left != keys_last and comp(*left, *keys_first));
+        do {
+            --right;
+        } while (comp(*keys_first, *right));
+
+        if (!(left < right))
+            break;
+        std::iter_swap(left, right);
+        std::iter_swap(values_first + (left - keys_first), values_first + (right - keys_first));
+    }
+
+    std::iter_swap(keys_first, right);
+    std::iter_swap(values_first, values_first + (right - keys_first));
+
+    return right;
+}
 
-        if (to_show_state) {
-            display_state(values);
+/*
+    quick_sort_by_key
+    -----------------
+    Sorts the keys [keys_first, keys_last) according to comp, and applies the
+    same permutation to the values starting at values_first. Keys and values
+    stay in separate arrays (structure-of-arrays), so partitioning only moves
+    them, not whole records. The sort is not stable. The smaller part of each
+    partition is sorted recursively, and the larger one in a loop, so the
+    stack depth is O(log(N)).
+*/
+template <typename KeyIt, typename ValueIt, typename Compare = std::less<>>
+void quick_sort_by_key(KeyIt keys_first, KeyIt keys_last, ValueIt values_first, Compare comp = Compare()) {
+    while (keys_last - keys_first > QUICK_SORT_BY_KEY_INSERTION_THRESHOLD) {
+        const KeyIt pivot = ninther(keys_first, keys_last, comp);
+        std::iter_swap(keys_first, pivot);
+        std::iter_swap(values_first, values_first + (pivot - keys_first));
+
+        const KeyIt middle = hoare_partition_by_key(keys_first, keys_last, values_first, comp);
+        const auto left_size = middle - keys_first;
+        if (left_size < keys_last - middle) {
+            quick_sort_by_key(keys_first, middle, values_first, comp);
+            keys_first = middle + 1;
+            values_first += left_size + 1;
+        }
+        else {
+            quick_sort_by_key(middle + 1, keys_last, values_first + (left_size + 1), comp);
+            keys_last = middle;
         }
     }
+
+    insertion_sort_by_key(keys_first, keys_last, values_first, comp);
+}
+
+/*
+    quick_argsort
+    -------------
+    Returns the permutation that sorts the range [first, last) according to
+    comp: the index of the first element in sorted order, then of the second
+    one, and so on. Equal elements may come in any order. The range is not
+    modified.
+*/
+template <typename RandomIt, typename Compare = std::less<>>
+vector<size_t> quick_argsort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    vector<Value> keys(first, last);
+    vector<size_t> indices(keys.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    quick_sort_by_key(keys.begin(), keys.end(), indices.begin(), comp);
+    return indices;
+}
+
+// Partition set based on pivot
+size_t partition(vector<int>& values, const size_t start, const size_t end, const int order = 1) {
+    auto first = values.begin() + start;
+    auto last = values.begin() + end + 1;
+
+    // 'order' is -1 for descending, so the comparator is reversed:
+    if (order == -1)
+        return lomuto_partition(first, last, std::greater<int>()) - values.begin();
+    return lomuto_partition(first, last, std::less<int>()) - values.begin();
 }
 
 // Wrapper function
 void quick_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
     srand(time(0));     // seed PRNG
-    size_t size = values.size();
-    quick_sort_internal(values, 0, size - 1, order, to_show_state);
+
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        quick_sort(values.begin(), values.end(), comp, show_state);
+    });
 }
 
 #endif // QUICK_SORT_HPP
@@ -5,106 +5,365 @@
     sorting algorithm that sorts data with integer keys by grouping keys by the
     individual digits which share the same significant position and value.
 
-    NOTE: This implementation of radix sort can be used to sort positive integers
-    only.
+    Keys of any arithmetic type are mapped to unsigned integers of the same
+    width that sort in the same order (see RadixTraits), and sorted by digits
+    of DigitBits bits, from the least significant one up. The histograms of
+    all digits are counted in a single pass over the input, and digits which
+    are the same for every key are skipped. Each remaining pass scatters the
+    elements between the input and a buffer, so that the sort does a few
+    sequential sweeps over memory and no comparisons.
+
+    radix_sort_by_key sorts keys and values kept in separate arrays
+    (structure-of-arrays), and radix_argsort returns the sorting permutation.
+
+    Time complexity
+    ---------------
+    O(W/D * N), where N is the number of keys, W the width of the keys in bits,
+    and D the width of the digits.
+
+    Space complexity
+    ----------------
+    O(N + W/D * 2^D), for the buffer and the histograms.
 */
 
 #ifndef RADIX_SORT_HPP
 #define RADIX_SORT_HPP
 
 #include <algorithm>
-#include <array>
-#include <iostream>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include "utils.hpp"
 
 using std::vector;
-using std::array;
+
+// Default number of bits per digit: one byte, so histograms fit in the L1 cache
+const unsigned RADIX_SORT_DIGIT_BITS = 8;
 
 /*
-    count_sort
-    ----------
-    Performs count sort on the elements passed by radix_sort.
+    RadixTraits
+    -----------
+    Maps keys to unsigned integers (Bits) that compare in the same order:
+      - unsigned integers are kept as they are
+      - signed integers get their sign bit flipped, so negative keys come first
+      - IEEE floating point numbers get their sign bit flipped if they are
+        positive, and all bits flipped if they are negative, which reverses
+        the order of negative keys. -0.0 is placed before 0.0, and NaNs
+        before or after all other keys, depending on their sign bit.
+*/
+template <typename T, typename Enable = void>
+struct RadixTraits;
 
-    Time complexity
-    ---------------
-    O(N), where N is the number of keys.
+template <typename T>
+struct RadixTraits<T, typename std::enable_if<std::is_integral<T>::value and
+                                              std::is_unsigned<T>::value>::type> {
+    using Bits = T;
 
-    Space complexity
-    ----------------
-    O(N), where N is the number of keys.
-*/
-void count_sort(vector<int>& values, const int extractor, const int mult_factor,
-                const int add_factor, const bool to_show_state = false) {
-    array<int, 10> counter{0};
-    vector<int> output(values.size());
+    static Bits encode(const T key) {
+        return key;
+    }
+};
 
-    auto get_digit = [&] (const int value) {
-        return add_factor + (mult_factor * ((value / extractor) % 10));
-    };
+template <typename T>
+struct RadixTraits<T, typename std::enable_if<std::is_integral<T>::value and
+                                              std::is_signed<T>::value>::type> {
+    using Bits = typename std::make_unsigned<T>::type;
 
-    for (int value: values) {
-        counter[get_digit(value)]++;
+    static Bits encode(const T key) {
+        return Bits(Bits(key) ^ (Bits(1) << (sizeof(T) * CHAR_BIT - 1)));
     }
-    for (int i = 1; i < 10; i++) {
-        counter[i] += counter[i - 1];
+};
+
+template <>
+struct RadixTraits<float> {
+    using Bits = uint32_t;
+
+    static Bits encode(const float key) {
+        static_assert(sizeof(float) == sizeof(Bits), "float must be 32 bits wide");
+        Bits bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        return bits ^ (-(bits >> 31) | (Bits(1) << 31));
+    }
+};
+
+template <>
+struct RadixTraits<double> {
+    using Bits = uint64_t;
+
+    static Bits encode(const double key) {
+        static_assert(sizeof(double) == sizeof(Bits), "double must be 64 bits wide");
+        Bits bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        return bits ^ (-(bits >> 63) | (Bits(1) << 63));
     }
-    for (int i = values.size() - 1; i >= 0; i--) {
-        output[counter[get_digit(values[i])] - 1] = values[i];
-        counter[get_digit(values[i])]--;
+};
+
+/*
+    RadixIdentity
+    -------------
+    Default key extractor, which sorts values by themselves. It returns a
+    reference, so that string keys aren't copied on every access.
+*/
+struct RadixIdentity {
+    template <typename T>
+    const T& operator()(const T& value) const {
+        return value;
     }
+};
 
-    values = output;
+/*
+    radix_histograms
+    ----------------
+    Counts, in one pass over [first, last), how many of the keys have each
+    value of each digit. counts holds num_passes histograms of 2^DigitBits
+    buckets, the first one for the least significant digit.
+*/
+template <unsigned DigitBits, typename InputIt, typename RadixKey>
+void radix_histograms(InputIt first, InputIt last, size_t* counts,
+                      const unsigned num_passes, RadixKey radix_key) {
+    const size_t num_buckets = size_t(1) << DigitBits;
+    const size_t mask = num_buckets - 1;
 
-    if (to_show_state) {
-        display_state(values);
+    for (; first != last; ++first) {
+        const auto bits = radix_key(*first);
+        for (unsigned pass = 0; pass < num_passes; pass++)
+            counts[pass * num_buckets + ((bits >> (pass * DigitBits)) & mask)]++;
     }
 }
 
 /*
-    max_in_vector
+    radix_scatter
     -------------
-    Returns the maximum value in a vector.
+    Moves the elements of [first, last) to the range starting at out, to the
+    positions given by offsets (the number of elements in all lower buckets)
+    for their digit at shift. Elements of the same bucket keep their order.
 */
-int max_in_vector(const vector<int>& values) {
-    return *max_element(values.begin(), values.end());
+template <unsigned DigitBits, typename InputIt, typename OutputIt, typename RadixKey>
+void radix_scatter(InputIt first, InputIt last, OutputIt out, size_t* offsets,
+                   const unsigned shift, RadixKey radix_key) {
+    const size_t mask = (size_t(1) << DigitBits) - 1;
+
+    for (; first != last; ++first)
+        out[offsets[(radix_key(*first) >> shift) & mask]++] = std::move(*first);
 }
 
 /*
-    radix_sort_internal
-    -------------------
-    Performs least significant digit radix sort, making use of count_sort.
+    radix_sort_passes
+    -----------------
+    Runs the passes of an LSD radix sort of size keys, given the histograms
+    of all their digits in counts, and the radix key of any one of them,
+    first_bits. scatter(offsets, shift, in_buffer) moves the elements from
+    the input (or the buffer, if in_buffer) to the other, by their digit at
+    shift. Passes where every key has the same digit are skipped. Returns
+    whether the sorted elements ended up in the buffer.
+*/
+template <unsigned DigitBits, typename Bits, typename Scatter>
+bool radix_sort_passes(const size_t size, size_t* counts, const Bits first_bits, Scatter scatter) {
+    const size_t num_buckets = size_t(1) << DigitBits;
+    const unsigned num_passes = (sizeof(Bits) * CHAR_BIT + DigitBits - 1) / DigitBits;
 
-    Time complexity
-    ---------------
-    O(N), where N is the number of keys.
+    bool in_buffer = false;
+    for (unsigned pass = 0; pass < num_passes; pass++) {
+        const unsigned shift = pass * DigitBits;
+        size_t* offsets = counts + pass * num_buckets;
 
-    Space complexity
-    ----------------
-    O(N), where N is the number of keys.
+        // If every key has the same digit, the pass wouldn't change anything
+        if (offsets[(first_bits >> shift) & (num_buckets - 1)] == size)
+            continue;
+
+        // Turn the counts into the positions where each bucket starts
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+            const size_t count = offsets[bucket];
+            offsets[bucket] = offset;
+            offset += count;
+        }
+
+        scatter(offsets, shift, in_buffer);
+        in_buffer = !in_buffer;
+    }
+    return in_buffer;
+}
+
+/*
+    radix_sort_with_buffer
+    ----------------------
+    Stably sorts the range [first, last) by the keys that key_of extracts from
+    its elements, in ascending order, or in descending order if order is -1.
+    The range starting at buffer, of at least the same size, is used as
+    scratch space, so this doesn't allocate memory besides the histograms.
 */
-void radix_sort_internal(vector<int>& values, const int mult_factor, const int add_factor,
-                         const bool to_show_state = false) {
-    int max_value = max_in_vector(values);
-
-    // On each iteration of the following loop, extractor helps in getting the
-    // next significant digit, which is (value / extractor) mod 10
-    for (int extractor = 1; max_value / extractor > 0; extractor *= 10) {
-        count_sort(values, extractor, to_show_state, mult_factor, add_factor);
+template <unsigned DigitBits = RADIX_SORT_DIGIT_BITS, typename RandomIt, typename BufferIt,
+          typename KeyOf = RadixIdentity>
+void radix_sort_with_buffer(RandomIt first, RandomIt last, BufferIt buffer,
+                            KeyOf key_of = KeyOf(), const int order = 1) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    using Key = typename std::decay<decltype(key_of(*first))>::type;
+    using Bits = typename RadixTraits<Key>::Bits;
+    static_assert(DigitBits > 0 and DigitBits <= 16, "digits must be 1 to 16 bits wide");
+
+    const size_t size = last - first;
+    if (size < 2)
+        return;
+
+    const size_t num_buckets = size_t(1) << DigitBits;
+    const unsigned num_passes = (sizeof(Bits) * CHAR_BIT + DigitBits - 1) / DigitBits;
+
+    // Descending order is ascending order of the complemented keys
+    const Bits flip = order == -1 ? Bits(~Bits(0)) : Bits(0);
+    auto radix_key = [&](const Value& value) {
+        return Bits(RadixTraits<Key>::encode(key_of(value)) ^ flip);
+    };
+
+    vector<size_t> counts(num_passes * num_buckets, 0);
+    radix_histograms<DigitBits>(first, last, counts.data(), num_passes, radix_key);
+
+    auto scatter = [&](size_t* offsets, const unsigned shift, const bool in_buffer) {
+        if (in_buffer)
+            radix_scatter<DigitBits>(buffer, buffer + size, first, offsets, shift, radix_key);
+        else
+            radix_scatter<DigitBits>(first, last, buffer, offsets, shift, radix_key);
+    };
+
+    if (radix_sort_passes<DigitBits>(size, counts.data(), radix_key(*first), scatter))
+        std::move(buffer, buffer + size, first);
+}
+
+/*
+    radix_sort
+    ----------
+    Stably sorts the range [first, last) by the keys that key_of extracts from
+    its elements (by default the elements themselves), which must be of an
+    integer or IEEE floating point type. Elements must be default
+    constructible, for the buffer. For example, to sort by 11 bit digits:
+        radix_sort<11>(values.begin(), values.end());
+*/
+template <unsigned DigitBits = RADIX_SORT_DIGIT_BITS, typename RandomIt,
+          typename KeyOf = RadixIdentity>
+void radix_sort(RandomIt first, RandomIt last, KeyOf key_of = KeyOf(), const int order = 1) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    const size_t size = last - first;
+    if (size < 2)
+        return;
+
+    // Default-initialized, so that the buffer of arithmetic values isn't zeroed
+    std::unique_ptr<Value[]> buffer(new Value[size]);
+    radix_sort_with_buffer<DigitBits>(first, last, buffer.get(), key_of, order);
+}
+
+/*
+    radix_scatter_by_key
+    --------------------
+    Like radix_scatter, for keys [keys_first, keys_last) with the values
+    starting at values_first: both are moved to the same positions of the
+    ranges starting at keys_out and values_out.
+*/
+template <unsigned DigitBits, typename KeyIt, typename ValueIt, typename KeyOutIt, typename ValueOutIt,
+          typename RadixKey>
+void radix_scatter_by_key(KeyIt keys_first, KeyIt keys_last, ValueIt values_first,
+                          KeyOutIt keys_out, ValueOutIt values_out, size_t* offsets,
+                          const unsigned shift, RadixKey radix_key) {
+    const size_t mask = (size_t(1) << DigitBits) - 1;
+
+    for (; keys_first != keys_last; ++keys_first, ++values_first) {
+        const size_t position = offsets[(radix_key(*keys_first) >> shift) & mask]++;
+        keys_out[position] = std::move(*keys_first);
+        values_out[position] = std::move(*values_first);
     }
 }
 
-// Wrapper function
-void radix_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
-    // The following factors depend on the sorting order
-    int mult_factor = 1;
-    int add_factor = 0;
-    if (order == -1) {
-        mult_factor = -1;
-        add_factor = 9;
+/*
+    radix_sort_by_key
+    -----------------
+    Stably sorts the keys [keys_first, keys_last), of an integer or IEEE
+    floating point type, in ascending order, or in descending order if order
+    is -1, and applies the same permutation to the values starting at
+    values_first. Keys and values stay in separate arrays, so only they are
+    moved, not whole records. Values must be default constructible, for the
+    buffer.
+*/
+template <unsigned DigitBits = RADIX_SORT_DIGIT_BITS, typename KeyIt, typename ValueIt>
+void radix_sort_by_key(KeyIt keys_first, KeyIt keys_last, ValueIt values_first, const int order = 1) {
+    using Key = typename std::iterator_traits<KeyIt>::value_type;
+    using Value = typename std::iterator_traits<ValueIt>::value_type;
+    using Bits = typename RadixTraits<Key>::Bits;
+    static_assert(DigitBits > 0 and DigitBits <= 16, "digits must be 1 to 16 bits wide");
+
+    const size_t size = keys_last - keys_first;
+    if (size < 2)
+        return;
+
+    const size_t num_buckets = size_t(1) << DigitBits;
+    const unsigned num_passes = (sizeof(Bits) * CHAR_BIT + DigitBits - 1) / DigitBits;
+
+    const Bits flip = order == -1 ? Bits(~Bits(0)) : Bits(0);
+    auto radix_key = [&](const Key& key) {
+        return Bits(RadixTraits<Key>::encode(key) ^ flip);
+    };
+
+    vector<size_t> counts(num_passes * num_buckets, 0);
+    radix_histograms<DigitBits>(keys_first, keys_last, counts.data(), num_passes, radix_key);
+
+    std::unique_ptr<Key[]> key_buffer(new Key[size]);
+    std::unique_ptr<Value[]> value_buffer(new Value[size]);
+    auto scatter = [&](size_t* offsets, const unsigned shift, const bool in_buffer) {
+        if (in_buffer)
+            radix_scatter_by_key<DigitBits>(key_buffer.get(), key_buffer.get() + size, value_buffer.get(),
+                                            keys_first, values_first, offsets, shift, radix_key);
+        else
+            radix_scatter_by_key<DigitBits>(keys_first, keys_last, values_first,
+                                            key_buffer.get(), value_buffer.get(), offsets, shift, radix_key);
+    };
+
+    if (radix_sort_passes<DigitBits>(size, counts.data(), radix_key(*keys_first), scatter)) {
+        std::move(key_buffer.get(), key_buffer.get() + size, keys_first);
+        std::move(value_buffer.get(), value_buffer.get() + size, values_first);
     }
+}
 
-    radix_sort_internal(values, mult_factor, add_factor, to_show_state);
+/*
+    radix_argsort
+    -------------
+    Returns the permutation that stably sorts the range [first, last) by the
+    keys that key_of extracts from its elements: the index of the first
+    element in sorted order, then of the second one, and so on. The range is
+    not modified.
+*/
+template <unsigned DigitBits = RADIX_SORT_DIGIT_BITS, typename RandomIt,
+          typename KeyOf = RadixIdentity>
+vector<size_t> radix_argsort(RandomIt first, RandomIt last, KeyOf key_of = KeyOf(), const int order = 1) {
+    using Key = typename std::decay<decltype(key_of(*first))>::type;
+
+    vector<Key> keys;
+    keys.reserve(last - first);
+    for (RandomIt it = first; it != last; ++it)
+        keys.push_back(key_of(*it));
+
+    vector<size_t> indices(keys.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    radix_sort_by_key<DigitBits>(keys.begin(), keys.end(), indices.begin(), order);
+    return indices;
+}
+
+/*
+    radix_sort
+    ----------
+    Wrapper function. As passes alternate between the values and a buffer,
+    there are no intermediate states; only the sorted values are shown.
+*/
+void radix_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    radix_sort(values.begin(), values.end(), RadixIdentity(), order);
+
+    if (to_show_state)
+        display_state(values);
 }
 
 #endif // RADIX_SORT_HPP
@@ -18,30 +18,43 @@
 #ifndef SELECTION_SORT_HPP
 #define SELECTION_SORT_HPP
 
+#include <functional>
 #include <vector>
 #include "utils.hpp"
 
 using std::vector;
 
-void selection_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
-    size_t current_extreme_index;   // index of either the current minimum or maximum value, depending on the order
-    size_t i, j;
-    for (i = 0; i < values.size() - 1; i++) {
-        current_extreme_index = i;
-        j = i + 1;
-        while (j < values.size()) {
-            // 'order' is -1 for descending, so the inequality is reversed:
-            if (order * values[j] < order * values[current_extreme_index]) {
-                current_extreme_index = j;
-            }
-            j++;
+/*
+    selection_sort
+    --------------
+    Sorts the range [first, last) according to comp. show_state is called
+    each time an element has been moved to its final position.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void selection_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                    StepCallback show_state = StepCallback()) {
+    if (last - first < 2)
+        return;
+
+    for (RandomIt i = first; i != last - 1; ++i) {
+        // the first element that comes before all others in the unsorted part
+        RandomIt current_extreme = i;
+        for (RandomIt j = i + 1; j != last; ++j) {
+            if (comp(*j, *current_extreme))
+                current_extreme = j;
         }
-        swap(values[i], values[current_extreme_index]);
+        std::iter_swap(i, current_extreme);
 
-        if (to_show_state) {
-            display_state(values);
-        }
+        show_state();
     }
 }
 
+// Wrapper function
+void selection_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        selection_sort(values.begin(), values.end(), comp, show_state);
+    });
+}
+
 #endif // SELECTION_SORT_HPP
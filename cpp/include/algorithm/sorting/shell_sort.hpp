@@ -3,12 +3,22 @@
     ----------
     An in-place comparison sort which starts by sorting pairs of elements far
     apart from each other, then progressively reducing the gap between elements
-    to be compared. The time complexity depends on the gap sequence, which is
-    floor(N / 2^K) in this implementation.
+    to be compared. The time complexity depends on the gap sequence, which can
+    be chosen: Ciura's (the default), Tokuda's, Sedgewick's, or Shell's
+    original floor(N / 2^K).
+
+    Every pass sorts the subsequences of elements gap apart by insertion. With
+    SIMD (see sorting_network.hpp), the passes whose gap is at least a vector
+    wide sort ranges of 32 bit integers a row of gap elements at a time
+    instead: the elements of a row belong to different subsequences, so a
+    vector of them is inserted at once, with vector min and max
+    instructions, until all its elements are in place.
 
     Time complexity
     ---------------
-    O(N^2), where N is the number of elements.
+    O(N^2) with Shell's gaps, O(N^(4/3)) with Sedgewick's, where N is the
+    number of elements. No bound is known for Ciura's and Tokuda's gaps, which
+    are faster in practice.
 
     Space complexity
     ----------------
@@ -18,30 +28,222 @@
 #ifndef SHELL_SORT_HPP
 #define SHELL_SORT_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#include "sorting_network.hpp"
 #include "utils.hpp"
 
 using std::vector;
 
-void shell_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
-    size_t size = values.size();
-
-    // gap sequence is n/2, n/4, n/8, ..., 1
-    for (size_t gap = size / 2; gap > 0; gap /= 2) {
-        for (size_t i = gap; i < size; i++) {
-            int temp = values[i];
-            size_t j = i;
-            while (j >= gap and values[j - gap] * order > temp * order) {
-                values[j] = values[j - gap];
-                j -= gap;
-            }
-            values[j] = temp;
-
-            if (to_show_state) {
-                display_state(values);
-            }
+/*
+    Gap sequences
+    -------------
+    The gaps of the tabulated sequences, in increasing order, up to 2^40.
+    Ciura's were found experimentally up to 701, and are extended by factors
+    of 2.25. Tokuda's are ceil((9 * (9/4)^K - 4) / 5), and Sedgewick's are
+    4^K + 3 * 2^(K-1) + 1, after 1.
+*/
+constexpr uint64_t CIURA_GAPS[] = {
+    1, 4, 10, 23, 57, 132, 301, 701, 1577, 3548, 7983, 17961, 40412, 90927, 204585, 460316,
+    1035711, 2330349, 5243285, 11797391, 26544129, 59724290, 134379652, 302354217, 680296988,
+    1530668223, 3444003501, 7749007877, 17435267723, 39229352376, 88266042846, 198598596403,
+    446846841906, 1005405394288
+};
+
+constexpr uint64_t TOKUDA_GAPS[] = {
+    1, 4, 9, 20, 46, 103, 233, 525, 1182, 2660, 5985, 13467, 30301, 68178, 153401, 345152,
+    776591, 1747331, 3931496, 8845866, 19903198, 44782196, 100759940, 226709866, 510097200,
+    1147718700, 2582367076, 5810325920, 13073233321, 29414774973, 66183243690, 148912298303,
+    335052671183, 753868510162
+};
+
+constexpr uint64_t SEDGEWICK_GAPS[] = {
+    1, 8, 23, 77, 281, 1073, 4193, 16577, 65921, 262913, 1050113, 4197377, 16783361, 67121153,
+    268460033, 1073790977, 4295065601, 17180065793, 68719869953, 274878693377
+};
+
+/*
+    previous_gap
+    ------------
+    Returns the largest gap of the table gaps that is smaller than gap, or 0
+    if there is none.
+*/
+template <size_t Size>
+size_t previous_gap(const uint64_t (&gaps)[Size], const size_t gap) {
+    const uint64_t* next = std::lower_bound(gaps, gaps + Size, uint64_t(gap));
+    return next == gaps ? 0 : size_t(*(next - 1));
+}
+
+/*
+    CiuraGaps, TokudaGaps, SedgewickGaps, ShellGaps
+    -----------------------------------------------
+    Gap sequences for shell_sort. next_gap returns the gap that follows gap,
+    or 0 after the last gap (1); the first gap for N elements is next_gap(N).
+*/
+struct CiuraGaps {
+    static size_t next_gap(const size_t gap) {
+        return previous_gap(CIURA_GAPS, gap);
+    }
+};
+
+struct TokudaGaps {
+    static size_t next_gap(const size_t gap) {
+        return previous_gap(TOKUDA_GAPS, gap);
+    }
+};
+
+struct SedgewickGaps {
+    static size_t next_gap(const size_t gap) {
+        return previous_gap(SEDGEWICK_GAPS, gap);
+    }
+};
+
+struct ShellGaps {
+    static size_t next_gap(const size_t gap) {
+        return gap / 2;
+    }
+};
+
+/*
+    gap_insertion_sort
+    ------------------
+    Sorts the subsequences of the size elements starting at first whose
+    elements are gap apart, by insertion, starting with the element at index
+    begin. show_state is called after each element has been inserted.
+*/
+template <typename RandomIt, typename Distance, typename Compare, typename StepCallback>
+void gap_insertion_sort(RandomIt first, const Distance begin, const Distance size, const Distance gap,
+                        Compare comp, StepCallback show_state) {
+    for (Distance i = begin; i < size; i++) {
+        auto temp = std::move(first[i]);
+        Distance j = i;
+        while (j >= gap and comp(temp, first[j - gap])) {
+            first[j] = std::move(first[j - gap]);
+            j -= gap;
+        }
+        first[j] = std::move(temp);
+
+        show_state();
+    }
+}
+
+#if SORTING_NETWORK_SIMD
+/*
+    insert_lanes
+    ------------
+    Inserts the vector of keys at high into the sorted subsequences of the
+    keys starting at keys, whose elements are gap apart. Every step
+    compare-exchanges the keys with those gap before them, and moves up; it
+    stops once a whole vector is in order, which in the later passes of a
+    shell sort is after a step or two.
+*/
+template <typename Lanes, bool Descending>
+void insert_lanes(const int32_t* keys, int32_t* high, const size_t gap) {
+    typename Lanes::Vector inserted = Lanes::load(high);
+    for (; size_t(high - keys) >= gap; high -= gap) {
+        const typename Lanes::Vector above = Lanes::load(high - gap);
+        const typename Lanes::Vector lower = Descending ? Lanes::max(above, inserted) : Lanes::min(above, inserted);
+        if (Lanes::equal(lower, above))
+            break;
+
+        Lanes::store(high, Descending ? Lanes::min(above, inserted) : Lanes::max(above, inserted));
+        Lanes::store(high - gap, lower);
+        inserted = lower;
+    }
+}
+
+/*
+    gap_sort_lanes
+    --------------
+    Sorts the subsequences of the size keys starting at keys whose elements
+    are gap apart, which must be at least a vector wide. The keys are viewed
+    as rows of gap keys, whose columns are the subsequences; the keys of a
+    row are independent, so they are inserted a vector at a time. show_state
+    is called after each row has been inserted.
+*/
+template <typename Lanes, bool Descending, typename Compare, typename StepCallback>
+void gap_sort_lanes(int32_t* keys, const size_t size, const size_t gap, Compare comp,
+                    StepCallback show_state) {
+    for (size_t row = gap; row < size; row += gap) {
+        const size_t length = std::min(gap, size - row);
+        if (length < Lanes::width) {
+            gap_insertion_sort(keys, row, size, gap, comp, NoStateDisplay());
+        }
+        else {
+            for (size_t column = 0; column + Lanes::width <= length; column += Lanes::width)
+                insert_lanes<Lanes, Descending>(keys, keys + (row + column), gap);
+
+            // The last vector overlaps inserted keys, which are in order
+            if (length % Lanes::width != 0)
+                insert_lanes<Lanes, Descending>(keys, keys + (row + length - Lanes::width), gap);
         }
+
+        show_state();
+    }
+}
+#endif
+
+/*
+    gap_sort
+    --------
+    Sorts the subsequences of elements gap apart, like gap_insertion_sort.
+    With SIMD, ranges of 32 bit integers are sorted a vector at a time by
+    gap_sort_lanes, with the widest vectors that the gap fills.
+*/
+template <typename RandomIt, typename Distance, typename Compare, typename StepCallback>
+void gap_sort(RandomIt first, const Distance size, const Distance gap, Compare comp,
+              StepCallback show_state, std::false_type /* has SIMD */) {
+    gap_insertion_sort(first, gap, size, gap, comp, show_state);
+}
+
+template <typename RandomIt, typename Distance, typename Compare, typename StepCallback>
+void gap_sort(RandomIt first, const Distance size, const Distance gap, Compare comp,
+              StepCallback show_state, std::true_type /* has SIMD */) {
+#if SORTING_NETWORK_SIMD
+    const bool descending = IsReverseOrder<Compare>::value;
+#if defined(__AVX512F__)
+    if (size_t(gap) >= Avx512Lanes::width) {
+        gap_sort_lanes<Avx512Lanes, descending>(&*first, size_t(size), size_t(gap), comp, show_state);
+        return;
     }
+#endif
+    if (size_t(gap) >= Avx2Lanes::width) {
+        gap_sort_lanes<Avx2Lanes, descending>(&*first, size_t(size), size_t(gap), comp, show_state);
+        return;
+    }
+#endif
+    gap_insertion_sort(first, gap, size, gap, comp, show_state);
+}
+
+/*
+    shell_sort
+    ----------
+    Sorts the range [first, last) according to comp, with the gaps of Gaps
+    (CiuraGaps by default). show_state is called after each element, or row
+    of elements, has been inserted into its gap-sorted subsequence.
+*/
+template <typename Gaps = CiuraGaps, typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void shell_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                StepCallback show_state = StepCallback()) {
+    using Distance = typename std::iterator_traits<RandomIt>::difference_type;
+    const Distance size = last - first;
+
+    for (size_t gap = Gaps::next_gap(size_t(size)); gap > 0; gap = Gaps::next_gap(gap))
+        gap_sort(first, size, Distance(gap), comp, show_state, HasSortingNetwork<RandomIt, Compare>());
+}
+
+// Wrapper function
+void shell_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        shell_sort(values.begin(), values.end(), comp, show_state);
+    });
 }
 
 #endif // SHELL_SORT_HPP
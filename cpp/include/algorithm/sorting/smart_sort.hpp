@@ -0,0 +1,585 @@
+/*
+    Smart sort
+    ----------
+    Picks a sorting algorithm for a range from a sample of it, so that
+    callers need not know which of the algorithms in this directory suits
+    their data. A few evenly spread blocks of consecutive elements are
+    sampled, and their statistics decide:
+
+    - Ranges made of few long runs (ascending or descending) are tim sorted,
+      which merges the runs instead of sorting them again. Few inversions
+      between distant elements don't decide on their own: without long runs,
+      tim sort loses to pdqsort even on ranges with only adjacent pairs
+      swapped, so only the runs are sampled.
+    - Integers whose values span a small range compared to their number are
+      counting sorted, and other arithmetic keys compared with std::less or
+      std::greater are radix sorted once the range is large enough.
+    - Everything else is sorted by pdqsort, or by introsort if the range is
+      small and has few duplicates.
+
+    The thresholds between these can be tuned, or measured on the machine
+    at hand by calibrate_smart_sort, and saved to a file to be reused.
+
+    Time complexity
+    ---------------
+    O(N * log(N)), or O(N) for presorted, counting or radix sorted ranges,
+    where N is the number of elements. The sample takes O(S * log(S)) time,
+    where S is its size.
+
+    Space complexity
+    ----------------
+    O(N) if tim, counting or radix sorted, O(log(N)) otherwise.
+*/
+
+#ifndef SMART_SORT_HPP
+#define SMART_SORT_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "counting_sort.hpp"
+#include "introsort.hpp"
+#include "pdq_sort.hpp"
+#include "radix_sort.hpp"
+#include "sorting_network.hpp"
+#include "tim_sort.hpp"
+#include "utils.hpp"
+
+using std::vector;
+
+// Number of consecutive elements in every sampled block
+const size_t SMART_SORT_SAMPLE_BLOCK = 8;
+
+// At most 1 in this many elements is sampled
+const size_t SMART_SORT_SAMPLE_FRACTION = 8;
+
+// Size of the ranges that calibrate_smart_sort times by default
+const size_t SMART_SORT_CALIBRATION_SIZE = size_t(1) << 18;
+
+// Number of times calibrate_smart_sort times every sort, keeping the fastest
+const int SMART_SORT_CALIBRATION_RUNS = 3;
+
+/*
+    SmartSortThresholds
+    -------------------
+    The crossover points between the algorithms that smart_sort picks. The
+    defaults were measured by calibrate_smart_sort on an x86-64 machine.
+*/
+struct SmartSortThresholds {
+    // Smaller ranges are introsorted without being sampled
+    size_t sampling_min_size = 64;
+
+    // Most elements sampled
+    size_t sample_size = 256;
+
+    // Ranges are tim sorted if fewer than this fraction of adjacent sampled
+    // elements are descending (or ascending), i.e. the runs are long
+    double tim_sort_max_descent_ratio = 0.04;
+
+    // Integers are counting sorted if their range is below this many times
+    // their number
+    double counting_sort_max_range_ratio = 0.5;
+
+    // Smaller ranges of arithmetic keys are not radix sorted
+    size_t radix_sort_min_size = 2048;
+
+    // Smaller ranges are introsorted instead of pdq sorted, unless they have
+    // many duplicates
+    size_t pdq_sort_min_size = 2048;
+
+    // Fraction of duplicates in the sample, from which pdqsort is used
+    double pdq_sort_min_duplicate_ratio = 0.5;
+};
+
+/*
+    for_each_threshold
+    ------------------
+    Calls visit with the name and a reference to each of the thresholds.
+*/
+template <typename Thresholds, typename Visit>
+void for_each_threshold(Thresholds& thresholds, Visit visit) {
+    visit("sampling_min_size", thresholds.sampling_min_size);
+    visit("sample_size", thresholds.sample_size);
+    visit("tim_sort_max_descent_ratio", thresholds.tim_sort_max_descent_ratio);
+    visit("counting_sort_max_range_ratio", thresholds.counting_sort_max_range_ratio);
+    visit("radix_sort_min_size", thresholds.radix_sort_min_size);
+    visit("pdq_sort_min_size", thresholds.pdq_sort_min_size);
+    visit("pdq_sort_min_duplicate_ratio", thresholds.pdq_sort_min_duplicate_ratio);
+}
+
+/*
+    write_threshold
+    ---------------
+    Writes a "name value" line to output, with doubles in full precision.
+*/
+void write_threshold(std::FILE* output, const char* name, const size_t value) {
+    std::fprintf(output, "%s %zu\n", name, value);
+}
+
+void write_threshold(std::FILE* output, const char* name, const double value) {
+    std::fprintf(output, "%s %.17g\n", name, value);
+}
+
+/*
+    save_smart_sort_thresholds
+    --------------------------
+    Writes the thresholds to output, one "name value" line each, or to the
+    file at path. Throws std::runtime_error if the file cannot be written.
+*/
+void save_smart_sort_thresholds(const SmartSortThresholds& thresholds, std::FILE* output) {
+    for_each_threshold(thresholds, [&](const char* name, const auto& value) {
+        write_threshold(output, name, value);
+    });
+    if (std::ferror(output))
+        throw std::runtime_error("smart sort: write failed");
+}
+
+void save_smart_sort_thresholds(const SmartSortThresholds& thresholds, const std::string& path) {
+    FileHandle output = open_values_file(path, "w");
+    save_smart_sort_thresholds(thresholds, output.get());
+    if (std::fflush(output.get()) != 0)
+        throw std::runtime_error("smart sort: cannot write " + path);
+}
+
+/*
+    load_smart_sort_thresholds
+    --------------------------
+    Reads thresholds written by save_smart_sort_thresholds from input, or
+    from the file at path. Thresholds that are missing keep their defaults.
+    Throws std::runtime_error if a line cannot be parsed (including anything
+    but blanks after the value) or names an unknown threshold, or if the file
+    cannot be read.
+*/
+SmartSortThresholds load_smart_sort_thresholds(std::FILE* input) {
+    const std::string text = read_text(input);
+    const char* const blanks = " \t\r";
+
+    SmartSortThresholds thresholds;
+    size_t line_begin = 0;
+    while (line_begin < text.size()) {
+        const size_t line_end = std::min(text.find('\n', line_begin), text.size());
+        const std::string line = text.substr(line_begin, line_end - line_begin);
+        line_begin = line_end + 1;
+
+        const size_t name_begin = line.find_first_not_of(blanks);
+        if (name_begin == std::string::npos)
+            continue;
+        const size_t name_end = std::min(line.find_first_of(blanks, name_begin), line.size());
+        const std::string name = line.substr(name_begin, name_end - name_begin);
+        const char* value_text = line.c_str() + name_end;
+        while (*value_text == ' ' or *value_text == '\t')
+            value_text++;
+
+        bool is_known = false;
+        for_each_threshold(thresholds, [&](const char* threshold_name, auto& value) {
+            using Threshold = typename std::decay<decltype(value)>::type;
+            if (name != threshold_name)
+                return;
+            is_known = true;
+            const char* const value_end = parse_value(value_text, value, std::is_integral<Threshold>());
+            if (value_end == nullptr or line.find_first_not_of(blanks, value_end - line.c_str()) != std::string::npos)
+                throw std::runtime_error("smart sort: invalid value for " + name);
+        });
+        if (!is_known)
+            throw std::runtime_error("smart sort: unknown threshold " + name);
+    }
+    return thresholds;
+}
+
+SmartSortThresholds load_smart_sort_thresholds(const std::string& path) {
+    FileHandle input = open_values_file(path, "r");
+    return load_smart_sort_thresholds(input.get());
+}
+
+/*
+    SortStatistics
+    --------------
+    What sample_statistics estimates about a range from its sample.
+*/
+struct SortStatistics {
+    size_t size = 0;
+
+    // Fraction of adjacent sampled elements that are descending: 0 for a
+    // sorted range, 1 for a strictly reversed one, about 1/2 for random ones
+    double descent_ratio = 0;
+
+    // Fraction of sampled elements equal to another sampled element
+    double duplicate_ratio = 0;
+
+    // Difference between the largest and smallest sampled keys, for
+    // arithmetic elements
+    double key_range = 0;
+};
+
+/*
+    HasRadixKeys
+    ------------
+    Whether ranges of Value sorted by Compare can be counting or radix sorted
+    instead: integers (but not bool) or floating point numbers, ordered by
+    std::less or std::greater (see IsStandardOrder).
+*/
+template <typename Value, typename Compare>
+struct HasRadixKeys : std::integral_constant<bool, IsStandardOrder<Value, Compare>::value and
+    ((std::is_integral<Value>::value and !std::is_same<Value, bool>::value) or
+     std::is_same<Value, float>::value or std::is_same<Value, double>::value)> {};
+
+/*
+    sampled_key_range
+    -----------------
+    Returns the difference between the first and last of the sampled
+    elements, which are sorted, if they are arithmetic; otherwise 0.
+*/
+template <typename RandomIt>
+double sampled_key_range(const vector<RandomIt>& sample, std::true_type /* radix keys */) {
+    const double range = double(*sample.back()) - double(*sample.front());
+    return range < 0 ? -range : range;
+}
+
+template <typename RandomIt>
+double sampled_key_range(const vector<RandomIt>&, std::false_type /* radix keys */) {
+    return 0;
+}
+
+/*
+    sample_statistics
+    -----------------
+    Estimates the statistics of [first, last) from about sample_size of its
+    elements, in blocks of SMART_SORT_SAMPLE_BLOCK consecutive elements that
+    are spread evenly over the range, whose adjacent elements tell about the
+    runs.
+*/
+template <typename RandomIt, typename Compare>
+SortStatistics sample_statistics(RandomIt first, RandomIt last, Compare comp, const size_t sample_size) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    SortStatistics stats;
+    stats.size = last - first;
+    if (stats.size < 2)
+        return stats;
+
+    const size_t block_size = std::min(SMART_SORT_SAMPLE_BLOCK, stats.size);
+    const size_t num_blocks = std::max(size_t(1), std::min(sample_size, stats.size) / block_size);
+    const size_t spacing = num_blocks > 1 ? (stats.size - block_size) / (num_blocks - 1) : 0;
+
+    vector<RandomIt> sample;
+    sample.reserve(num_blocks * block_size);
+    size_t descents = 0;
+    for (size_t block = 0; block < num_blocks; block++) {
+        const RandomIt block_first = first + block * spacing;
+        sample.push_back(block_first);
+        for (RandomIt it = block_first + 1; it != block_first + block_size; ++it) {
+            descents += comp(*it, *(it - 1));
+            sample.push_back(it);
+        }
+    }
+    stats.descent_ratio = double(descents) / double(num_blocks * (block_size - 1));
+
+    introsort(sample.begin(), sample.end(), [&](RandomIt a, RandomIt b) { return comp(*a, *b); });
+    size_t duplicates = 0;
+    for (size_t i = 1; i < sample.size(); i++) {
+        if (!comp(*sample[i - 1], *sample[i]))
+            duplicates += 1 + (i == 1 or comp(*sample[i - 2], *sample[i - 1]));
+    }
+    stats.duplicate_ratio = double(duplicates) / double(sample.size());
+    stats.key_range = sampled_key_range(sample, HasRadixKeys<Value, Compare>());
+
+    return stats;
+}
+
+/*
+    SmartSortChoice
+    ---------------
+    The algorithms that smart_sort chooses from.
+*/
+enum SmartSortChoice {
+    USE_INTROSORT,
+    USE_PDQ_SORT,
+    USE_TIM_SORT,
+    USE_COUNTING_SORT,
+    USE_RADIX_SORT
+};
+
+/*
+    choose_smart_sort
+    -----------------
+    Returns the algorithm that smart_sort uses for a range with the given
+    statistics, given whether its elements can be radix sorted, and whether
+    they are integers.
+*/
+SmartSortChoice choose_smart_sort(const SortStatistics& stats, const SmartSortThresholds& thresholds,
+                                  const bool has_radix_keys, const bool has_integer_keys) {
+    if (stats.size < thresholds.sampling_min_size)
+        return USE_INTROSORT;
+
+    const double descents = std::min(stats.descent_ratio, 1 - stats.descent_ratio);
+    if (descents < thresholds.tim_sort_max_descent_ratio)
+        return USE_TIM_SORT;
+
+    if (has_integer_keys and stats.key_range < thresholds.counting_sort_max_range_ratio * double(stats.size))
+        return USE_COUNTING_SORT;
+    if (has_radix_keys and stats.size >= thresholds.radix_sort_min_size)
+        return USE_RADIX_SORT;
+
+    if (stats.size >= thresholds.pdq_sort_min_size or
+        stats.duplicate_ratio >= thresholds.pdq_sort_min_duplicate_ratio)
+        return USE_PDQ_SORT;
+    return USE_INTROSORT;
+}
+
+/*
+    counting_or_radix_sort
+    ----------------------
+    Counting sorts integers, and radix sorts floating point numbers, which
+    cannot be counted.
+*/
+template <typename RandomIt>
+void counting_or_radix_sort(RandomIt first, RandomIt last, const int order, std::true_type /* integers */) {
+    counting_sort(first, last, RadixIdentity(), order);
+}
+
+template <typename RandomIt>
+void counting_or_radix_sort(RandomIt first, RandomIt last, const int order, std::false_type /* integers */) {
+    radix_sort(first, last, RadixIdentity(), order);
+}
+
+/*
+    sort_with
+    ---------
+    Sorts [first, last) according to comp with the chosen algorithm. Ranges
+    without radix keys are only ever comparison sorted.
+*/
+template <typename RandomIt, typename Compare>
+void sort_with(const SmartSortChoice choice, RandomIt first, RandomIt last, Compare comp,
+               std::false_type /* radix keys */) {
+    if (choice == USE_TIM_SORT)
+        tim_sort(first, last, comp);
+    else if (choice == USE_PDQ_SORT)
+        pdq_sort(first, last, comp);
+    else
+        introsort(first, last, comp);
+}
+
+template <typename RandomIt, typename Compare>
+void sort_with(const SmartSortChoice choice, RandomIt first, RandomIt last, Compare comp,
+               std::true_type /* radix keys */) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    const int order = IsReverseOrder<Compare>::value ? -1 : 1;
+
+    if (choice == USE_COUNTING_SORT)
+        counting_or_radix_sort(first, last, order, std::is_integral<Value>());
+    else if (choice == USE_RADIX_SORT)
+        radix_sort(first, last, RadixIdentity(), order);
+    else
+        sort_with(choice, first, last, comp, std::false_type());
+}
+
+/*
+    smart_sort
+    ----------
+    Sorts the range [first, last) according to comp, with the algorithm that
+    choose_smart_sort picks from a sample of it. The sort is not stable.
+*/
+template <typename RandomIt, typename Compare = std::less<>>
+void smart_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                const SmartSortThresholds& thresholds = SmartSortThresholds()) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    using RadixKeys = HasRadixKeys<Value, Compare>;
+
+    const size_t size = last - first;
+    if (size < thresholds.sampling_min_size) {
+        introsort(first, last, comp);
+        return;
+    }
+
+    const size_t sample_size = std::min(thresholds.sample_size, size / SMART_SORT_SAMPLE_FRACTION);
+    const SortStatistics stats = sample_statistics(first, last, comp, sample_size);
+    const SmartSortChoice choice = choose_smart_sort(stats, thresholds, RadixKeys::value,
+                                                     RadixKeys::value and std::is_integral<Value>::value);
+    sort_with(choice, first, last, comp, RadixKeys());
+}
+
+/*
+    time_sort
+    ---------
+    Returns the fastest of SMART_SORT_CALIBRATION_RUNS times, in seconds,
+    that sort_range takes to sort copies of input, which are sorted in
+    batches of at least min_batch_size elements in total, so that small
+    ranges are timed accurately.
+*/
+template <typename SortRange>
+double time_sort(const vector<int32_t>& input, SortRange sort_range, const size_t min_batch_size) {
+    const size_t num_copies = std::max(size_t(1), min_batch_size / std::max(size_t(1), input.size()));
+    double fastest = std::numeric_limits<double>::max();
+
+    for (int run = 0; run < SMART_SORT_CALIBRATION_RUNS; run++) {
+        vector<vector<int32_t>> copies(num_copies, input);
+        const auto start = std::chrono::steady_clock::now();
+        for (vector<int32_t>& copy : copies)
+            sort_range(copy.begin(), copy.end());
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        fastest = std::min(fastest, elapsed.count());
+    }
+    return fastest;
+}
+
+/*
+    time_alternative_sort
+    ---------------------
+    Returns the time that the faster of pdqsort and radix sort, which
+    smart_sort would otherwise pick for integers, takes to sort input.
+*/
+double time_alternative_sort(const vector<int32_t>& input, const size_t min_batch_size) {
+    using Iterator = vector<int32_t>::iterator;
+    return std::min(
+        time_sort(input, [](Iterator first, Iterator last) { pdq_sort(first, last); }, min_batch_size),
+        time_sort(input, [](Iterator first, Iterator last) { radix_sort(first, last); }, min_batch_size));
+}
+
+/*
+    calibrate_tim_sort_ratio
+    ------------------------
+    Returns the threshold, on the statistic that ratio_of returns, below
+    which tim sort is faster than the alternative, for ranges of integers
+    that make_input makes with increasing amounts of disorder (from 0 to
+    max_level). tim_sort_wins(input) tells whether tim sort sorts input
+    faster. The threshold lies halfway between the last ratio at which tim
+    sort wins and the first at which it loses.
+*/
+template <typename MakeInput, typename RatioOf, typename TimSortWins>
+double calibrate_tim_sort_ratio(const int max_level, MakeInput make_input, RatioOf ratio_of,
+                                TimSortWins tim_sort_wins, const SmartSortThresholds& thresholds) {
+    double winning_ratio = 0;
+
+    for (int level = 0; level <= max_level; level++) {
+        const vector<int32_t> input = make_input(level);
+        const size_t sample_size = std::min(thresholds.sample_size, input.size() / SMART_SORT_SAMPLE_FRACTION);
+        const SortStatistics stats = sample_statistics(input.begin(), input.end(), std::less<>(), sample_size);
+        const double ratio = std::min(ratio_of(stats), 1 - ratio_of(stats));
+
+        if (!tim_sort_wins(input))
+            return (winning_ratio + ratio) / 2;
+        winning_ratio = ratio;
+    }
+    return 0.5;
+}
+
+/*
+    calibrate_smart_sort
+    --------------------
+    Measures the thresholds of smart_sort on this machine, by timing the
+    candidate algorithms on random 32 bit integers, in ranges of up to
+    max_size elements. Takes a few seconds with optimizations. The sampling
+    thresholds, and the fraction of duplicates from which pdqsort is used
+    for small ranges, keep their defaults.
+*/
+SmartSortThresholds calibrate_smart_sort(const size_t max_size = SMART_SORT_CALIBRATION_SIZE) {
+    using Iterator = vector<int32_t>::iterator;
+    const size_t size = std::max(max_size, size_t(2) * SMART_SORT_SAMPLE_FRACTION * SMART_SORT_SAMPLE_BLOCK);
+    std::mt19937 generator;
+    SmartSortThresholds thresholds;
+
+    auto random_input = [&](const size_t input_size, const uint32_t range) {
+        vector<int32_t> input(input_size);
+        for (int32_t& value : input)
+            value = int32_t(range == 0 ? generator() : generator() % range);
+        return input;
+    };
+
+    // The sizes from which pdqsort beats introsort, and radix sort beats
+    // both, at every larger size. Wins at single small sizes are noise.
+    thresholds.pdq_sort_min_size = size;
+    thresholds.radix_sort_min_size = size;
+    for (size_t input_size = 16; input_size < size; input_size *= 2) {
+        const vector<int32_t> input = random_input(input_size, 0);
+        const double introsort_time = time_sort(input, [](Iterator first, Iterator last) { introsort(first, last); }, size);
+        const double pdq_sort_time = time_sort(input, [](Iterator first, Iterator last) { pdq_sort(first, last); }, size);
+        const double radix_sort_time = time_sort(input, [](Iterator first, Iterator last) { radix_sort(first, last); }, size);
+
+        if (pdq_sort_time >= introsort_time)
+            thresholds.pdq_sort_min_size = size;
+        else if (thresholds.pdq_sort_min_size == size)
+            thresholds.pdq_sort_min_size = input_size;
+
+        if (radix_sort_time >= std::min(introsort_time, pdq_sort_time))
+            thresholds.radix_sort_min_size = size;
+        else if (thresholds.radix_sort_min_size == size)
+            thresholds.radix_sort_min_size = input_size;
+    }
+
+    // The largest ratio of key range to size up to which counting sort beats
+    // radix sort. Larger ranges are radix sorted by counting_sort itself.
+    thresholds.counting_sort_max_range_ratio = 0;
+    for (double ratio = double(COUNTING_SORT_RANGE_FACTOR); ratio >= 1.0 / 16; ratio /= 2) {
+        const vector<int32_t> input = random_input(size, uint32_t(std::max(1.0, ratio * double(size))));
+        const double counting_sort_time = time_sort(input, [](Iterator first, Iterator last) { counting_sort(first, last); }, size);
+        if (counting_sort_time < time_sort(input, [](Iterator first, Iterator last) { radix_sort(first, last); }, size)) {
+            thresholds.counting_sort_max_range_ratio = ratio;
+            break;
+        }
+    }
+
+    // Sorted ranges with more and more elements swapped at random, which
+    // breaks up the runs
+    auto tim_sort_wins = [&](const vector<int32_t>& input) {
+        const double tim_sort_time = time_sort(input, [](Iterator first, Iterator last) { tim_sort(first, last); }, size);
+        return tim_sort_time < time_alternative_sort(input, size);
+    };
+    vector<int32_t> sorted = random_input(size, 0);
+    introsort(sorted.begin(), sorted.end());
+    thresholds.tim_sort_max_descent_ratio = calibrate_tim_sort_ratio(10, [&](const int level) {
+        vector<int32_t> input = sorted;
+        const size_t num_swaps = level == 0 ? 0 : size >> (12 - level);
+        for (size_t i = 0; i < num_swaps; i++)
+            std::swap(input[generator() % size], input[generator() % size]);
+        return input;
+    }, [](const SortStatistics& stats) { return stats.descent_ratio; }, tim_sort_wins, thresholds);
+
+    return thresholds;
+}
+
+/*
+    calibrated_smart_sort_thresholds
+    --------------------------------
+    Returns the thresholds saved in the file at path, or calibrates them and
+    saves them there if there is no such file, so that the machine is
+    benchmarked only once.
+*/
+SmartSortThresholds calibrated_smart_sort_thresholds(const std::string& path,
+                                                     const size_t max_size = SMART_SORT_CALIBRATION_SIZE) {
+    FileHandle saved(std::fopen(path.c_str(), "r"));
+    if (saved)
+        return load_smart_sort_thresholds(saved.get());
+
+    const SmartSortThresholds thresholds = calibrate_smart_sort(max_size);
+    save_smart_sort_thresholds(thresholds, path);
+    return thresholds;
+}
+
+/*
+    smart_sort
+    ----------
+    Wrapper function. Only the sorted values are shown, since the algorithm
+    used varies.
+*/
+void smart_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    if (order == -1)
+        smart_sort(values.begin(), values.end(), std::greater<int>());
+    else
+        smart_sort(values.begin(), values.end(), std::less<int>());
+
+    if (to_show_state)
+        display_state(values);
+}
+
+#endif // SMART_SORT_HPP
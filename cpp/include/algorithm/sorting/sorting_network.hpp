@@ -0,0 +1,718 @@
+/*
+    Sorting networks
+    ----------------
+    Bitonic sorting networks for 8, 16, 32 or 64 keys of 32 bits. A sorting
+    network is a fixed sequence of compare-exchanges, independent of the data,
+    so it has no branches to mispredict, and many compare-exchanges can run
+    side by side in SIMD registers: one min and one max instruction sort 8
+    (AVX2) or 16 (AVX-512) pairs at once.
+
+    A bitonic sort of 2^K keys sorts both halves in opposite directions,
+    which makes the whole sequence bitonic (first ascending, then
+    descending), and merges it by compare-exchanging keys at distances 2^(K-1),
+    2^(K-2), ..., 1. Compare-exchanges of keys at least a vector apart are
+    done between whole vectors, and those within a vector by permuting its
+    lanes and blending the minima and maxima.
+
+    The SIMD networks are compiled when AVX2 or AVX-512 is enabled, e.g. with
+    -mavx2 or -march=native. Otherwise, the same networks run on scalars.
+    With SIMD, quick, merge and bucket sort use the networks to sort small
+    ranges of 32 bit integers, in place of insertion sort.
+
+    Sorted ranges of 32 or 64 bit integers are merged the same way, a vector
+    at a time: two sorted vectors make a bitonic sequence once one of them is
+    reversed, and a bitonic merge network splits it into its smaller and its
+    larger half. Merge sort uses this merge for such ranges.
+
+    Time complexity
+    ---------------
+    O(N * log(N)^2) compare-exchanges, where N is the network size.
+
+    Space complexity
+    ----------------
+    O(1), or O(N) for the padded copy of sizes that are not powers of two.
+*/
+
+#ifndef SORTING_NETWORK_HPP
+#define SORTING_NETWORK_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "insertion_sort.hpp"
+#include "utils.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SORTING_NETWORK_SIMD 1
+#else
+#define SORTING_NETWORK_SIMD 0
+#endif
+
+using std::vector;
+
+// Largest network, and largest range sorted by padding to a network size
+const size_t SORTING_NETWORK_MAX_SIZE = 64;
+
+/*
+    bitonic_sort_scalar
+    -------------------
+    Sorts the size elements starting at first according to comp, with a
+    bitonic network of scalar compare-exchanges. size must be a power of two.
+*/
+template <typename RandomIt, typename Compare>
+void bitonic_sort_scalar(RandomIt first, const size_t size, Compare comp) {
+    for (size_t k = 2; k <= size; k *= 2) {
+        for (size_t j = k / 2; j > 0; j /= 2) {
+            for (size_t i = 0; i < size; i++) {
+                const size_t partner = i ^ j;
+                if (partner < i)
+                    continue;
+
+                // Blocks of k keys are sorted in alternating directions
+                const bool ascending = (i & k) == 0;
+                if (ascending ? comp(first[partner], first[i]) : comp(first[i], first[partner]))
+                    std::swap(first[i], first[partner]);
+            }
+        }
+    }
+}
+
+#if SORTING_NETWORK_SIMD
+/*
+    Avx2Lanes
+    ---------
+    The operations the bitonic network, and shell sort, need on 8 lanes of 32
+    bit integers.
+*/
+struct Avx2Lanes {
+    using Key = int32_t;
+    using Vector = __m256i;
+    using Mask = __m256i;
+    static const size_t width = 8;
+
+    static Vector load(const Key* keys) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys));
+    }
+
+    static void store(Key* keys, const Vector vector) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(keys), vector);
+    }
+
+    static Vector min(const Vector a, const Vector b) {
+        return _mm256_min_epi32(a, b);
+    }
+
+    static Vector max(const Vector a, const Vector b) {
+        return _mm256_max_epi32(a, b);
+    }
+
+    // Swaps every lane with the one whose index differs by the bits of j
+    static Vector swap_lanes(const Vector vector, const size_t j) {
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        return _mm256_permutevar8x32_epi32(vector, _mm256_xor_si256(lanes, _mm256_set1_epi32(int(j))));
+    }
+
+    // Lanes that keep the minimum of their pair, for keys base, base + 1, ...
+    static Mask takes_minimum(const size_t base, const size_t j, const size_t k) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i keys = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                              _mm256_set1_epi32(int(base)));
+        const __m256i is_lower = _mm256_cmpeq_epi32(_mm256_and_si256(keys, _mm256_set1_epi32(int(j))), zero);
+        const __m256i ascending = _mm256_cmpeq_epi32(_mm256_and_si256(keys, _mm256_set1_epi32(int(k))), zero);
+        return _mm256_cmpeq_epi32(is_lower, ascending);
+    }
+
+    static Vector blend(const Mask takes_minimum, const Vector minimum, const Vector maximum) {
+        return _mm256_blendv_epi8(maximum, minimum, takes_minimum);
+    }
+
+    // Whether all lanes of a and b are equal
+    static bool equal(const Vector a, const Vector b) {
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi32(a, b)) == -1;
+    }
+};
+#endif
+
+#if SORTING_NETWORK_SIMD && defined(__AVX512F__)
+/*
+    Avx512Lanes
+    -----------
+    The operations the bitonic network, and shell sort, need on 16 lanes of
+    32 bit integers.
+*/
+struct Avx512Lanes {
+    using Key = int32_t;
+    using Vector = __m512i;
+    using Mask = __mmask16;
+    static const size_t width = 16;
+
+    static Vector load(const Key* keys) {
+        return _mm512_loadu_si512(keys);
+    }
+
+    static void store(Key* keys, const Vector vector) {
+        _mm512_storeu_si512(keys, vector);
+    }
+
+    static Vector min(const Vector a, const Vector b) {
+        return _mm512_min_epi32(a, b);
+    }
+
+    static Vector max(const Vector a, const Vector b) {
+        return _mm512_max_epi32(a, b);
+    }
+
+    static Vector swap_lanes(const Vector vector, const size_t j) {
+        const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        return _mm512_permutexvar_epi32(_mm512_xor_si512(lanes, _mm512_set1_epi32(int(j))), vector);
+    }
+
+    static Mask takes_minimum(const size_t base, const size_t j, const size_t k) {
+        const __m512i zero = _mm512_setzero_si512();
+        const __m512i keys = _mm512_add_epi32(
+            _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+            _mm512_set1_epi32(int(base)));
+        const Mask is_lower = _mm512_cmpeq_epi32_mask(_mm512_and_si512(keys, _mm512_set1_epi32(int(j))), zero);
+        const Mask ascending = _mm512_cmpeq_epi32_mask(_mm512_and_si512(keys, _mm512_set1_epi32(int(k))), zero);
+        return Mask(~(is_lower ^ ascending));
+    }
+
+    static Vector blend(const Mask takes_minimum, const Vector minimum, const Vector maximum) {
+        return _mm512_mask_blend_epi32(takes_minimum, maximum, minimum);
+    }
+
+    static bool equal(const Vector a, const Vector b) {
+        return _mm512_cmpeq_epi32_mask(a, b) == 0xFFFF;
+    }
+};
+#endif
+
+#if SORTING_NETWORK_SIMD
+/*
+    Avx2Lanes64
+    -----------
+    The same operations on 4 lanes of 64 bit integers. AVX2 has no 64 bit
+    minimum and maximum, so they are blended from a comparison.
+*/
+struct Avx2Lanes64 {
+    using Key = int64_t;
+    using Vector = __m256i;
+    using Mask = __m256i;
+    static const size_t width = 4;
+
+    static Vector load(const Key* keys) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys));
+    }
+
+    static void store(Key* keys, const Vector vector) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(keys), vector);
+    }
+
+    static Vector min(const Vector a, const Vector b) {
+        return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+    }
+
+    static Vector max(const Vector a, const Vector b) {
+        return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+    }
+
+    // Lane i is made of the 32 bit lanes 2i and 2i + 1, so j is doubled
+    static Vector swap_lanes(const Vector vector, const size_t j) {
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        return _mm256_permutevar8x32_epi32(vector, _mm256_xor_si256(lanes, _mm256_set1_epi32(int(2 * j))));
+    }
+
+    static Mask takes_minimum(const size_t base, const size_t j, const size_t k) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i keys = _mm256_add_epi64(_mm256_setr_epi64x(0, 1, 2, 3),
+                                              _mm256_set1_epi64x((long long) base));
+        const __m256i is_lower = _mm256_cmpeq_epi64(_mm256_and_si256(keys, _mm256_set1_epi64x((long long) j)), zero);
+        const __m256i ascending = _mm256_cmpeq_epi64(_mm256_and_si256(keys, _mm256_set1_epi64x((long long) k)), zero);
+        return _mm256_cmpeq_epi64(is_lower, ascending);
+    }
+
+    static Vector blend(const Mask takes_minimum, const Vector minimum, const Vector maximum) {
+        return _mm256_blendv_epi8(maximum, minimum, takes_minimum);
+    }
+};
+#endif
+
+#if SORTING_NETWORK_SIMD && defined(__AVX512F__)
+/*
+    Avx512Lanes64
+    -------------
+    The same operations on 8 lanes of 64 bit integers.
+*/
+struct Avx512Lanes64 {
+    using Key = int64_t;
+    using Vector = __m512i;
+    using Mask = __mmask8;
+    static const size_t width = 8;
+
+    static Vector load(const Key* keys) {
+        return _mm512_loadu_si512(keys);
+    }
+
+    static void store(Key* keys, const Vector vector) {
+        _mm512_storeu_si512(keys, vector);
+    }
+
+    static Vector min(const Vector a, const Vector b) {
+        return _mm512_min_epi64(a, b);
+    }
+
+    static Vector max(const Vector a, const Vector b) {
+        return _mm512_max_epi64(a, b);
+    }
+
+    static Vector swap_lanes(const Vector vector, const size_t j) {
+        const __m512i lanes = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+        return _mm512_permutexvar_epi64(_mm512_xor_si512(lanes, _mm512_set1_epi64((long long) j)), vector);
+    }
+
+    static Mask takes_minimum(const size_t base, const size_t j, const size_t k) {
+        const __m512i zero = _mm512_setzero_si512();
+        const __m512i keys = _mm512_add_epi64(_mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0),
+                                              _mm512_set1_epi64((long long) base));
+        const Mask is_lower = _mm512_cmpeq_epi64_mask(_mm512_and_si512(keys, _mm512_set1_epi64((long long) j)), zero);
+        const Mask ascending = _mm512_cmpeq_epi64_mask(_mm512_and_si512(keys, _mm512_set1_epi64((long long) k)), zero);
+        return Mask(~(is_lower ^ ascending));
+    }
+
+    static Vector blend(const Mask takes_minimum, const Vector minimum, const Vector maximum) {
+        return _mm512_mask_blend_epi64(takes_minimum, maximum, minimum);
+    }
+};
+#endif
+
+#if SORTING_NETWORK_SIMD
+/*
+    bitonic_sort_lanes
+    ------------------
+    Sorts Size keys with a bitonic network of SIMD compare-exchanges on
+    vectors of Lanes::width keys. The keys are kept in Size / width vectors.
+*/
+template <typename Lanes, size_t Size>
+void bitonic_sort_lanes(int32_t* keys) {
+    using Vector = typename Lanes::Vector;
+    const size_t width = Lanes::width;
+    const size_t num_vectors = Size / width;
+
+    Vector vectors[num_vectors];
+    for (size_t i = 0; i < num_vectors; i++)
+        vectors[i] = Lanes::load(keys + i * width);
+
+    for (size_t k = 2; k <= Size; k *= 2) {
+        for (size_t j = k / 2; j > 0; j /= 2) {
+            if (j >= width) {
+                // Keys j apart are in the same lanes of different vectors
+                for (size_t i = 0; i < num_vectors; i++) {
+                    const size_t partner = i ^ (j / width);
+                    if (partner < i)
+                        continue;
+
+                    const Vector minimum = Lanes::min(vectors[i], vectors[partner]);
+                    const Vector maximum = Lanes::max(vectors[i], vectors[partner]);
+                    const bool ascending = ((i * width) & k) == 0;
+                    vectors[i] = ascending ? minimum : maximum;
+                    vectors[partner] = ascending ? maximum : minimum;
+                }
+            }
+            else {
+                // Keys j apart are in the same vector
+                for (size_t i = 0; i < num_vectors; i++) {
+                    const Vector swapped = Lanes::swap_lanes(vectors[i], j);
+                    vectors[i] = Lanes::blend(Lanes::takes_minimum(i * width, j, k),
+                                              Lanes::min(vectors[i], swapped),
+                                              Lanes::max(vectors[i], swapped));
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < num_vectors; i++)
+        Lanes::store(keys + i * width, vectors[i]);
+}
+#endif
+
+/*
+    bitonic_sort_network
+    --------------------
+    Sorts Size keys with the widest SIMD network that Size fills, or with
+    scalar compare-exchanges if SIMD is not enabled.
+*/
+template <size_t Size>
+void bitonic_sort_network(int32_t* keys, std::false_type /* fills AVX-512 vectors */) {
+#if SORTING_NETWORK_SIMD
+    bitonic_sort_lanes<Avx2Lanes, Size>(keys);
+#else
+    bitonic_sort_scalar(keys, Size, std::less<int32_t>());
+#endif
+}
+
+template <size_t Size>
+void bitonic_sort_network(int32_t* keys, std::true_type /* fills AVX-512 vectors */) {
+#if SORTING_NETWORK_SIMD && defined(__AVX512F__)
+    bitonic_sort_lanes<Avx512Lanes, Size>(keys);
+#else
+    bitonic_sort_network<Size>(keys, std::false_type());
+#endif
+}
+
+/*
+    sorting_network_sort
+    --------------------
+    Sorts exactly Size (8, 16, 32 or 64) keys in ascending order.
+*/
+template <size_t Size>
+void sorting_network_sort(int32_t* keys) {
+    static_assert(Size == 8 or Size == 16 or Size == 32 or Size == 64,
+                  "sorting networks have 8, 16, 32 or 64 keys");
+    bitonic_sort_network<Size>(keys, std::integral_constant<bool, (Size >= 16)>());
+}
+
+/*
+    sorting_network_sort
+    --------------------
+    Sorts size keys in ascending order. Up to SORTING_NETWORK_MAX_SIZE keys
+    are copied into the smallest network that fits them, with the unused keys
+    set to the maximum value, which sorts them to the end. More keys than
+    that are insertion sorted.
+*/
+void sorting_network_sort(int32_t* keys, const size_t size) {
+    if (size < 2)
+        return;
+    if (size > SORTING_NETWORK_MAX_SIZE) {
+        insertion_sort(keys, keys + size);
+        return;
+    }
+
+    int32_t padded[SORTING_NETWORK_MAX_SIZE];
+    size_t network_size = 8;
+    while (network_size < size)
+        network_size *= 2;
+
+    std::copy(keys, keys + size, padded);
+    std::fill(padded + size, padded + network_size, std::numeric_limits<int32_t>::max());
+
+    switch (network_size) {
+        case 8:
+            sorting_network_sort<8>(padded);
+            break;
+        case 16:
+            sorting_network_sort<16>(padded);
+            break;
+        case 32:
+            sorting_network_sort<32>(padded);
+            break;
+        default:
+            sorting_network_sort<64>(padded);
+            break;
+    }
+
+    std::copy(padded, padded + size, keys);
+}
+
+/*
+    sorting_network_sort
+    --------------------
+    Sorts size unsigned keys, with a network up to SORTING_NETWORK_MAX_SIZE
+    keys. Flipping the sign bit maps them to signed keys in the same order.
+*/
+void sorting_network_sort(uint32_t* keys, const size_t size) {
+    if (size > SORTING_NETWORK_MAX_SIZE) {
+        insertion_sort(keys, keys + size);
+        return;
+    }
+
+    int32_t signed_keys[SORTING_NETWORK_MAX_SIZE];
+    for (size_t i = 0; i < size; i++)
+        signed_keys[i] = int32_t(keys[i] ^ 0x80000000u);
+
+    sorting_network_sort(signed_keys, size);
+
+    for (size_t i = 0; i < size; i++)
+        keys[i] = uint32_t(signed_keys[i]) ^ 0x80000000u;
+}
+
+/*
+    sorting_network_sort
+    --------------------
+    Sorts size floats, which must not be NaN, with a network up to
+    SORTING_NETWORK_MAX_SIZE keys. Flipping all but the sign bit of negative
+    floats maps them to signed integers in the same order (with -0.0 before
+    0.0).
+*/
+void sorting_network_sort(float* keys, const size_t size) {
+    static_assert(sizeof(float) == sizeof(int32_t), "float must be 32 bits wide");
+
+    if (size > SORTING_NETWORK_MAX_SIZE) {
+        insertion_sort(keys, keys + size);
+        return;
+    }
+
+    int32_t signed_keys[SORTING_NETWORK_MAX_SIZE];
+    for (size_t i = 0; i < size; i++) {
+        std::memcpy(&signed_keys[i], &keys[i], sizeof(float));
+        signed_keys[i] ^= (signed_keys[i] >> 31) & 0x7FFFFFFF;
+    }
+
+    sorting_network_sort(signed_keys, size);
+
+    for (size_t i = 0; i < size; i++) {
+        signed_keys[i] ^= (signed_keys[i] >> 31) & 0x7FFFFFFF;
+        std::memcpy(&keys[i], &signed_keys[i], sizeof(float));
+    }
+}
+
+/*
+    sort_tiny_arrays
+    ----------------
+    Sorts each of the num_arrays consecutive arrays of array_size keys
+    starting at keys (e.g. the top candidates of many queries). Arrays of
+    more than SORTING_NETWORK_MAX_SIZE keys are insertion sorted.
+*/
+template <typename Key>
+void sort_tiny_arrays(Key* keys, const size_t num_arrays, const size_t array_size) {
+    for (size_t i = 0; i < num_arrays; i++)
+        sorting_network_sort(keys + i * array_size, array_size);
+}
+
+/*
+    HasSortingNetwork
+    -----------------
+    Whether small_sort can sort a range with a SIMD network: the range must
+    be contiguous 32 bit integers, compared in a standard order of int32_t
+    (see IsStandardOrder), under which equal keys are indistinguishable, so
+    sorting networks being unstable doesn't matter.
+*/
+template <typename RandomIt, typename Compare>
+struct HasSortingNetwork : std::integral_constant<bool,
+    SORTING_NETWORK_SIMD and IsStandardOrder<int32_t, Compare>::value and
+    (std::is_same<RandomIt, int32_t*>::value or
+     std::is_same<RandomIt, vector<int32_t>::iterator>::value)> {};
+
+/*
+    small_sort
+    ----------
+    Sorts a small range according to comp: with a sorting network if it has
+    one (see HasSortingNetwork), otherwise with insertion sort.
+*/
+template <typename RandomIt, typename Compare>
+void small_sort(RandomIt first, RandomIt last, Compare comp, std::false_type /* has network */) {
+    insertion_sort(first, last, comp);
+}
+
+template <typename RandomIt, typename Compare>
+void small_sort(RandomIt first, RandomIt last, Compare comp, std::true_type /* has network */) {
+    const size_t size = last - first;
+    if (size > SORTING_NETWORK_MAX_SIZE) {
+        insertion_sort(first, last, comp);
+        return;
+    }
+
+    sorting_network_sort(&*first, size);
+    if (IsReverseOrder<Compare>::value)
+        std::reverse(first, last);
+}
+
+template <typename RandomIt, typename Compare>
+void small_sort(RandomIt first, RandomIt last, Compare comp) {
+    small_sort(first, last, comp, HasSortingNetwork<RandomIt, Compare>());
+}
+
+/*
+    merge_branchless
+    ----------------
+    Merges the sorted ranges [first1, last1) and [first2, last2) into the
+    range starting at out, in ascending order, or descending if Descending,
+    taking keys from the first range on ties. The next key is selected
+    arithmetically rather than by a branch, which mispredicts about every
+    other time on random keys. Returns the end of the output range.
+*/
+template <bool Descending, typename Key>
+Key* merge_branchless(const Key* first1, const Key* last1, const Key* first2, const Key* last2, Key* out) {
+    while (first1 != last1 and first2 != last2) {
+        const bool take_second = Descending ? *first1 < *first2 : *first2 < *first1;
+        *out++ = take_second ? *first2 : *first1;
+        first2 += take_second;
+        first1 += !take_second;
+    }
+
+    out = std::copy(first1, last1, out);
+    return std::copy(first2, last2, out);
+}
+
+#if SORTING_NETWORK_SIMD
+/*
+    bitonic_merge_vectors
+    ---------------------
+    Merges two sorted vectors into the first and the last width keys of
+    their union, in sorted order. Reversing high makes the concatenation
+    bitonic, so the compare-exchanges at distance width split it into two
+    bitonic vectors, which are then sorted within their lanes.
+*/
+template <typename Lanes, bool Descending>
+void bitonic_merge_vectors(typename Lanes::Vector& low, typename Lanes::Vector& high) {
+    using Vector = typename Lanes::Vector;
+    const size_t width = Lanes::width;
+
+    // The keys that go first are the minima, or the maxima in descending order
+    auto front = [](const Vector a, const Vector b) { return Descending ? Lanes::max(a, b) : Lanes::min(a, b); };
+    auto back = [](const Vector a, const Vector b) { return Descending ? Lanes::min(a, b) : Lanes::max(a, b); };
+
+    const Vector reversed = Lanes::swap_lanes(high, width - 1);
+    high = back(low, reversed);
+    low = front(low, reversed);
+    for (size_t j = width / 2; j > 0; j /= 2) {
+        const Vector swapped_low = Lanes::swap_lanes(low, j);
+        const Vector swapped_high = Lanes::swap_lanes(high, j);
+        low = Lanes::blend(Lanes::takes_minimum(0, j, 0), front(low, swapped_low), back(low, swapped_low));
+        high = Lanes::blend(Lanes::takes_minimum(0, j, 0), front(high, swapped_high), back(high, swapped_high));
+    }
+}
+
+/*
+    bitonic_merge_lanes
+    -------------------
+    Merges the sorted ranges [first1, last1) and [first2, last2) into the
+    range starting at out, a vector of width keys at a time. The vector high
+    holds the width largest keys merged so far; every step loads the next
+    vector from the range whose next key goes first, merges it with high, and
+    outputs the smaller half. When that range has less than a vector left,
+    it is merged with high (in scalar code, as it is short) into a spill
+    buffer, which takes its place. Returns the end of the output range.
+*/
+template <typename Lanes, bool Descending>
+typename Lanes::Key* bitonic_merge_lanes(const typename Lanes::Key* first1, const typename Lanes::Key* last1,
+                                         const typename Lanes::Key* first2, const typename Lanes::Key* last2,
+                                         typename Lanes::Key* out) {
+    using Key = typename Lanes::Key;
+    using Vector = typename Lanes::Vector;
+    const long width = Lanes::width;
+
+    Key spill[2][2 * Lanes::width];
+    size_t spill_index = 0;
+    while (last1 - first1 >= width and last2 - first2 >= width) {
+        Vector low = Lanes::load(first1);
+        Vector high = Lanes::load(first2);
+        first1 += width;
+        first2 += width;
+
+        bool from_first;
+        while (true) {
+            bitonic_merge_vectors<Lanes, Descending>(low, high);
+            Lanes::store(out, low);
+            out += width;
+
+            from_first = first1 != last1 and
+                (first2 == last2 or !(Descending ? *first1 < *first2 : *first2 < *first1));
+            const Key*& next = from_first ? first1 : first2;
+            if ((from_first ? last1 : last2) - next < width)
+                break;
+            low = Lanes::load(next);
+            next += width;
+        }
+
+        Key* high_keys = spill[spill_index];
+        Key* merged = spill[spill_index ^ 1];
+        Lanes::store(high_keys, high);
+        if (from_first) {
+            last1 = merge_branchless<Descending>(first1, last1, high_keys, high_keys + width, merged);
+            first1 = merged;
+        }
+        else {
+            last2 = merge_branchless<Descending>(high_keys, high_keys + width, first2, last2, merged);
+            first2 = merged;
+        }
+        spill_index ^= 1;
+    }
+
+    return merge_branchless<Descending>(first1, last1, first2, last2, out);
+}
+
+template <typename Key>
+struct MergeLanes {};
+
+#if defined(__AVX512F__)
+template <>
+struct MergeLanes<int32_t> {
+    using type = Avx512Lanes;
+};
+
+template <>
+struct MergeLanes<int64_t> {
+    using type = Avx512Lanes64;
+};
+#else
+template <>
+struct MergeLanes<int32_t> {
+    using type = Avx2Lanes;
+};
+
+template <>
+struct MergeLanes<int64_t> {
+    using type = Avx2Lanes64;
+};
+#endif
+#endif
+
+/*
+    bitonic_merge
+    -------------
+    Merges the sorted ranges [first1, last1) and [first2, last2) of 32 or 64
+    bit integers into the range starting at out, which must not overlap
+    them, in the order of comp (std::less or std::greater). With SIMD, the
+    keys are merged a vector at a time by bitonic merge networks; otherwise,
+    one key at a time without branches. Returns the end of the output range.
+*/
+template <typename Key, typename Compare = std::less<>>
+Key* bitonic_merge(const Key* first1, const Key* last1, const Key* first2, const Key* last2, Key* out,
+                   Compare /* comp */ = Compare()) {
+    static_assert(std::is_same<Key, int32_t>::value or std::is_same<Key, int64_t>::value,
+                  "bitonic merge needs 32 or 64 bit integers");
+    static_assert(IsStandardOrder<Key, Compare>::value, "bitonic merge needs std::less or std::greater of Key");
+    const bool descending = IsReverseOrder<Compare>::value;
+
+#if SORTING_NETWORK_SIMD
+    return bitonic_merge_lanes<typename MergeLanes<Key>::type, descending>(first1, last1, first2, last2, out);
+#else
+    return merge_branchless<descending>(first1, last1, first2, last2, out);
+#endif
+}
+
+/*
+    HasMergeNetwork
+    ---------------
+    Whether merge_into can merge with bitonic_merge: all ranges must be
+    contiguous 32 or 64 bit integers of the same type, compared with
+    std::less or std::greater of that type (see IsStandardOrder).
+*/
+template <typename It, typename Key>
+struct IsContiguousIterator : std::integral_constant<bool,
+    std::is_same<It, Key*>::value or std::is_same<It, typename vector<Key>::iterator>::value> {};
+
+template <typename Key, typename... Its>
+struct AreContiguousIterators : std::true_type {};
+
+template <typename Key, typename It, typename... Its>
+struct AreContiguousIterators<Key, It, Its...> : std::integral_constant<bool,
+    IsContiguousIterator<It, Key>::value and AreContiguousIterators<Key, Its...>::value> {};
+
+template <typename InputIt1, typename InputIt2, typename OutputIt, typename Compare>
+struct HasMergeNetwork : std::integral_constant<bool,
+    SORTING_NETWORK_SIMD and
+    ((IsStandardOrder<int32_t, Compare>::value and
+      AreContiguousIterators<int32_t, InputIt1, InputIt2, OutputIt>::value) or
+     (IsStandardOrder<int64_t, Compare>::value and
+      AreContiguousIterators<int64_t, InputIt1, InputIt2, OutputIt>::value))> {};
+
+#endif // SORTING_NETWORK_HPP
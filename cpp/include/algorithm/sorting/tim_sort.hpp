@@ -0,0 +1,575 @@
+/*
+    Tim sort
+    --------
+    An adaptive, stable, natural merge sort (by Tim Peters). Instead of
+    splitting the input at fixed points, it scans it for runs that are already
+    sorted (strictly descending runs are reversed), extends short runs to a
+    minimum length (minrun) with binary insertion sort, and merges the runs.
+
+    The runs wait on a stack, whose lengths are kept growing at least as fast
+    as the Fibonacci numbers from the top down, which keeps the merges
+    balanced and the stack short. Merges first skip the elements that are
+    already in place, and switch to galloping (exponential search) when one
+    run keeps winning, so that long stretches are moved in bulk.
+
+    Time complexity
+    ---------------
+    O(N * log(N)) in the worst case, O(N) if the input consists of a few
+    sorted or reverse sorted runs, where N is the number of elements.
+
+    Space complexity
+    ----------------
+    O(N) in the worst case, for merging. It only needs as much space as the
+    smaller of the two runs being merged.
+*/
+
+#ifndef TIM_SORT_HPP
+#define TIM_SORT_HPP
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "utils.hpp"
+
+using std::vector;
+
+// Inputs shorter than this are binary insertion sorted, without merging
+const long TIM_SORT_MIN_MERGE = 32;
+
+// Initial number of consecutive wins of one run after which merges gallop
+const long TIM_SORT_MIN_GALLOP = 7;
+
+/*
+    compute_min_run
+    ---------------
+    Returns the minimum run length for N elements: a number between
+    TIM_SORT_MIN_MERGE / 2 and TIM_SORT_MIN_MERGE, chosen so that N / minrun
+    is a power of two, or slightly less than one. That way, runs of minrun
+    elements are merged in balanced pairs.
+*/
+long compute_min_run(long size) {
+    long remainder_bit = 0;     // becomes 1 if any bit is shifted off
+    while (size >= TIM_SORT_MIN_MERGE) {
+        remainder_bit |= size & 1;
+        size >>= 1;
+    }
+    return size + remainder_bit;
+}
+
+/*
+    count_run_and_make_ascending
+    ----------------------------
+    Returns the length of the run that starts at first: the longest prefix of
+    [first, last) that is either non-descending, or strictly descending (which
+    is reversed in place). Descending runs must be strict, or reversing them
+    would break stability.
+*/
+template <typename RandomIt, typename Compare>
+long count_run_and_make_ascending(RandomIt first, RandomIt last, Compare comp) {
+    RandomIt run_end = first + 1;
+    if (run_end == last)
+        return 1;
+
+    if (comp(*run_end, *first)) {
+        while (++run_end != last and comp(*run_end, *(run_end - 1))) {}
+        std::reverse(first, run_end);
+    }
+    else {
+        while (++run_end != last and !comp(*run_end, *(run_end - 1))) {}
+    }
+
+    return run_end - first;
+}
+
+/*
+    binary_insertion_sort
+    ---------------------
+    Sorts [first, last), of which [first, start) is already sorted, by
+    inserting every following element after all elements equal to it, found by
+    binary search.
+*/
+template <typename RandomIt, typename Compare>
+void binary_insertion_sort(RandomIt first, RandomIt last, RandomIt start, Compare comp) {
+    for (; start != last; ++start) {
+        auto pivot = std::move(*start);
+        RandomIt position = std::upper_bound(first, start, pivot, comp);
+        std::move_backward(position, start, start + 1);
+        *position = std::move(pivot);
+    }
+}
+
+/*
+    gallop_left
+    -----------
+    Returns the position at which key would be inserted into the sorted range
+    base[0 .. size), before any elements equal to it. The search starts at
+    base[hint] and probes at exponentially growing distances from there,
+    followed by a binary search, so it takes O(log(D)) comparisons, where D
+    is the distance between hint and the result.
+*/
+template <typename T, typename RandomIt, typename Compare>
+long gallop_left(const T& key, RandomIt base, const long size, const long hint, Compare comp) {
+    long last_offset = 0;
+    long offset = 1;
+
+    if (comp(base[hint], key)) {
+        // Gallop right until base[hint + last_offset] < key <= base[hint + offset]
+        const long max_offset = size - hint;
+        while (offset < max_offset and comp(base[hint + offset], key)) {
+            last_offset = offset;
+            offset = offset*2 + 1;
+        }
+        offset = std::min(offset, max_offset);
+        last_offset += hint;
+        offset += hint;
+    }
+    else {
+        // Gallop left until base[hint - offset] < key <= base[hint - last_offset]
+        const long max_offset = hint + 1;
+        while (offset < max_offset and !comp(base[hint - offset], key)) {
+            last_offset = offset;
+            offset = offset*2 + 1;
+        }
+        offset = std::min(offset, max_offset);
+        const long temp = last_offset;
+        last_offset = hint - offset;
+        offset = hint - temp;
+    }
+
+    // Now base[last_offset] < key <= base[offset]; binary search in between
+    last_offset++;
+    while (last_offset < offset) {
+        const long middle = last_offset + (offset - last_offset) / 2;
+        if (comp(base[middle], key))
+            last_offset = middle + 1;
+        else
+            offset = middle;
+    }
+    return offset;
+}
+
+/*
+    gallop_right
+    ------------
+    Like gallop_left, but returns the position after any elements equal to key.
+*/
+template <typename T, typename RandomIt, typename Compare>
+long gallop_right(const T& key, RandomIt base, const long size, const long hint, Compare comp) {
+    long last_offset = 0;
+    long offset = 1;
+
+    if (comp(key, base[hint])) {
+        // Gallop left until base[hint - offset] <= key < base[hint - last_offset]
+        const long max_offset = hint + 1;
+        while (offset < max_offset and comp(key, base[hint - offset])) {
+            last_offset = offset;
+            offset = offset*2 + 1;
+        }
+        offset = std::min(offset, max_offset);
+        const long temp = last_offset;
+        last_offset = hint - offset;
+        offset = hint - temp;
+    }
+    else {
+        // Gallop right until base[hint + last_offset] <= key < base[hint + offset]
+        const long max_offset = size - hint;
+        while (offset < max_offset and !comp(key, base[hint + offset])) {
+            last_offset = offset;
+            offset = offset*2 + 1;
+        }
+        offset = std::min(offset, max_offset);
+        last_offset += hint;
+        offset += hint;
+    }
+
+    // Now base[last_offset] <= key < base[offset]; binary search in between
+    last_offset++;
+    while (last_offset < offset) {
+        const long middle = last_offset + (offset - last_offset) / 2;
+        if (comp(key, base[middle]))
+            offset = middle;
+        else
+            last_offset = middle + 1;
+    }
+    return offset;
+}
+
+/*
+    TimSorter
+    ---------
+    The state of one tim sort of the range starting at first: the stack of
+    pending runs, the merge buffer and the current galloping threshold.
+*/
+
+template <typename RandomIt, typename Compare, typename StepCallback>
+class TimSorter {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    struct Run {
+        long base;
+        long length;
+    };
+
+    RandomIt first;
+    Compare comp;
+    StepCallback show_state;
+
+    vector<Run> runs;
+    vector<Value> buffer;
+    long min_gallop;
+
+    void merge_collapse();
+    void merge_force_collapse();
+    void merge_at(size_t index);
+    void merge_low(long base1, long length1, long base2, long length2);
+    void merge_high(long base1, long length1, long base2, long length2);
+
+    public:
+        TimSorter(RandomIt first, Compare comp, StepCallback show_state);
+
+        void sort(long size);
+};
+
+
+/*
+    Constructor
+    -----------
+*/
+
+template <typename RandomIt, typename Compare, typename StepCallback>
+TimSorter<RandomIt, Compare, StepCallback>::TimSorter(RandomIt first, Compare comp,
+                                                      StepCallback show_state)
+    : first(first), comp(comp), show_state(show_state), min_gallop {TIM_SORT_MIN_GALLOP} {}
+
+
+/*
+    sort
+    ----
+    Sorts the size elements starting at first.
+*/
+
+template <typename RandomIt, typename Compare, typename StepCallback>
+void TimSorter<RandomIt, Compare, StepCallback>::sort(long size) {
+    if (size < 2)
+        return;
+
+    // Small inputs are sorted without merging
+    if (size < TIM_SORT_MIN_MERGE) {
+        const long run_length = count_run_and_make_ascending(first, first + size, comp);
+        binary_insertion_sort(first, first + size, first + run_length, comp);
+        show_state();
+        return;
+    }
+
+    const long min_run = compute_min_run(size);
+    long low = 0;
+    long remaining = size;
+    do {
+        // Find the next run, and extend it to min_run elements if it is shorter
+        long run_length = count_run_and_make_ascending(first + low, first + size, comp);
+        if (run_length < min_run) {
+            const long forced_length = std::min(remaining, min_run);
+            binary_insertion_sort(first + low, first + low + forced_length,
+                                  first + low + run_length, comp);
+            run_length = forced_length;
+        }
+
+        runs.push_back({low, run_length});
+        merge_collapse();
+
+        low += run_length;
+        remaining -= run_length;
+    } while (remaining != 0);
+
+    merge_force_collapse();
+}
+
+
+/*
+    merge_collapse
+    --------------
+    Merges runs on top of the stack until, for the lengths A, B, C, D of the
+    top four runs (D on top), B > C + D, A > B + C and C > D hold. Checking
+    the fourth run as well fixes a flaw in the original algorithm, where the
+    invariant could break deeper down the stack.
+*/
+
+template <typename RandomIt, typename Compare, typename StepCallback>
+void TimSorter<RandomIt, Compare, StepCallback>::merge_collapse() {
+    while (runs.size() > 1) {
+        size_t n = runs.size() - 2;
+        if ((n > 0 and runs[n - 1].length <= runs[n].length + runs[n + 1].length)
+            or (n > 1 and runs[n - 2].length <= runs[n - 1].length + runs[n].length)) {
+            // Merge the middle run with the shorter of its neighbours
+            if (runs[n - 1].length < runs[n + 1].length)
+                n--;
+        }
+        else if (runs[n].length > runs[n + 1].length) {
+            break;      // the invariant holds
+        }
+        merge_at(n);
+    }
+}
+
+
+/*
+    merge_force_collapse
+    --------------------
+    Merges all runs on the stack into one, once the whole input is scanned.
+*/
+
+template <typename RandomIt, typename Compare, typename StepCallback>
+void TimSorter<RandomIt, Compare, StepCallback>::merge_force_collapse() {
+    while (runs.size() > 1) {
+        size_t n = runs.size() - 2;
+        if (n > 0 and runs[n - 1].length < runs[n + 1].length)
+            n--;
+        merge_at(n);
+    }
+}
+
+
+/*
+    merge_at
+    --------
+    Merges the runs at stack positions index and index + 1, which must be the
+    second or third run from the top.
+*/
+
+template <typename RandomIt, typename Compare, typename StepCallback>
+void TimSorter<RandomIt, Compare, StepCallback>::merge_at(size_t index) {
+    long base1 = runs[index].base;
+    long length1 = runs[index].length;
+    const long base2 = runs[index + 1].base;
+    long length2 = runs[index + 1].length;
+
+    runs[index].length = length1 + length2;
+    runs.erase(runs.begin() + index + 1);
+
+    // Elements of the first run that are not greater than the first element
+    // of the second run are already in place
+    const long skip = gallop_right(first[base2], first + base1, length1, 0, comp);
+    base1 += skip;
+    length1 -= skip;
+
+    // So are elements of the second run not less than the first run's last element
+    if (length1 > 0)
+        length2 = gallop_left(first[base1 + length1 - 1], first + base2, length2, length2 - 1, comp);
+
+    if (length1 > 0 and length2 > 0) {
+        // Copy the shorter run into the buffer
+        if (length1 <= length2)
+            merge_low(base1, length1, base2, length2);
+        else
+            merge_high(base1, length1, base2, length2);
+    }
+
+    show_state();
+}
+
+
+/*
+    merge_low
+    ---------
+    Merges two adjacent runs, where the first one is not longer than the
+    second one, the first element of the second run goes before the first
+    run's first element, and the first run's last element goes after all of
+    the second run. The first run is moved into the buffer, and the merge
+    proceeds from left to right.
+*/
+
+template <typename RandomIt, typename Compare, typename StepCallback>
+void TimSorter<RandomIt, Compare, StepCallback>::merge_low(long base1, long length1,
+                                                         long base2, long length2) {
+    buffer.assign(std::make_move_iterator(first + base1),
+                  std::make_move_iterator(first + base1 + length1));
+    auto run1 = buffer.begin();
+    RandomIt run2 = first + base2;
+    RandomIt dest = first + base1;
+
+    // The first element of the second run is known to go first
+    *dest++ = std::move(*run2++);
+    length2--;
+
+    long gallop = min_gallop;
+    while (length2 > 0 and length1 > 1) {
+        long count1 = 0;    // number of times in a row that the first run won
+        long count2 = 0;    // number of times in a row that the second run won
+
+        // Merge one element at a time, until one run starts winning consistently
+        while (length2 > 0 and length1 > 1 and (count1 | count2) < gallop) {
+            if (comp(*run2, *run1)) {
+                *dest++ = std::move(*run2++);
+                length2--;
+                count2++;
+                count1 = 0;
+            }
+            else {
+                *dest++ = std::move(*run1++);
+                length1--;
+                count1++;
+                count2 = 0;
+            }
+        }
+
+        // Gallop, moving whole stretches at a time, while that pays off
+        while (length2 > 0 and length1 > 1) {
+            count1 = gallop_right(*run2, run1, length1, 0, comp);
+            dest = std::move(run1, run1 + count1, dest);
+            run1 += count1;
+            length1 -= count1;
+            if (length1 <= 1)
+                break;
+
+            *dest++ = std::move(*run2++);
+            if (--length2 == 0)
+                break;
+
+            count2 = gallop_left(*run1, run2, length2, 0, comp);
+            dest = std::move(run2, run2 + count2, dest);
+            run2 += count2;
+            length2 -= count2;
+            if (length2 == 0)
+                break;
+
+            *dest++ = std::move(*run1++);
+            if (--length1 == 1)
+                break;
+
+            // Galloping is paying off, so make it easier to get back to it
+            gallop--;
+            if (count1 < TIM_SORT_MIN_GALLOP and count2 < TIM_SORT_MIN_GALLOP) {
+                // Penalize leaving gallop mode
+                gallop = std::max(gallop, 0L) + 2;
+                break;
+            }
+        }
+    }
+    min_gallop = std::max(gallop, 1L);
+
+    if (length1 == 1) {
+        // The first run's last element goes after the rest of the second run
+        dest = std::move(run2, run2 + length2, dest);
+        *dest = std::move(*run1);
+    }
+    else {
+        std::move(run1, run1 + length1, dest);
+    }
+}
+
+
+/*
+    merge_high
+    ----------
+    Like merge_low, but for a second run shorter than the first one. The
+    second run is moved into the buffer, and the merge proceeds from right to
+    left.
+*/
+
+template <typename RandomIt, typename Compare, typename StepCallback>
+void TimSorter<RandomIt, Compare, StepCallback>::merge_high(long base1, long length1,
+                                                          long base2, long length2) {
+    buffer.assign(std::make_move_iterator(first + base2),
+                  std::make_move_iterator(first + base2 + length2));
+    // Cursors point one past the next element to move
+    RandomIt run1 = first + base1 + length1;
+    auto run2 = buffer.end();
+    RandomIt dest = first + base2 + length2;
+    const RandomIt run1_base = first + base1;
+    const auto run2_base = buffer.begin();
+
+    // The last element of the first run is known to go last
+    *--dest = std::move(*--run1);
+    length1--;
+
+    long gallop = min_gallop;
+    while (length1 > 0 and length2 > 1) {
+        long count1 = 0;    // number of times in a row that the first run won
+        long count2 = 0;    // number of times in a row that the second run won
+
+        // Merge one element at a time, until one run starts winning consistently
+        while (length1 > 0 and length2 > 1 and (count1 | count2) < gallop) {
+            if (comp(*(run2 - 1), *(run1 - 1))) {
+                *--dest = std::move(*--run1);
+                length1--;
+                count1++;
+                count2 = 0;
+            }
+            else {
+                *--dest = std::move(*--run2);
+                length2--;
+                count2++;
+                count1 = 0;
+            }
+        }
+
+        // Gallop, moving whole stretches at a time, while that pays off
+        while (length1 > 0 and length2 > 1) {
+            count1 = length1 - gallop_right(*(run2 - 1), run1_base, length1, length1 - 1, comp);
+            dest = std::move_backward(run1 - count1, run1, dest);
+            run1 -= count1;
+            length1 -= count1;
+            if (length1 == 0)
+                break;
+
+            *--dest = std::move(*--run2);
+            if (--length2 == 1)
+                break;
+
+            count2 = length2 - gallop_left(*(run1 - 1), run2_base, length2, length2 - 1, comp);
+            dest = std::move_backward(run2 - count2, run2, dest);
+            run2 -= count2;
+            length2 -= count2;
+            if (length2 <= 1)
+                break;
+
+            *--dest = std::move(*--run1);
+            if (--length1 == 0)
+                break;
+
+            // Galloping is paying off, so make it easier to get back to it
+            gallop--;
+            if (count1 < TIM_SORT_MIN_GALLOP and count2 < TIM_SORT_MIN_GALLOP) {
+                // Penalize leaving gallop mode
+                gallop = std::max(gallop, 0L) + 2;
+                break;
+            }
+        }
+    }
+    min_gallop = std::max(gallop, 1L);
+
+    if (length2 == 1) {
+        // The second run's first element goes before the rest of the first run
+        dest = std::move_backward(run1 - length1, run1, dest);
+        *--dest = std::move(*--run2);
+    }
+    else {
+        std::move_backward(run2_base, run2, dest);
+    }
+}
+
+
+/*
+    tim_sort
+    --------
+    Stably sorts the range [first, last) according to comp. show_state is
+    called after every merge.
+*/
+template <typename RandomIt, typename Compare = std::less<>,
+          typename StepCallback = NoStateDisplay>
+void tim_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+              StepCallback show_state = StepCallback()) {
+    TimSorter<RandomIt, Compare, StepCallback> sorter(first, comp, show_state);
+    sorter.sort(last - first);
+}
+
+// Wrapper function
+void tim_sort(vector<int>& values, const int order = 1, const bool to_show_state = false) {
+    sort_in_order(values, order, to_show_state, [&](auto comp, auto show_state) {
+        tim_sort(values.begin(), values.end(), comp, show_state);
+    });
+}
+
+#endif // TIM_SORT_HPP
@@ -7,82 +7,348 @@
 #define UTILS_HPP
 
 #include <algorithm>    // swap, min, max, reverse
-#include <cstdlib>      // exit
-#include <iostream>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>       // FILE, fread, fprintf
+#include <cstdlib>      // strtod
+#include <functional>   // less, greater
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 
-#define EXIT_INPUT_SIZE_IS_ZERO 2    // exit code for when input size is 0
-
-using std::cin;
-using std::cout;
-using std::string;
-using std::swap;
 using std::vector;
 
+/*
+    FileCloser, FileHandle
+    ----------------------
+    Owns a C file, closing it when destroyed. Files made by std::tmpfile are
+    deleted once closed.
+*/
+struct FileCloser {
+    void operator()(std::FILE* file) const {
+        std::fclose(file);
+    }
+};
+
+using FileHandle = std::unique_ptr<std::FILE, FileCloser>;
+
+/*
+    IsStandardOrder, IsReverseOrder
+    -------------------------------
+    Whether Compare is std::less or std::greater of Key (or transparent), and
+    whether it is std::greater. SIMD kernels compare keys in these orders
+    only: comparators of another type may order the keys differently, e.g.
+    std::less<uint32_t> puts negative int32_t keys last.
+*/
+template <typename Key, typename Compare>
+struct IsStandardOrder : std::integral_constant<bool,
+    std::is_same<Compare, std::less<>>::value or std::is_same<Compare, std::less<Key>>::value or
+    std::is_same<Compare, std::greater<>>::value or std::is_same<Compare, std::greater<Key>>::value> {};
+
+template <typename Compare>
+struct IsReverseOrder : std::false_type {};
+
+template <typename T>
+struct IsReverseOrder<std::greater<T>> : std::true_type {};
+
+// Size of a cache line
+const size_t CACHE_LINE_BYTES = 64;
+
+/*
+    cache_line_offset
+    -----------------
+    Returns the index of the first element of values that starts a cache
+    line, if the elements tile cache lines, or 0 otherwise.
+*/
+template <typename T>
+size_t cache_line_offset(const T* values) {
+    if (CACHE_LINE_BYTES % sizeof(T) != 0)
+        return 0;
+
+    const size_t misalignment = reinterpret_cast<std::uintptr_t>(values) % CACHE_LINE_BYTES;
+    if (misalignment % sizeof(T) != 0)
+        return 0;
+    return (CACHE_LINE_BYTES - misalignment) % CACHE_LINE_BYTES / sizeof(T);
+}
+
 /*
     Input utils
     -----------
-    get_input_size
-    get_input_values
-    get_order
-    get_whether_to_show_state
-*/
-
-void get_input_size(size_t& size) {
-    cout << "Enter the input size : ";
-    cin >> size;
-
-    if ((int) size < 0) {
-        cout << "Invalid input size! Try again.\n";
-        get_input_size(size);
-    } else if (size == 0) {
-        cout << "Nothing to sort here.\n";
-        exit(EXIT_INPUT_SIZE_IS_ZERO);
+    load_values_binary
+    save_values_binary
+    read_text
+    load_values_text
+
+    Bulk loaders for benchmark inputs, which read whole files at once, from
+    an open file or from the file at path. They throw std::runtime_error if
+    a file cannot be opened, read or parsed.
+*/
+
+// Number of bytes read from a file at once
+const size_t LOAD_BLOCK_BYTES = size_t(1) << 16;
+
+/*
+    open_values_file
+    ----------------
+    Opens the file at path in mode, or throws std::runtime_error.
+*/
+FileHandle open_values_file(const std::string& path, const char* mode) {
+    FileHandle file(std::fopen(path.c_str(), mode));
+    if (!file)
+        throw std::runtime_error("cannot open " + path);
+    return file;
+}
+
+/*
+    remaining_bytes
+    ---------------
+    Returns the number of bytes from the position of file to its end, or 0
+    if the file cannot seek (e.g. a pipe).
+*/
+size_t remaining_bytes(std::FILE* file) {
+    const long position = std::ftell(file);
+    if (position < 0 or std::fseek(file, 0, SEEK_END) != 0)
+        return 0;
+
+    const long end = std::ftell(file);
+    std::fseek(file, position, SEEK_SET);
+    return end > position ? size_t(end - position) : 0;
+}
+
+/*
+    load_values_binary
+    ------------------
+    Reads values of type T, stored in their in-memory representation (as
+    save_values_binary writes them), from file until its end.
+*/
+template <typename T>
+vector<T> load_values_binary(std::FILE* file) {
+    static_assert(std::is_trivially_copyable<T>::value, "binary values must be trivially copyable");
+    const size_t block_size = std::max(size_t(1), LOAD_BLOCK_BYTES / sizeof(T));
+
+    // Read as bytes, since fread drops a partial value at the end
+    vector<T> values;
+    values.reserve(remaining_bytes(file) / sizeof(T) + block_size);
+    size_t num_read = block_size;
+    while (num_read == block_size) {
+        const size_t size = values.size();
+        values.resize(size + block_size);
+        const size_t num_bytes = std::fread(values.data() + size, 1, block_size * sizeof(T), file);
+        if (num_bytes % sizeof(T) != 0)
+            throw std::runtime_error("file size is not a multiple of the value size");
+        num_read = num_bytes / sizeof(T);
+        values.resize(size + num_read);
     }
+
+    if (std::ferror(file))
+        throw std::runtime_error("read failed");
+    return values;
 }
 
-void get_input_values(vector<int>& values, const size_t& size) {
-    cout << "\nEnter " << size << " integers :\n";
-    for (int& val: values)
-        cin >> val;
-    cin.ignore();
+template <typename T>
+vector<T> load_values_binary(const std::string& path) {
+    FileHandle file = open_values_file(path, "rb");
+    return load_values_binary<T>(file.get());
 }
 
-void get_order(int& order, string& orderText ) {
-    cout << "\nSorting order?\n";
-    cout << "[A]scending / [d]escending : ";
-    getline(cin, orderText);
-
-    if (orderText[0] == 'd' or orderText[0] == 'D') {
-        order = -1;
-        orderText = "descending";
-    } else {    // ascending order by default
-        order = 1;
-        orderText = "ascending";
+/*
+    save_values_binary
+    ------------------
+    Writes values to file in their in-memory representation.
+*/
+template <typename T>
+void save_values_binary(const vector<T>& values, std::FILE* file) {
+    static_assert(std::is_trivially_copyable<T>::value, "binary values must be trivially copyable");
+    if (std::fwrite(values.data(), sizeof(T), values.size(), file) != values.size())
+        throw std::runtime_error("write failed");
+}
+
+template <typename T>
+void save_values_binary(const vector<T>& values, const std::string& path) {
+    FileHandle file = open_values_file(path, "wb");
+    save_values_binary(values, file.get());
+    if (std::fflush(file.get()) != 0)
+        throw std::runtime_error("write failed");
+}
+
+/*
+    parse_value
+    -----------
+    Parses the number at text into value, and returns the end of the number,
+    or nullptr if there is no number of type T there. Integers are parsed by
+    hand, which is faster than iostreams or strtoll. Floating point numbers
+    are parsed as doubles, and rejected if finite but out of the range of T,
+    since converting them, like 1e300 to float, is undefined.
+*/
+template <typename T>
+const char* parse_value(const char* text, T& value, std::true_type /* integer */) {
+    using Magnitude = unsigned long long;
+
+    const bool is_negative = *text == '-';
+    if (is_negative and !std::is_signed<T>::value)
+        return nullptr;
+    if (*text == '-' or *text == '+')
+        text++;
+    if (*text < '0' or *text > '9')
+        return nullptr;
+
+    // 19 digits cannot overflow, so only longer numbers are checked digit
+    // by digit
+    const Magnitude limit = Magnitude(std::numeric_limits<T>::max()) + Magnitude(is_negative);
+    const char* digits = text;
+    Magnitude magnitude = 0;
+    for (; *text >= '0' and *text <= '9'; text++) {
+        const Magnitude digit = Magnitude(*text - '0');
+        if (text - digits >= 19 and magnitude > (limit - digit) / 10)
+            return nullptr;
+        magnitude = magnitude * 10 + digit;
     }
+    if (magnitude > limit)
+        return nullptr;
+
+    // -(magnitude - 1) - 1 doesn't overflow for the lowest value
+    value = is_negative ? T(-T(magnitude - 1) - 1) : T(magnitude);
+    return text;
 }
 
-void get_whether_to_show_state(bool& toShowState) {
-    string answer;
-    cout << "\nShow state of values after each iteration?\n";
-    cout << "[y]es / [N]o : ";
-    getline(cin, answer);
+template <typename T>
+const char* parse_value(const char* text, T& value, std::false_type /* integer */) {
+    char* end = nullptr;
+    errno = 0;
+    const double parsed = std::strtod(text, &end);
+    if (end == text or errno == ERANGE)
+        return nullptr;
+    if (!std::isinf(parsed) and std::abs(parsed) > double(std::numeric_limits<T>::max()))
+        return nullptr;
+    value = T(parsed);
+    return end;
+}
+
+/*
+    read_text
+    ---------
+    Reads file from its position to its end.
+*/
+std::string read_text(std::FILE* file) {
+    std::string text;
+    text.reserve(remaining_bytes(file) + LOAD_BLOCK_BYTES);
+    size_t num_read = LOAD_BLOCK_BYTES;
+    while (num_read == LOAD_BLOCK_BYTES) {
+        const size_t size = text.size();
+        text.resize(size + LOAD_BLOCK_BYTES);
+        num_read = std::fread(&text[size], 1, LOAD_BLOCK_BYTES, file);
+        text.resize(size + num_read);
+    }
+    if (std::ferror(file))
+        throw std::runtime_error("read failed");
+    return text;
+}
+
+/*
+    load_values_text
+    ----------------
+    Reads whitespace-separated numbers of type T from file until its end.
+*/
+template <typename T>
+vector<T> load_values_text(std::FILE* file) {
+    static_assert(std::is_arithmetic<T>::value, "text values must be numbers");
+
+    const std::string text = read_text(file);
+    vector<T> values;
+    const char* it = text.c_str();
+    while (true) {
+        while (*it == ' ' or *it == '\n' or *it == '\t' or *it == '\r')
+            it++;
+        if (*it == '\0')
+            break;
+
+        T value;
+        it = parse_value(it, value, std::is_integral<T>());
+        if (it == nullptr)
+            throw std::runtime_error("invalid value in text input");
+        values.push_back(value);
+    }
+    return values;
+}
 
-    toShowState = false;        // by default, don't show state
-    if (answer[0] == 'y' or answer[0] == 'Y')    // unless user asks for it
-        toShowState = true;
+template <typename T>
+vector<T> load_values_text(const std::string& path) {
+    FileHandle file = open_values_file(path, "r");
+    return load_values_text<T>(file.get());
 }
 
 /*
     Output utils
     ------------
+    NoStateDisplay
     display_state
+    StateDisplay
+    sort_in_order
 */
 
-void display_state(const vector<int>& values) {
+/*
+    NoStateDisplay
+    --------------
+    Default step callback of the generic (iterator-based) sorters. It does
+    nothing, so the compiler removes the call from the sorting loop entirely.
+*/
+struct NoStateDisplay {
+    void operator()() const {}
+};
+
+/*
+    display_state
+    -------------
+    Prints values on a line of output (standard output by default), with
+    stdio, which allocates nothing.
+*/
+void display_state(const vector<int>& values, std::FILE* output = stdout) {
     for (const int& val: values)
-        cout << val << ' ';
-    cout << '\n';
+        std::fprintf(output, "%d ", val);
+    std::fputc('\n', output);
+}
+
+/*
+    StateDisplay
+    ------------
+    Step callback that displays the state of values after every step.
+*/
+struct StateDisplay {
+    const vector<int>& values;
+
+    void operator()() const {
+        display_state(values);
+    }
+};
+
+/*
+    sort_in_order
+    -------------
+    Calls sort(comp, show_state), where comp is std::greater<int> if order is
+    -1 (descending) and std::less<int> otherwise, and show_state is
+    StateDisplay if to_show_state is set and NoStateDisplay otherwise. Used
+    by the wrapper functions: the choice is made once, outside the sorting
+    loops, which don't test to_show_state at every step.
+*/
+template <typename Sort>
+void sort_in_order(const vector<int>& values, const int order, const bool to_show_state, Sort sort) {
+    if (to_show_state) {
+        if (order == -1)
+            sort(std::greater<int>(), StateDisplay{values});
+        else
+            sort(std::less<int>(), StateDisplay{values});
+    }
+    else {
+        if (order == -1)
+            sort(std::greater<int>(), NoStateDisplay());
+        else
+            sort(std::less<int>(), NoStateDisplay());
+    }
 }
 
 #endif // UTILS_HPP
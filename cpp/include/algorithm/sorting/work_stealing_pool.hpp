@@ -0,0 +1,367 @@
+/*
+    Work-stealing thread pool
+    -------------------------
+    A fixed set of worker threads for fork-join parallelism, used by the
+    parallel sorting algorithms. Every worker owns a deque of tasks: it pushes
+    and pops its own tasks at the back (newest first, which keeps the data it
+    just touched in its cache), and when it runs out, it steals the oldest
+    task from the front of another worker's deque. The oldest tasks are the
+    biggest ones in divide and conquer algorithms, so few steals are needed.
+
+    TaskGroup is the fork-join front end: run() forks a task, and wait()
+    joins all of them. A thread waiting on a group keeps executing pending
+    tasks instead of blocking, so nested groups cannot deadlock the pool.
+*/
+
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+    WorkStealingPool
+    ----------------
+    Runs submitted tasks on num_workers threads. Tasks submitted from a worker
+    go to that worker's own deque. Threads outside the pool share one more
+    deque, which they use the same way when they wait for their tasks.
+*/
+
+class WorkStealingPool {
+    using Task = std::function<void()>;
+
+    struct TaskDeque {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskDeque>> deques;
+    std::vector<std::thread> workers;
+    std::atomic<bool> stopping;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake_up;
+
+    static size_t& current_worker();
+    static WorkStealingPool*& current_pool();
+    size_t own_deque() const;
+
+    bool pop_task(size_t index, Task& task);
+    bool steal_task(size_t thief, Task& task);
+    void worker_loop(size_t index);
+
+    public:
+        explicit WorkStealingPool(size_t num_workers);
+        ~WorkStealingPool();
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        void submit(Task task);
+        bool run_pending_task();
+
+        size_t num_workers() const;
+};
+
+
+/*
+    Constructor
+    -----------
+    Starts num_workers threads. A pool without workers is valid: its tasks
+    are then run by the threads that wait for them.
+*/
+
+WorkStealingPool::WorkStealingPool(size_t num_workers) : stopping {false} {
+    // one deque per worker, plus one for threads outside the pool
+    for (size_t i = 0; i <= num_workers; i++)
+        deques.emplace_back(new TaskDeque);
+
+    for (size_t i = 0; i < num_workers; i++)
+        workers.emplace_back(&WorkStealingPool::worker_loop, this, i);
+}
+
+
+/*
+    Destructor
+    ----------
+    Stops and joins all workers. Tasks still queued are discarded.
+*/
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake_up.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+
+/*
+    current_worker, current_pool
+    ----------------------------
+    Identify the pool and deque of the calling thread, if it is a worker.
+*/
+
+size_t& WorkStealingPool::current_worker() {
+    static thread_local size_t index = 0;
+    return index;
+}
+
+WorkStealingPool*& WorkStealingPool::current_pool() {
+    static thread_local WorkStealingPool* pool = nullptr;
+    return pool;
+}
+
+
+/*
+    own_deque
+    ---------
+    Returns the index of the calling thread's deque: its own if it is a worker
+    of this pool, otherwise the one shared by outside threads.
+*/
+
+size_t WorkStealingPool::own_deque() const {
+    return current_pool() == this ? current_worker() : workers.size();
+}
+
+
+/*
+    submit
+    ------
+    Queues a task, and wakes up a sleeping worker to run it.
+*/
+
+void WorkStealingPool::submit(Task task) {
+    const size_t index = own_deque();
+    {
+        std::lock_guard<std::mutex> lock(deques[index]->mutex);
+        deques[index]->tasks.push_back(std::move(task));
+    }
+    wake_up.notify_one();
+}
+
+
+/*
+    run_pending_task
+    ----------------
+    Runs one queued task on the calling thread: the newest one of its own
+    deque, or else a stolen one. Preferring its own newest tasks keeps a
+    waiting thread working on the subproblems it forked itself, rather than
+    nesting unrelated large tasks on its stack. Returns false if no task was
+    queued.
+*/
+
+bool WorkStealingPool::run_pending_task() {
+    const size_t index = own_deque();
+
+    Task task;
+    if (pop_task(index, task) or steal_task(index, task)) {
+        task();
+        return true;
+    }
+    return false;
+}
+
+
+/*
+    num_workers
+    -----------
+    Returns the number of worker threads.
+*/
+
+size_t WorkStealingPool::num_workers() const {
+    return workers.size();
+}
+
+
+/*
+    pop_task
+    --------
+    Takes the newest task from the back of the given deque.
+*/
+
+bool WorkStealingPool::pop_task(size_t index, Task& task) {
+    std::lock_guard<std::mutex> lock(deques[index]->mutex);
+    if (deques[index]->tasks.empty())
+        return false;
+
+    task = std::move(deques[index]->tasks.back());
+    deques[index]->tasks.pop_back();
+    return true;
+}
+
+
+/*
+    steal_task
+    ----------
+    Takes the oldest task from the front of any deque other than the thief's,
+    starting with its neighbour so that thieves spread out over the victims.
+*/
+
+bool WorkStealingPool::steal_task(size_t thief, Task& task) {
+    for (size_t offset = 1; offset < deques.size(); offset++) {
+        TaskDeque& victim = *deques[(thief + offset) % deques.size()];
+
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*
+    worker_loop
+    -----------
+    Runs tasks until the pool is destroyed, sleeping while there are none.
+    The sleep has a timeout, as a task may be queued between a failed steal
+    and the wait.
+*/
+
+void WorkStealingPool::worker_loop(size_t index) {
+    current_pool() = this;
+    current_worker() = index;
+
+    while (!stopping) {
+        if (!run_pending_task()) {
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            if (!stopping)
+                wake_up.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+}
+
+
+/*
+    TaskGroup
+    ---------
+    Forks tasks onto a pool and joins them. The first exception thrown by a
+    task is rethrown by wait(). A group that is destroyed before wait() is
+    called (e.g. during stack unwinding) still waits for its tasks, but
+    drops their exceptions.
+*/
+
+class TaskGroup {
+    WorkStealingPool& pool;
+    std::atomic<size_t> num_pending;
+
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    void finish_tasks();
+
+    public:
+        explicit TaskGroup(WorkStealingPool&);
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        template <typename F>
+        void run(F task);
+        void wait();
+};
+
+
+/*
+    Constructor
+    -----------
+*/
+
+TaskGroup::TaskGroup(WorkStealingPool& pool) : pool(pool), num_pending {0} {}
+
+
+/*
+    Destructor
+    ----------
+    Waits for the pending tasks, which refer to the group.
+*/
+
+TaskGroup::~TaskGroup() {
+    finish_tasks();
+}
+
+
+/*
+    run
+    ---
+    Submits a task that belongs to this group. An exception thrown by the
+    task is kept for wait(), rather than escaping on a worker thread. If the
+    task cannot be submitted (e.g. std::bad_alloc), it isn't counted as
+    pending, and the exception is rethrown.
+*/
+
+template <typename F>
+void TaskGroup::run(F task) {
+    num_pending++;
+    try {
+        pool.submit([this, task]() {
+            try {
+                task();
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+            num_pending--;
+        });
+    }
+    catch (...) {
+        num_pending--;
+        throw;
+    }
+}
+
+
+/*
+    wait
+    ----
+    Returns once all tasks of the group have finished, running queued tasks
+    (of this group or any other) in the meantime. Rethrows the first
+    exception thrown by a task, if any.
+*/
+
+void TaskGroup::wait() {
+    finish_tasks();
+
+    std::exception_ptr task_error;
+    {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        std::swap(task_error, error);
+    }
+    if (task_error)
+        std::rethrow_exception(task_error);
+}
+
+
+/*
+    finish_tasks
+    ------------
+    Runs queued tasks until all tasks of the group have finished.
+*/
+
+void TaskGroup::finish_tasks() {
+    while (num_pending > 0) {
+        if (!pool.run_pending_task())
+            std::this_thread::yield();
+    }
+}
+
+#endif // WORK_STEALING_POOL_HPP
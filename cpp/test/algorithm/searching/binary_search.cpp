@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
 #include "third_party/catch.hpp"
 #include "algorithm/searching/binary_search.hpp"
 
@@ -22,3 +28,156 @@ TEST_CASE("Mixed cases", "[searching][binary_search]") {
     REQUIRE(binary_search(string("2"), vector<string>({"1", "2", "3", "4", "5"})) == 1);
     REQUIRE(binary_search(2.8, vector<double>({0.1, 0.15, 0.3, 1.1, 2.3, 2.8, 3.14})) == 5);
 }
+
+TEST_CASE("Duplicate cases", "[searching][binary_search]") {
+    REQUIRE(binary_search(7, vector<int>({1, 7, 7, 7, 9})) == 1);
+    REQUIRE(binary_search(7, vector<int>({7, 7, 7, 7, 9}), 2, 4) == 2);
+    REQUIRE(binary_search(9, vector<int>({1, 7, 7, 7, 9}), 0, 3) == -1);
+}
+
+TEST_CASE("Branchless bounds", "[searching][binary_search]") {
+    std::mt19937 generator(1);
+
+    // Sizes that are and aren't powers of two, with duplicates
+    for (int size = 0; size <= 70; size++) {
+        vector<int> values(size);
+        for (int& value : values)
+            value = int(generator() % 40);
+        std::sort(values.begin(), values.end());
+
+        for (int value = -1; value <= 41; value++) {
+            REQUIRE(branchless_lower_bound(values.begin(), values.end(), value) ==
+                    std::lower_bound(values.begin(), values.end(), value));
+            REQUIRE(branchless_upper_bound(values.begin(), values.end(), value) ==
+                    std::upper_bound(values.begin(), values.end(), value));
+            REQUIRE(branchless_equal_range(values.begin(), values.end(), value) ==
+                    std::equal_range(values.begin(), values.end(), value));
+        }
+    }
+
+    vector<string> descending{"pear", "kiwi", "fig", "apple"};
+    REQUIRE(branchless_lower_bound(descending.begin(), descending.end(), "grape", std::greater<>()) ==
+            descending.begin() + 2);
+    REQUIRE(branchless_upper_bound(descending.begin(), descending.end(), "fig", std::greater<>()) ==
+            descending.begin() + 3);
+}
+
+TEST_CASE("Batch lower bound", "[searching][binary_search]") {
+    std::mt19937 generator(2);
+
+    for (size_t size : {0, 1, 2, 3, 100, 1000}) {
+        vector<long> values(size);
+        for (long& value : values)
+            value = long(generator() % 2000);
+        std::sort(values.begin(), values.end());
+
+        // More queries than a group, and a partial group
+        vector<long> queries(BATCH_SEARCH_GROUP_SIZE * 3 + 5);
+        for (long& query : queries)
+            query = long(generator() % 2002) - 1;
+
+        vector<size_t> indices(queries.size());
+        REQUIRE(batch_lower_bound(values.begin(), values.end(), queries.begin(), queries.end(),
+                                  indices.begin()) == indices.end());
+        for (size_t i = 0; i < queries.size(); i++)
+            REQUIRE(indices[i] == size_t(std::lower_bound(values.begin(), values.end(), queries[i]) - values.begin()));
+    }
+}
+
+TEST_CASE("Batch lower bound of 32 bit integers", "[searching][binary_search]") {
+    std::mt19937 generator(3);
+
+    // Searched with gathers when compiled with AVX2
+    for (size_t size : {0, 1, 2, 3, 100, 1000}) {
+        vector<int32_t> values(size);
+        for (int32_t& value : values)
+            value = int32_t(generator() % 2000);
+        std::sort(values.begin(), values.end());
+
+        vector<int32_t> queries(GATHER_SEARCH_GROUP_SIZE * 3 + 5);
+        for (int32_t& query : queries)
+            query = int32_t(generator() % 2002) - 1;
+        queries.push_back(std::numeric_limits<int32_t>::min());
+        queries.push_back(std::numeric_limits<int32_t>::max());
+
+        vector<size_t> indices(queries.size());
+        REQUIRE(batch_lower_bound(values.begin(), values.end(), queries.begin(), queries.end(),
+                                  indices.begin()) == indices.end());
+        for (size_t i = 0; i < queries.size(); i++)
+            REQUIRE(indices[i] == size_t(std::lower_bound(values.begin(), values.end(), queries[i]) - values.begin()));
+
+        std::reverse(values.begin(), values.end());
+        const vector<int32_t>& descending = values;
+        batch_lower_bound(descending.begin(), descending.end(), queries.begin(), queries.end(),
+                          indices.begin(), std::greater<int32_t>());
+        for (size_t i = 0; i < queries.size(); i++)
+            REQUIRE(indices[i] == size_t(std::lower_bound(descending.begin(), descending.end(), queries[i],
+                                                          std::greater<int32_t>()) - descending.begin()));
+
+        // Keys sorted as unsigned integers, which gathers can't search
+        std::sort(values.begin(), values.end(), std::less<uint32_t>());
+        batch_lower_bound(values.begin(), values.end(), queries.begin(), queries.end(),
+                          indices.begin(), std::less<uint32_t>());
+        for (size_t i = 0; i < queries.size(); i++)
+            REQUIRE(indices[i] == size_t(std::lower_bound(values.begin(), values.end(), queries[i],
+                                                          std::less<uint32_t>()) - values.begin()));
+    }
+}
+
+TEST_CASE("Sorted batch lower bound", "[searching][binary_search]") {
+    std::mt19937 generator(4);
+
+    // Queries denser and sparser than the values, with duplicates
+    for (size_t size : {0, 1, 2, 50, 1000}) {
+        vector<int> values(size);
+        for (int& value : values)
+            value = int(generator() % 500);
+        std::sort(values.begin(), values.end());
+
+        for (size_t num_queries : {0, 1, 10, 2000}) {
+            vector<int> queries(num_queries);
+            for (int& query : queries)
+                query = int(generator() % 502) - 1;
+            std::sort(queries.begin(), queries.end());
+
+            vector<size_t> indices(queries.size());
+            REQUIRE(sorted_batch_lower_bound(values.begin(), values.end(), queries.begin(), queries.end(),
+                                             indices.begin()) == indices.end());
+            for (size_t i = 0; i < queries.size(); i++)
+                REQUIRE(indices[i] == size_t(std::lower_bound(values.begin(), values.end(), queries[i]) - values.begin()));
+        }
+    }
+
+    vector<string> descending{"pear", "kiwi", "fig", "fig", "apple"};
+    vector<string> queries{"plum", "kiwi", "grape", "fig", "banana", "aa"};
+    vector<size_t> indices(queries.size());
+    sorted_batch_lower_bound(descending.begin(), descending.end(), queries.begin(), queries.end(),
+                             indices.begin(), std::greater<>());
+    REQUIRE(indices == vector<size_t>({0, 1, 2, 2, 4, 5}));
+}
+
+TEST_CASE("Multi lower bound", "[searching][binary_search]") {
+    std::mt19937 generator(5);
+    vector<int32_t> values(5000);
+    for (int32_t& value : values)
+        value = int32_t(generator() % 10000);
+    std::sort(values.begin(), values.end());
+
+    // Sorted and dense, sorted and sparse, and unsorted
+    vector<int32_t> dense(1000), sparse(10), unsorted(1000);
+    for (int32_t& query : dense)
+        query = int32_t(generator() % 10002) - 1;
+    for (int32_t& query : sparse)
+        query = int32_t(generator() % 10002) - 1;
+    unsorted = dense;
+    std::sort(dense.begin(), dense.end());
+    std::sort(sparse.begin(), sparse.end());
+
+    for (const vector<int32_t>& queries : {dense, sparse, unsorted}) {
+        vector<size_t> indices(queries.size());
+        REQUIRE(multi_lower_bound(values.begin(), values.end(), queries.begin(), queries.end(),
+                                  indices.begin()) == indices.end());
+        for (size_t i = 0; i < queries.size(); i++)
+            REQUIRE(indices[i] == size_t(std::lower_bound(values.begin(), values.end(), queries[i]) - values.begin()));
+    }
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include "third_party/catch.hpp"
+#include "algorithm/searching/interpolation_search.hpp"
+#include "lower_bound_checks.hpp"
+
+using std::vector;
+
+/*
+    require_learned_lower_bounds
+    ----------------------------
+    Checks that interpolation_lower_bound and LearnedIndex (built on one and
+    on several threads) find the same lower bounds in sorted_keys as
+    std::lower_bound, for every query.
+*/
+template <typename T>
+void require_learned_lower_bounds(const vector<T>& sorted_keys, const vector<T>& queries, const size_t max_error) {
+    WorkStealingPool pool(3);
+    require_lower_bounds(LearnedIndex<T>(sorted_keys, max_error), sorted_keys, queries);
+    require_lower_bounds(LearnedIndex<T>(pool, sorted_keys, max_error), sorted_keys, queries);
+
+    for (const T& query : queries) {
+        const auto expected = std::lower_bound(sorted_keys.begin(), sorted_keys.end(), query);
+        REQUIRE(interpolation_lower_bound(sorted_keys.begin(), sorted_keys.end(), query) == expected);
+    }
+}
+
+TEST_CASE("Base cases", "[searching][interpolation_search]") {
+    REQUIRE(interpolation_search(0, vector<int>()) == -1);
+    REQUIRE(interpolation_search(1, vector<int>({1})) == 0);
+    REQUIRE(interpolation_search(5, vector<int>({0})) == -1);
+
+    REQUIRE(LearnedIndex<int>(vector<int>()).lower_bound(3) == 0);
+    REQUIRE(LearnedIndex<int>(vector<int>({3})).lower_bound(2) == 0);
+    REQUIRE(LearnedIndex<int>(vector<int>({3})).lower_bound(3) == 0);
+    REQUIRE(LearnedIndex<int>(vector<int>({3})).lower_bound(4) == 1);
+}
+
+TEST_CASE("Integer cases", "[searching][interpolation_search]") {
+    REQUIRE(interpolation_search(33, vector<int>({-5, 2, 7, 25, 33, 77, 88, 102})) == 4);
+    REQUIRE(interpolation_search(-99, vector<int>({-99, -88, -53, -3, -1})) == 0);
+    REQUIRE(interpolation_search(4, vector<int>({0, 5, 9, 44, 67})) == -1);
+    REQUIRE(interpolation_search(7, vector<int>({1, 7, 7, 7, 9})) == 1);
+    REQUIRE(interpolation_search(2.8, vector<double>({0.1, 0.15, 0.3, 1.1, 2.3, 2.8, 3.14})) == 5);
+
+    vector<int> multiples(1000);
+    for (size_t i = 0; i < multiples.size(); i++)
+        multiples[i] = int(5 * i);
+    REQUIRE(interpolation_search(2500, multiples) == 500);
+    REQUIRE(interpolation_search(2501, multiples) == -1);
+}
+
+TEST_CASE("Uniform keys", "[searching][interpolation_search]") {
+    std::mt19937 generator(1);
+
+    for (size_t size : {2, 10, 33, 100, 1000, 200000}) {
+        vector<int32_t> keys(size);
+        for (int32_t& key : keys)
+            key = int32_t(generator() % (4 * size));
+        std::sort(keys.begin(), keys.end());
+
+        vector<int32_t> queries(1000);
+        for (int32_t& query : queries)
+            query = int32_t(generator() % (4 * size + 2)) - 1;
+        require_learned_lower_bounds(keys, queries, LEARNED_INDEX_MAX_ERROR);
+    }
+
+    // Evenly spaced keys are a single line
+    vector<int64_t> line(100000);
+    for (size_t i = 0; i < line.size(); i++)
+        line[i] = int64_t(3 * i);
+    REQUIRE(LearnedIndex<int64_t>(line).num_segments() == 1);
+    require_learned_lower_bounds(line, vector<int64_t>({-1, 0, 1, 299997, 300000, 150000}), 4);
+}
+
+TEST_CASE("Skewed keys and duplicates", "[searching][interpolation_search]") {
+    std::mt19937 generator(2);
+
+    // Exponentially distributed keys, and errors as small as 0
+    vector<double> exponential(100000);
+    std::exponential_distribution<double> distribution(1.0);
+    for (double& key : exponential)
+        key = distribution(generator);
+    std::sort(exponential.begin(), exponential.end());
+    vector<double> real_queries(exponential.begin(), exponential.begin() + 1000);
+    for (int i = 0; i < 1000; i++)
+        real_queries.push_back(distribution(generator));
+    real_queries.push_back(-1);
+    real_queries.push_back(1e9);
+    for (size_t max_error : {0, 1, 8, 64})
+        require_learned_lower_bounds(exponential, real_queries, max_error);
+
+    // Runs of duplicates longer than the error
+    vector<int> runs;
+    for (int key = 0; key < 2000; key++)
+        runs.insert(runs.end(), size_t(generator() % 100) + 1, key * key);
+    vector<int> queries;
+    for (int i = 0; i < 3000; i++)
+        queries.push_back(int(generator() % 4000001) - 1);
+    require_learned_lower_bounds(runs, queries, 4);
+}
+
+TEST_CASE("Extreme keys", "[searching][interpolation_search]") {
+    vector<int64_t> extremes{std::numeric_limits<int64_t>::min(), -3, 0, 1, 2, 3,
+                             std::numeric_limits<int64_t>::max() - 1, std::numeric_limits<int64_t>::max()};
+    require_learned_lower_bounds(extremes, extremes, 0);
+
+    vector<uint8_t> bytes(300);
+    for (size_t i = 0; i < bytes.size(); i++)
+        bytes[i] = uint8_t(i * 255 / 299);
+    vector<uint8_t> byte_queries;
+    for (int i = 0; i < 256; i++)
+        byte_queries.push_back(uint8_t(i));
+    require_learned_lower_bounds(bytes, byte_queries, 2);
+
+    const double infinity = std::numeric_limits<double>::infinity();
+    vector<double> infinities(100);
+    for (size_t i = 0; i < infinities.size(); i++)
+        infinities[i] = double(i / 2);
+    infinities.front() = -infinity;
+    infinities.back() = infinity;
+    require_learned_lower_bounds(infinities, vector<double>({-infinity, -1, 0.5, 1.5, 2, 49.5, 1e300, infinity}), 2);
+}
@@ -1,3 +1,10 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <random>
+#include <string>
 #include "third_party/catch.hpp"
 #include "algorithm/searching/linear_search.hpp"
 
@@ -24,3 +31,134 @@ TEST_CASE("Mixed cases", "[searching][linear_search]") {
     REQUIRE(linear_search(string("/"), vector<string>({"1", "/", "*", "-", "0"})) == 1);
     REQUIRE(linear_search(1.25, vector<double>({0.0, 6.15, 0.3, 1.25, 4})) == 3);
 }
+
+/*
+    require_finds
+    -------------
+    Checks linear_find, linear_count and linear_find_any against the
+    standard algorithms, for every element of values and for missing_value,
+    on every suffix of values, so that matches fall in every lane of a
+    vector and in the scalar tail.
+*/
+template <typename T>
+void require_finds(const vector<T>& values, const T missing_value) {
+    for (size_t begin = 0; begin <= values.size(); begin += (begin < 70 ? 1 : 37)) {
+        const auto first = values.begin() + begin;
+        vector<T> queries(first, values.end());
+        queries.push_back(missing_value);
+
+        for (const T& query : queries) {
+            REQUIRE(linear_find(first, values.end(), query) == std::find(first, values.end(), query));
+            REQUIRE(linear_count(first, values.end(), query) == size_t(std::count(first, values.end(), query)));
+        }
+
+        const vector<T> needles(queries.end() - std::min<size_t>(queries.size(), 3), queries.end());
+        REQUIRE(linear_find_any(first, values.end(), needles.begin(), needles.end()) ==
+                std::find_first_of(first, values.end(), needles.begin(), needles.end()));
+    }
+}
+
+/*
+    random_values
+    -------------
+    Returns size values of type T, drawn from a range small enough that
+    most values occur several times.
+*/
+template <typename T>
+vector<T> random_values(const size_t size, std::mt19937& generator) {
+    vector<T> values(size);
+    for (T& value : values)
+        value = T(generator() % 50);
+    return values;
+}
+
+TEST_CASE("Vector find of all numeric types", "[searching][linear_search]") {
+    std::mt19937 generator(1);
+
+    require_finds(random_values<int8_t>(300, generator), int8_t(-100));
+    require_finds(random_values<uint8_t>(300, generator), uint8_t(200));
+    require_finds(random_values<char>(300, generator), 'z');
+    require_finds(random_values<int16_t>(300, generator), int16_t(-1000));
+    require_finds(random_values<uint16_t>(300, generator), uint16_t(60000));
+    require_finds(random_values<int32_t>(300, generator), int32_t(-7));
+    require_finds(random_values<uint32_t>(300, generator), uint32_t(4000000000u));
+    require_finds(random_values<int64_t>(300, generator), std::numeric_limits<int64_t>::min());
+    require_finds(random_values<uint64_t>(300, generator), std::numeric_limits<uint64_t>::max());
+    require_finds(random_values<long long>(300, generator), -1LL);
+    require_finds(random_values<float>(300, generator), 0.5f);
+    require_finds(random_values<double>(300, generator), -2.25);
+}
+
+TEST_CASE("Values the elements cannot hold", "[searching][linear_search]") {
+    const vector<uint8_t> bytes{1, 44, 255, 44};
+    REQUIRE(linear_find(bytes.begin(), bytes.end(), 300) == bytes.end());
+    REQUIRE(linear_find(bytes.begin(), bytes.end(), -1) == bytes.end());
+    REQUIRE(linear_find(bytes.begin(), bytes.end(), 255) == bytes.begin() + 2);
+    REQUIRE(linear_count(bytes.begin(), bytes.end(), 300) == 0);
+    REQUIRE(linear_count(bytes.begin(), bytes.end(), 44) == 2);
+
+    vector<int> whole(100, 2);
+    whole[70] = 3;
+    REQUIRE(linear_find(whole.begin(), whole.end(), 2.5) == whole.end());
+    REQUIRE(linear_find(whole.begin(), whole.end(), 3.0) == whole.begin() + 70);
+    const vector<double> needles{2.5, 3.0, 1e100};
+    REQUIRE(linear_find_any(whole.begin(), whole.end(), needles.begin(), needles.end()) == whole.begin() + 70);
+
+    // Values out of the range of the elements are not converted to them
+    const vector<int32_t> extremes{0, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()};
+    REQUIRE(linear_find(extremes.begin(), extremes.end(), 1e100) == extremes.end());
+    REQUIRE(linear_find(extremes.begin(), extremes.end(), -1e100) == extremes.end());
+    REQUIRE(linear_find(extremes.begin(), extremes.end(), std::nan("")) == extremes.end());
+    REQUIRE(linear_find(extremes.begin(), extremes.end(), 2147483648.0) == extremes.end());
+    REQUIRE(linear_find(extremes.begin(), extremes.end(), 2147483648.0f) == extremes.end());
+    REQUIRE(linear_find(extremes.begin(), extremes.end(), -2147483648.0) == extremes.begin() + 1);
+    REQUIRE(linear_find(extremes.begin(), extremes.end(), 2147483647.0) == extremes.begin() + 2);
+    REQUIRE(linear_count(extremes.begin(), extremes.end(), -1e100) == 0);
+    const vector<uint64_t> unsigned_extremes{0, std::numeric_limits<uint64_t>::max()};
+    REQUIRE(linear_find(unsigned_extremes.begin(), unsigned_extremes.end(), 18446744073709551616.0) ==
+            unsigned_extremes.end());
+    REQUIRE(linear_find(unsigned_extremes.begin(), unsigned_extremes.end(), -1.0) == unsigned_extremes.end());
+
+    // Integers of the other signedness compare like they do with ==, as in std::find
+    const vector<unsigned> unsigned_values{0, 1, std::numeric_limits<unsigned>::max()};
+    REQUIRE(linear_find(unsigned_values.begin(), unsigned_values.end(), -1) ==
+            std::find(unsigned_values.begin(), unsigned_values.end(), -1));
+    const vector<int> signed_values{0, -1};
+    REQUIRE(linear_find(signed_values.begin(), signed_values.end(), std::numeric_limits<unsigned>::max()) ==
+            std::find(signed_values.begin(), signed_values.end(), std::numeric_limits<unsigned>::max()));
+
+    const vector<float> floats{1.0f, std::numeric_limits<float>::infinity()};
+    REQUIRE(linear_find(floats.begin(), floats.end(), 1e100) == floats.end());
+    REQUIRE(linear_find(floats.begin(), floats.end(), std::numeric_limits<double>::infinity()) == floats.begin() + 1);
+    REQUIRE(linear_count(floats.begin(), floats.end(), 1.0) == 1);
+}
+
+TEST_CASE("Floating point equality", "[searching][linear_search]") {
+    vector<double> reals(40, 1.0);
+    reals[5] = std::nan("");
+    reals[20] = -0.0;
+    REQUIRE(linear_find(reals.begin(), reals.end(), std::nan("")) == reals.end());
+    REQUIRE(linear_find(reals.begin(), reals.end(), 0.0) == reals.begin() + 20);
+    REQUIRE(linear_count(reals.begin(), reals.end(), 1.0) == 38);
+}
+
+TEST_CASE("Find without vectors", "[searching][linear_search]") {
+    const vector<string> words{"fig", "kiwi", "pear", "kiwi"};
+    const vector<string> needles{"plum", "pear"};
+    REQUIRE(linear_find(words.begin(), words.end(), "kiwi") == words.begin() + 1);
+    REQUIRE(linear_count(words.begin(), words.end(), "kiwi") == 2);
+    REQUIRE(linear_find_any(words.begin(), words.end(), needles.begin(), needles.end()) == words.begin() + 2);
+
+    const std::list<int> numbers{4, 8, 15, 16, 23, 42};
+    REQUIRE(*linear_find(numbers.begin(), numbers.end(), 16) == 16);
+    REQUIRE(linear_count(numbers.begin(), numbers.end(), 7) == 0);
+
+    // More values than are compared with vectors at once
+    const vector<int> values{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    vector<int> many_needles(20);
+    for (size_t i = 0; i < many_needles.size(); i++)
+        many_needles[i] = int(100 + i);
+    many_needles.back() = 9;
+    REQUIRE(linear_find_any(values.begin(), values.end(), many_needles.begin(), many_needles.end()) ==
+            values.begin() + 8);
+}
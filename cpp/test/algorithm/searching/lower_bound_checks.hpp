@@ -0,0 +1,25 @@
+#ifndef LOWER_BOUND_CHECKS_HPP
+#define LOWER_BOUND_CHECKS_HPP
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "third_party/catch.hpp"
+
+/*
+    require_lower_bounds
+    --------------------
+    Checks that index finds the same lower bounds in sorted_keys as
+    std::lower_bound, for every query.
+*/
+template <typename Index, typename T, typename Compare = std::less<>>
+void require_lower_bounds(const Index& index, const std::vector<T>& sorted_keys, const std::vector<T>& queries,
+                          Compare comp = Compare()) {
+    REQUIRE(index.size() == sorted_keys.size());
+    for (const T& query : queries) {
+        const auto expected = std::lower_bound(sorted_keys.begin(), sorted_keys.end(), query, comp);
+        REQUIRE(index.lower_bound(query) == size_t(expected - sorted_keys.begin()));
+    }
+}
+
+#endif // LOWER_BOUND_CHECKS_HPP
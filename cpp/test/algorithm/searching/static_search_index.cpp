@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include "third_party/catch.hpp"
+#include "algorithm/searching/static_search_index.hpp"
+#include "lower_bound_checks.hpp"
+
+using std::vector;
+using std::string;
+
+TEST_CASE("Base cases", "[searching][static_search_index]") {
+    REQUIRE(EytzingerIndex<int>(vector<int>()).lower_bound(5) == 0);
+    REQUIRE(BTreeIndex<int>(vector<int>()).lower_bound(5) == 0);
+
+    REQUIRE(EytzingerIndex<int>(vector<int>({3})).lower_bound(2) == 0);
+    REQUIRE(EytzingerIndex<int>(vector<int>({3})).lower_bound(3) == 0);
+    REQUIRE(EytzingerIndex<int>(vector<int>({3})).lower_bound(4) == 1);
+    REQUIRE(BTreeIndex<int>(vector<int>({3})).lower_bound(2) == 0);
+    REQUIRE(BTreeIndex<int>(vector<int>({3})).lower_bound(3) == 0);
+    REQUIRE(BTreeIndex<int>(vector<int>({3})).lower_bound(4) == 1);
+}
+
+TEST_CASE("Eytzinger index", "[searching][static_search_index]") {
+    std::mt19937 generator(1);
+
+    // Perfect and padded trees, with duplicates
+    for (int size = 0; size <= 70; size++) {
+        vector<int32_t> keys(size);
+        for (int32_t& key : keys)
+            key = int32_t(generator() % 40);
+        std::sort(keys.begin(), keys.end());
+
+        vector<int32_t> queries;
+        for (int32_t query = -1; query <= 41; query++)
+            queries.push_back(query);
+
+        require_lower_bounds(EytzingerIndex<int32_t>(keys), keys, queries);
+    }
+}
+
+TEST_CASE("B-tree index", "[searching][static_search_index]") {
+    std::mt19937 generator(2);
+
+    // One, two, three and four layers, with full and partial nodes
+    for (size_t size : {0, 1, 15, 16, 17, 100, 271, 272, 273, 1000, 4624, 4625, 100000}) {
+        vector<int32_t> keys(size);
+        for (int32_t& key : keys)
+            key = int32_t(generator() % (2 * size + 1));
+        std::sort(keys.begin(), keys.end());
+
+        vector<int32_t> queries(1000);
+        for (int32_t& query : queries)
+            query = int32_t(generator() % (2 * size + 3)) - 1;
+        queries.push_back(std::numeric_limits<int32_t>::min());
+        queries.push_back(std::numeric_limits<int32_t>::max());
+
+        require_lower_bounds(BTreeIndex<int32_t>(keys), keys, queries);
+        require_lower_bounds(EytzingerIndex<int32_t>(keys), keys, queries);
+    }
+}
+
+TEST_CASE("Other key types and orders", "[searching][static_search_index]") {
+    std::mt19937 generator(3);
+
+    vector<int32_t> descending(500);
+    for (int32_t& key : descending)
+        key = int32_t(generator() % 300);
+    std::sort(descending.begin(), descending.end(), std::greater<int32_t>());
+    vector<int32_t> queries;
+    for (int32_t query = -1; query <= 301; query++)
+        queries.push_back(query);
+    require_lower_bounds(BTreeIndex<int32_t, std::greater<int32_t>>(descending), descending, queries,
+                         std::greater<int32_t>());
+    require_lower_bounds(EytzingerIndex<int32_t, std::greater<>>(descending), descending, queries,
+                         std::greater<>());
+
+    // Comparators of another type than the keys order them their own way
+    vector<int32_t> unsigned_order(1000);
+    for (int32_t& key : unsigned_order)
+        key = int32_t(generator() % 200) - 100;
+    std::sort(unsigned_order.begin(), unsigned_order.end(), std::less<uint32_t>());
+    require_lower_bounds(BTreeIndex<int32_t, std::less<uint32_t>>(unsigned_order), unsigned_order,
+                         vector<int32_t>({-101, -50, -1, 0, 50, 100}), std::less<uint32_t>());
+
+    vector<double> reals(300);
+    for (double& key : reals)
+        key = double(generator() % 1000) / 8;
+    std::sort(reals.begin(), reals.end());
+    vector<double> real_queries(reals.begin(), reals.end());
+    real_queries.push_back(-1);
+    real_queries.push_back(0.01);
+    real_queries.push_back(1000);
+    require_lower_bounds(BTreeIndex<double>(reals), reals, real_queries);
+    require_lower_bounds(EytzingerIndex<double>(reals), reals, real_queries);
+
+    vector<string> words{"apple", "fig", "fig", "grape", "kiwi", "lemon", "mango", "melon", "olive",
+                         "peach", "pear", "plum", "quince", "raisin", "sloe", "ugli", "yuzu"};
+    vector<string> word_queries{"", "a", "apple", "banana", "fig", "lime", "pear", "zucchini"};
+    require_lower_bounds(BTreeIndex<string>(words), words, word_queries);
+    require_lower_bounds(EytzingerIndex<string>(words), words, word_queries);
+}
+
+TEST_CASE("Copies of indexes", "[searching][static_search_index]") {
+    vector<int32_t> keys(1000);
+    for (size_t i = 0; i < keys.size(); i++)
+        keys[i] = int32_t(3 * i);
+
+    vector<BTreeIndex<int32_t>> b_trees(3, BTreeIndex<int32_t>(keys));
+    vector<EytzingerIndex<int32_t>> eytzinger_trees(3, EytzingerIndex<int32_t>(keys));
+    for (size_t i = 0; i < b_trees.size(); i++) {
+        REQUIRE(b_trees[i].lower_bound(1500) == 500);
+        REQUIRE(b_trees[i].lower_bound(1501) == 501);
+        REQUIRE(eytzinger_trees[i].lower_bound(1500) == 500);
+        REQUIRE(eytzinger_trees[i].lower_bound(1501) == 501);
+    }
+}
@@ -1,17 +1,37 @@
-#include <random>
+#include <cmath>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
 #include "third_party/catch.hpp"
+#include "algorithm/sorting/american_flag_sort.hpp"
 #include "algorithm/sorting/bubble_sort.hpp"
 #include "algorithm/sorting/bucket_sort.hpp"
 #include "algorithm/sorting/comb_sort.hpp"
 #include "algorithm/sorting/counting_sort.hpp"
+#include "algorithm/sorting/external_sort.hpp"
 #include "algorithm/sorting/heap_sort.hpp"
 #include "algorithm/sorting/insertion_sort.hpp"
+#include "algorithm/sorting/introsort.hpp"
+#include "algorithm/sorting/k_way_merge.hpp"
 #include "algorithm/sorting/merge_sort.hpp"
+#include "algorithm/sorting/parallel_merge_sort.hpp"
+#include "algorithm/sorting/parallel_radix_sort.hpp"
+#include "algorithm/sorting/partial_sort.hpp"
+#include "algorithm/sorting/pdq_sort.hpp"
 #include "algorithm/sorting/quick_sort.hpp"
 #include "algorithm/sorting/radix_sort.hpp"
 #include "algorithm/sorting/selection_sort.hpp"
 #include "algorithm/sorting/shell_sort.hpp"
+#include "algorithm/sorting/smart_sort.hpp"
+#include "algorithm/sorting/sorting_network.hpp"
+#include "algorithm/sorting/tim_sort.hpp"
 
 // Prototypes
 int generate_random_int(int, int);
@@ -26,17 +46,23 @@ const int TIMES_TO_RUN = 20;
 TEST_CASE("Sort in ascending order", "[sorting]") {
     // Sorting algorithms
     vector<sorting_function> sorting_functions = {
+        american_flag_sort,
         bubble_sort,
         bucket_sort,
         comb_sort,
         counting_sort,
         heap_sort,
         insertion_sort,
+        introsort,
         merge_sort,
+        parallel_merge_sort,
+        parallel_radix_sort,
+        pdq_sort,
         quick_sort,
-        // radix_sort,      // This test reveals that the radix sort is broken
+        radix_sort,
         selection_sort,
-        shell_sort
+        shell_sort,
+        tim_sort
     };
 
     vector<int> original, algo_sorted, std_sorted;
@@ -58,17 +84,23 @@ TEST_CASE("Sort in ascending order", "[sorting]") {
 TEST_CASE("Sort in descending order", "[sorting]") {
     // Sorting algorithms
     vector<sorting_function> sorting_functions = {
+        american_flag_sort,
         bubble_sort,
         bucket_sort,
         comb_sort,
         counting_sort,
         heap_sort,
         insertion_sort,
+        introsort,
         merge_sort,
+        parallel_merge_sort,
+        parallel_radix_sort,
+        pdq_sort,
         quick_sort,
-        // radix_sort,      // This test reveals that the radix sort is broken
+        radix_sort,
         selection_sort,
-        shell_sort
+        shell_sort,
+        tim_sort
     };
 
     vector<int> original, algo_sorted, std_sorted;
@@ -87,6 +119,1225 @@ TEST_CASE("Sort in descending order", "[sorting]") {
     }
 }
 
+TEST_CASE("Sort generic ranges", "[sorting][generic]") {
+    vector<long long> original{
+        3, std::numeric_limits<long long>::min(), -7, 0, std::numeric_limits<long long>::max(),
+        std::numeric_limits<int>::min(), 42, -7, 1
+    };
+    vector<long long> algo_sorted, std_sorted = original;
+    std::sort(std_sorted.begin(), std_sorted.end());
+
+    using Iterator = vector<long long>::iterator;
+    vector<std::function<void(Iterator, Iterator)>> sorting_functions = {
+        [](Iterator first, Iterator last) { american_flag_sort(first, last); },
+        [](Iterator first, Iterator last) { bubble_sort(first, last); },
+        [](Iterator first, Iterator last) { bucket_sort(first, last); },
+        [](Iterator first, Iterator last) { comb_sort(first, last); },
+        [](Iterator first, Iterator last) { counting_sort(first, last); },
+        [](Iterator first, Iterator last) { dary_heap_sort(first, last); },
+        [](Iterator first, Iterator last) { heap_sort(first, last); },
+        [](Iterator first, Iterator last) { insertion_sort(first, last); },
+        [](Iterator first, Iterator last) { introsort(first, last); },
+        [](Iterator first, Iterator last) { merge_sort(first, last); },
+        [](Iterator first, Iterator last) { pdq_sort(first, last); },
+        [](Iterator first, Iterator last) { pdq_sort(first, last, std::less<long long>()); },
+        [](Iterator first, Iterator last) { quick_sort(first, last); },
+        [](Iterator first, Iterator last) { radix_sort(first, last); },
+        [](Iterator first, Iterator last) { radix_sort<11>(first, last); },
+        [](Iterator first, Iterator last) { selection_sort(first, last); },
+        [](Iterator first, Iterator last) { shell_sort(first, last); },
+        [](Iterator first, Iterator last) { tim_sort(first, last); }
+    };
+
+    for (auto sorting_algo : sorting_functions) {
+        algo_sorted = original;
+        sorting_algo(algo_sorted.begin(), algo_sorted.end());
+        REQUIRE(algo_sorted == std_sorted);
+    }
+
+    // Descending order of doubles, including empty and single element ranges
+    vector<double> doubles{2.5, -0.5, 1e300, -1e-300, 2.5, 0.0};
+    vector<double> std_doubles = doubles;
+    std::sort(std_doubles.rbegin(), std_doubles.rend());
+    vector<double> sorted_doubles = doubles;
+    quick_sort(sorted_doubles.begin(), sorted_doubles.end(), std::greater<double>());
+    REQUIRE(sorted_doubles == std_doubles);
+    sorted_doubles = doubles;
+    heap_sort(sorted_doubles.begin(), sorted_doubles.end(), std::greater<double>());
+    REQUIRE(sorted_doubles == std_doubles);
+    sorted_doubles = doubles;
+    shell_sort(sorted_doubles.begin(), sorted_doubles.end(), std::greater<double>());
+    REQUIRE(sorted_doubles == std_doubles);
+
+    vector<double> empty;
+    merge_sort(empty.begin(), empty.end());
+    quick_sort(empty.begin(), empty.begin());
+    heap_sort(doubles.begin(), doubles.begin() + 1);
+    REQUIRE(empty.empty());
+    REQUIRE(doubles[0] == 2.5);
+}
+
+TEST_CASE("Stable generic sorting of structs", "[sorting][generic]") {
+    struct Record {
+        int key;
+        int position;
+    };
+    auto by_key = [](const Record& a, const Record& b) { return a.key < b.key; };
+    auto is_stably_sorted = [](const vector<Record>& records) {
+        for (size_t i = 1; i < records.size(); i++) {
+            if (records[i - 1].key > records[i].key or
+                (records[i - 1].key == records[i].key and records[i - 1].position > records[i].position))
+                return false;
+        }
+        return true;
+    };
+
+    vector<Record> original;
+    for (int i = 0; i < 200; i++)
+        original.push_back({generate_random_int(0, 9), i});
+
+    vector<Record> records = original;
+    bubble_sort(records.begin(), records.end(), by_key);
+    REQUIRE(is_stably_sorted(records));
+
+    records = original;
+    insertion_sort(records.begin(), records.end(), by_key);
+    REQUIRE(is_stably_sorted(records));
+
+    records = original;
+    merge_sort(records.begin(), records.end(), by_key);
+    REQUIRE(is_stably_sorted(records));
+
+    records = original;
+    tim_sort(records.begin(), records.end(), by_key);
+    REQUIRE(is_stably_sorted(records));
+}
+
+TEST_CASE("Merge sort with a single buffer", "[sorting][merge_sort]") {
+    // Elements need not be default constructible
+    struct Key {
+        explicit Key(int value) : value(value) {}
+        int value;
+    };
+    auto by_value = [](const Key& a, const Key& b) { return a.value < b.value; };
+
+    for (int times_to_run = 0; times_to_run < TIMES_TO_RUN; times_to_run++) {
+        vector<int> values = generate_unsorted_vector();
+        vector<int> std_sorted = values;
+        std::sort(std_sorted.begin(), std_sorted.end());
+
+        vector<Key> keys;
+        for (int value : values)
+            keys.emplace_back(value);
+        merge_sort(keys.begin(), keys.end(), by_value);
+        REQUIRE(std::equal(keys.begin(), keys.end(), std_sorted.begin(),
+                           [](const Key& key, int value) { return key.value == value; }));
+
+        // A caller-supplied buffer, which may be larger than needed
+        vector<int> buffer(values.size() + 5);
+        merge_sort_with_buffer(values.begin(), values.end(), buffer.begin());
+        REQUIRE(values == std_sorted);
+    }
+}
+
+TEST_CASE("Introsort and pdqsort on adversarial patterns", "[sorting][introsort][pdq_sort]") {
+    const int size = 100000;
+    vector<int> ascending(size), descending(size), organ_pipe(size), equal(size, 7), sawtooth(size);
+    for (int i = 0; i < size; i++) {
+        ascending[i] = i;
+        descending[i] = size - i;
+        organ_pipe[i] = i < size / 2 ? i : size - i;
+        sawtooth[i] = i % 64;
+    }
+
+    for (vector<int> values : {ascending, descending, organ_pipe, equal, sawtooth}) {
+        vector<int> std_sorted = values;
+        std::sort(std_sorted.begin(), std_sorted.end());
+
+        vector<int> algo_sorted = values;
+        introsort(algo_sorted, 1, false);
+        REQUIRE(algo_sorted == std_sorted);
+
+        algo_sorted = values;
+        pdq_sort(algo_sorted, 1, false);
+        REQUIRE(algo_sorted == std_sorted);
+
+        // Block partitioning also works with comparators that are not std::less
+        algo_sorted = values;
+        pdq_sort_branchless(algo_sorted.begin(), algo_sorted.end(),
+                            [](int a, int b) { return a < b; });
+        REQUIRE(algo_sorted == std_sorted);
+    }
+}
+
+TEST_CASE("Parallel merge sort", "[sorting][parallel_merge_sort]") {
+    struct Record {
+        int key;
+        int position;
+    };
+    auto by_key = [](const Record& a, const Record& b) { return a.key < b.key; };
+
+    vector<Record> records;
+    for (int i = 0; i < 50000; i++)
+        records.push_back({generate_random_int(0, 1000), i});
+    vector<Record> std_sorted = records;
+    std::stable_sort(std_sorted.begin(), std_sorted.end(), by_key);
+
+    // Small grain sizes force many levels of parallel sorting and merging
+    for (size_t num_threads : {1, 2, 4}) {
+        for (size_t grain_size : {1, 100, 4096}) {
+            vector<Record> algo_sorted = records;
+            parallel_merge_sort(algo_sorted.begin(), algo_sorted.end(), by_key, num_threads, grain_size);
+            REQUIRE(std::equal(algo_sorted.begin(), algo_sorted.end(), std_sorted.begin(),
+                               [](const Record& a, const Record& b) {
+                                   return a.key == b.key and a.position == b.position;
+                               }));
+        }
+    }
+
+    // A pool can be reused across sorts
+    WorkStealingPool pool(3);
+    for (int times_to_run = 0; times_to_run < 3; times_to_run++) {
+        vector<int> values = generate_unsorted_vector(100000);
+        vector<int> std_values = values;
+        std::sort(std_values.rbegin(), std_values.rend());
+        parallel_merge_sort(pool, values.begin(), values.end(), std::greater<int>(), 512);
+        REQUIRE(values == std_values);
+    }
+
+    // An exception thrown by the comparator in any task reaches the caller,
+    // and leaves the pool usable
+    vector<int> values(100000);
+    for (int& value : values)
+        value = generate_random_int(0, 10000);
+    auto throwing_less = [](int a, int b) {
+        if (a == 12345 or b == 12345)
+            throw std::runtime_error("comparison failed");
+        return a < b;
+    };
+    values[values.size() / 3] = 12345;
+    REQUIRE_THROWS_AS(parallel_merge_sort(pool, values.begin(), values.end(), throwing_less, 512),
+                      std::runtime_error);
+
+    values = generate_unsorted_vector(100000);
+    vector<int> std_values = values;
+    std::sort(std_values.begin(), std_values.end());
+    parallel_merge_sort(pool, values.begin(), values.end(), std::less<int>(), 512);
+    REQUIRE(values == std_values);
+
+    // A task that cannot be submitted isn't waited for
+    struct UncopyableTask {
+        UncopyableTask() = default;
+        UncopyableTask(UncopyableTask&&) = default;
+        UncopyableTask(const UncopyableTask&) {
+            throw std::bad_alloc();
+        }
+        void operator()() const {}
+    };
+    TaskGroup group(pool);
+    REQUIRE_THROWS_AS(group.run(UncopyableTask()), std::bad_alloc);
+    group.wait();
+}
+
+TEST_CASE("Tim sort on runs", "[sorting][tim_sort]") {
+    struct Record {
+        int key;
+        int position;
+    };
+    auto by_key = [](const Record& a, const Record& b) { return a.key < b.key; };
+    const int size = 100000;
+
+    // Ascending, descending, organ pipe, few long runs with duplicate keys
+    // (which gallop), and sorted input with a few random elements appended
+    vector<vector<int>> patterns(5, vector<int>(size));
+    for (int i = 0; i < size; i++) {
+        patterns[0][i] = i;
+        patterns[1][i] = size - i;
+        patterns[2][i] = i < size / 2 ? i : size - i;
+        patterns[3][i] = (i * 7) % 1000 + (i / 20000) * 3;
+        patterns[4][i] = i < size - 100 ? i / 2 : generate_random_int(0, size);
+    }
+    for (int i = 0; i < size; i += size / 10)
+        std::sort(patterns[3].begin() + i, patterns[3].begin() + i + size / 10);
+
+    for (const vector<int>& keys : patterns) {
+        vector<Record> records;
+        for (int i = 0; i < size; i++)
+            records.push_back({keys[i], i});
+        vector<Record> std_sorted = records;
+        std::stable_sort(std_sorted.begin(), std_sorted.end(), by_key);
+
+        tim_sort(records.begin(), records.end(), by_key);
+        REQUIRE(std::equal(records.begin(), records.end(), std_sorted.begin(),
+                           [](const Record& a, const Record& b) {
+                               return a.key == b.key and a.position == b.position;
+                           }));
+    }
+}
+
+TEST_CASE("Radix sort of signed, unsigned and floating point keys", "[sorting][radix_sort]") {
+    std::mt19937_64 generator(TIMES_TO_RUN);
+
+    vector<long long> longs{
+        std::numeric_limits<long long>::max(), -1, 0, std::numeric_limits<long long>::min(), 1, -1
+    };
+    vector<unsigned> unsigneds{4000000000u, 0, 7, 4000000000u, 1u << 31};
+    vector<float> floats{2.5f, -0.0f, 0.0f, -1e30f, std::numeric_limits<float>::infinity(),
+                         -std::numeric_limits<float>::infinity(), 1e-40f, -1e-40f, -2.5f};
+    vector<double> doubles{3.25, -3.25, 1e300, -1e-300, 0.0, std::numeric_limits<double>::lowest()};
+    for (int i = 0; i < 10000; i++) {
+        longs.push_back(generator());
+        unsigneds.push_back(generator() >> (generator() % 64));
+        floats.push_back(std::ldexp(float(generator() % 2000) - 1000, generator() % 100 - 50));
+        doubles.push_back(std::ldexp(double(generator() % 2000) - 1000, generator() % 600 - 300));
+    }
+
+    auto check = [](auto values) {
+        auto std_sorted = values;
+        std::sort(std_sorted.begin(), std_sorted.end());
+        radix_sort(values.begin(), values.end());
+        REQUIRE(values == std_sorted);
+
+        std::sort(std_sorted.rbegin(), std_sorted.rend());
+        radix_sort<11>(values.begin(), values.end(), RadixIdentity(), -1);
+        REQUIRE(values == std_sorted);
+    };
+    check(longs);
+    check(unsigneds);
+    check(floats);
+    check(doubles);
+
+    // -0.0 is placed before 0.0
+    vector<double> zeros{0.0, -0.0};
+    radix_sort(zeros.begin(), zeros.end());
+    REQUIRE(std::signbit(zeros[0]));
+
+    // Sorting by a key is stable; only the varying low byte needs a pass
+    struct Record {
+        short key;
+        int position;
+    };
+    vector<Record> records;
+    for (int i = 0; i < 1000; i++)
+        records.push_back({short(0x1200 + generate_random_int(0, 15)), i});
+    vector<Record> std_sorted = records;
+    auto by_key = [](const Record& a, const Record& b) { return a.key < b.key; };
+    std::stable_sort(std_sorted.begin(), std_sorted.end(), by_key);
+    radix_sort(records.begin(), records.end(), [](const Record& record) { return record.key; });
+    REQUIRE(std::equal(records.begin(), records.end(), std_sorted.begin(),
+                       [](const Record& a, const Record& b) {
+                           return a.key == b.key and a.position == b.position;
+                       }));
+}
+
+TEST_CASE("American flag sort of string and tuple keys", "[sorting][american_flag_sort]") {
+    struct Person {
+        std::string name;
+        int age;
+        double height;
+    };
+    auto generate_name = []() {
+        std::string name;
+        int length = generate_random_int(0, 6);
+        while (length--)
+            name += char(generate_random_int(0, 3) == 0 ? generate_random_int(128, 255) : generate_random_int('a', 'd'));
+        return name;
+    };
+
+    vector<Person> people;
+    for (int i = 0; i < 2000; i++)
+        people.push_back({generate_name(), generate_random_int(-50, 50), generate_random_int(-3, 3) / 2.0});
+    // Long shared prefixes
+    for (int i = 0; i < 100; i++)
+        people.push_back({std::string(300, 'x') + generate_name(), i, 0.0});
+
+    auto same_order = [](const vector<Person>& a, const vector<Person>& b) {
+        return std::equal(a.begin(), a.end(), b.begin(), [](const Person& x, const Person& y) {
+            return x.name == y.name and x.age == y.age and x.height == y.height;
+        });
+    };
+
+    // String keys, returned by reference
+    auto by_name = [](const Person& a, const Person& b) { return a.name < b.name; };
+    vector<Person> algo_sorted = people, std_sorted = people;
+    american_flag_sort(algo_sorted.begin(), algo_sorted.end(),
+                       [](const Person& person) -> const std::string& { return person.name; });
+    std::sort(std_sorted.begin(), std_sorted.end(), by_name);
+    REQUIRE(std::equal(algo_sorted.begin(), algo_sorted.end(), std_sorted.begin(),
+                       [](const Person& x, const Person& y) { return x.name == y.name; }));
+
+    // Tuple keys, in both orders
+    auto key_of = [](const Person& person) { return std::tie(person.name, person.age, person.height); };
+    auto by_tuple = [&](const Person& a, const Person& b) { return key_of(a) < key_of(b); };
+    algo_sorted = std_sorted = people;
+    american_flag_sort(algo_sorted.begin(), algo_sorted.end(), key_of);
+    std::sort(std_sorted.begin(), std_sorted.end(), by_tuple);
+    REQUIRE(same_order(algo_sorted, std_sorted));
+
+    algo_sorted = people;
+    american_flag_sort(algo_sorted.begin(), algo_sorted.end(), key_of, -1);
+    std::reverse(std_sorted.begin(), std_sorted.end());
+    REQUIRE(same_order(algo_sorted, std_sorted));
+
+    // Pair keys, with the string second
+    auto pair_of = [](const Person& person) { return std::pair<int, const std::string&>(person.age, person.name); };
+    algo_sorted = std_sorted = people;
+    american_flag_sort(algo_sorted.begin(), algo_sorted.end(), pair_of);
+    std::sort(std_sorted.begin(), std_sorted.end(),
+              [&](const Person& a, const Person& b) { return pair_of(a) < pair_of(b); });
+    REQUIRE(std::equal(algo_sorted.begin(), algo_sorted.end(), std_sorted.begin(),
+                       [&](const Person& x, const Person& y) { return pair_of(x) == pair_of(y); }));
+
+    // Nested prefixes ("a", "aa", "aaa", ...), which split off one key per
+    // digit, must not recurse once per digit
+    vector<std::string> prefixes;
+    for (size_t length = 1; length <= 1000; length++)
+        prefixes.push_back(std::string(length, 'a'));
+    vector<std::string> std_prefixes = prefixes;
+    std::shuffle(prefixes.begin(), prefixes.end(), std::mt19937(1));
+    american_flag_sort(prefixes.begin(), prefixes.end());
+    REQUIRE(prefixes == std_prefixes);
+    american_flag_sort(prefixes.begin(), prefixes.end(), RadixIdentity(), -1);
+    std::reverse(std_prefixes.begin(), std_prefixes.end());
+    REQUIRE(prefixes == std_prefixes);
+
+    // Large arrays of numbers
+    vector<long long> longs(20000);
+    for (long long& value : longs)
+        value = (long long) generate_random_int(-1000000, 1000000) * generate_random_int(-1000, 1000);
+    vector<long long> std_longs = longs;
+    std::sort(std_longs.begin(), std_longs.end());
+    american_flag_sort(longs.begin(), longs.end());
+    REQUIRE(longs == std_longs);
+}
+
+TEST_CASE("Parallel radix sort", "[sorting][parallel_radix_sort]") {
+    struct Record {
+        int key;
+        int position;
+    };
+    auto by_key = [](const Record& a, const Record& b) { return a.key < b.key; };
+    auto same_order = [](const vector<Record>& a, const vector<Record>& b) {
+        return std::equal(a.begin(), a.end(), b.begin(), [](const Record& x, const Record& y) {
+            return x.key == y.key and x.position == y.position;
+        });
+    };
+
+    // Enough elements for several chunks; keys that span one, two and all bytes
+    const int size = 300000;
+    for (int max_key : {200, 60000, std::numeric_limits<int>::max()}) {
+        vector<Record> records;
+        for (int i = 0; i < size; i++)
+            records.push_back({generate_random_int(-max_key, max_key), i});
+        vector<Record> std_sorted = records;
+        std::stable_sort(std_sorted.begin(), std_sorted.end(), by_key);
+        auto key_of = [](const Record& record) { return record.key; };
+
+        for (size_t num_threads : {1, 2, 4}) {
+            vector<Record> algo_sorted = records;
+            parallel_radix_sort(algo_sorted.begin(), algo_sorted.end(), key_of, 1, num_threads);
+            REQUIRE(same_order(algo_sorted, std_sorted));
+        }
+
+        // Descending order with 11 bit digits on a reused pool
+        WorkStealingPool pool(3);
+        vector<Record> algo_sorted = records;
+        parallel_radix_sort<11>(pool, algo_sorted.begin(), algo_sorted.end(), key_of, -1);
+        std::stable_sort(std_sorted.begin(), std_sorted.end(),
+                         [](const Record& a, const Record& b) { return a.key > b.key; });
+        REQUIRE(std::is_sorted(algo_sorted.begin(), algo_sorted.end(),
+                               [](const Record& a, const Record& b) { return a.key > b.key; }));
+        REQUIRE(same_order(algo_sorted, std_sorted));
+    }
+
+    vector<double> doubles(size);
+    for (double& value : doubles)
+        value = generate_random_int(-1000000, 1000000) / 7.0;
+    vector<double> std_doubles = doubles;
+    std::sort(std_doubles.begin(), std_doubles.end());
+    parallel_radix_sort(doubles.begin(), doubles.end(), RadixIdentity(), 1, 3);
+    REQUIRE(doubles == std_doubles);
+}
+
+TEST_CASE("Counting sort of records and sparse keys", "[sorting][counting_sort]") {
+    struct Record {
+        unsigned char grade;
+        int position;
+    };
+    auto key_of = [](const Record& record) { return record.grade; };
+    auto same_order = [](const vector<Record>& a, const vector<Record>& b) {
+        return std::equal(a.begin(), a.end(), b.begin(), [](const Record& x, const Record& y) {
+            return x.grade == y.grade and x.position == y.position;
+        });
+    };
+
+    // Sizes that need 8, 16 and 32 bit counters
+    for (int size : {200, 255, 256, 60000, 70000}) {
+        vector<Record> records;
+        for (int i = 0; i < size; i++)
+            records.push_back({(unsigned char) generate_random_int(0, 255), i});
+
+        vector<Record> algo_sorted = records, std_sorted = records;
+        counting_sort(algo_sorted.begin(), algo_sorted.end(), key_of);
+        std::stable_sort(std_sorted.begin(), std_sorted.end(),
+                         [](const Record& a, const Record& b) { return a.grade < b.grade; });
+        REQUIRE(same_order(algo_sorted, std_sorted));
+
+        algo_sorted = records;
+        counting_sort(algo_sorted.begin(), algo_sorted.end(), key_of, -1);
+        std::stable_sort(std_sorted.begin(), std_sorted.end(),
+                         [](const Record& a, const Record& b) { return a.grade > b.grade; });
+        REQUIRE(same_order(algo_sorted, std_sorted));
+    }
+
+    // Outliers make the range too large to count, so these are radix sorted
+    vector<int> values = generate_unsorted_vector();
+    values.push_back(std::numeric_limits<int>::min());
+    values.push_back(std::numeric_limits<int>::max());
+    vector<int> std_sorted = values;
+    std::sort(std_sorted.begin(), std_sorted.end());
+    counting_sort(values, 1, false);
+    REQUIRE(values == std_sorted);
+
+    // Small types at the ends of their range
+    vector<signed char> chars{127, -128, 0, -1, 127, 5, -128};
+    vector<signed char> std_chars = chars;
+    std::sort(std_chars.rbegin(), std_chars.rend());
+    counting_sort(chars.begin(), chars.end(), RadixIdentity(), -1);
+    REQUIRE(chars == std_chars);
+}
+
+TEST_CASE("Bucket sort of wide and skewed keys", "[sorting][bucket_sort]") {
+    std::mt19937_64 generator(TIMES_TO_RUN);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::exponential_distribution<double> skewed(0.01);
+
+    vector<vector<double>> inputs(5);
+    for (int i = 0; i < 50000; i++) {
+        inputs[0].push_back(uniform(generator));
+        inputs[1].push_back(skewed(generator) * skewed(generator));
+        inputs[2].push_back(1.0 + (i % 3) * std::numeric_limits<double>::epsilon());
+        inputs[3].push_back(i % 2 ? std::numeric_limits<double>::max() / (i + 1)
+                                  : std::numeric_limits<double>::lowest() / (i + 1));
+    }
+    // A range so small that its reciprocal overflows
+    inputs[4] = {4e-323, 0.0, 5e-324, 4e-323, 1e-323, 0.0};
+
+    for (vector<double>& values : inputs) {
+        vector<double> std_sorted = values;
+        std::sort(std_sorted.begin(), std_sorted.end());
+        vector<double> algo_sorted = values;
+        bucket_sort(algo_sorted.begin(), algo_sorted.end());
+        REQUIRE(algo_sorted == std_sorted);
+
+        std::reverse(std_sorted.begin(), std_sorted.end());
+        bucket_sort(values.begin(), values.end(), RadixIdentity(), -1);
+        REQUIRE(values == std_sorted);
+    }
+
+    // 64 bit keys that differ beyond the precision of doubles, sorted stably
+    struct Record {
+        long long key;
+        int position;
+    };
+    vector<Record> records;
+    for (int i = 0; i < 20000; i++)
+        records.push_back({(1LL << 60) + generate_random_int(0, 100), i});
+    records.push_back({std::numeric_limits<long long>::min(), -1});
+    vector<Record> std_records = records;
+    std::stable_sort(std_records.begin(), std_records.end(),
+                     [](const Record& a, const Record& b) { return a.key > b.key; });
+    bucket_sort(records.begin(), records.end(), [](const Record& record) { return record.key; }, -1);
+    REQUIRE(std::equal(records.begin(), records.end(), std_records.begin(),
+                       [](const Record& a, const Record& b) {
+                           return a.key == b.key and a.position == b.position;
+                       }));
+}
+
+TEST_CASE("Sorting networks", "[sorting][sorting_network]") {
+    std::mt19937 generator(TIMES_TO_RUN);
+
+    // Exact network sizes
+    vector<int32_t> keys(64);
+    for (int32_t& key : keys)
+        key = int32_t(generator());
+    vector<int32_t> std_keys = keys;
+    std::sort(std_keys.begin(), std_keys.begin() + 8);
+    sorting_network_sort<8>(keys.data());
+    REQUIRE(std::equal(keys.begin(), keys.begin() + 8, std_keys.begin()));
+    std::sort(std_keys.begin(), std_keys.end());
+    sorting_network_sort<64>(keys.data());
+    REQUIRE(keys == std_keys);
+
+    // Every size up to the largest network, with extreme and repeated keys
+    for (size_t size = 0; size <= SORTING_NETWORK_MAX_SIZE; size++) {
+        vector<int32_t> signed_keys(size);
+        vector<uint32_t> unsigned_keys(size);
+        vector<float> float_keys(size);
+        for (size_t i = 0; i < size; i++) {
+            signed_keys[i] = i % 7 == 0 ? std::numeric_limits<int32_t>::max() : int32_t(generator() % 21) - 10;
+            unsigned_keys[i] = i % 5 == 0 ? 0xFFFFFFFFu : generator();
+            float_keys[i] = i % 6 == 0 ? -std::numeric_limits<float>::infinity() : float(int(generator() % 200) - 100) / 8;
+        }
+
+        vector<int32_t> std_signed = signed_keys;
+        vector<uint32_t> std_unsigned = unsigned_keys;
+        vector<float> std_floats = float_keys;
+        std::sort(std_signed.begin(), std_signed.end());
+        std::sort(std_unsigned.begin(), std_unsigned.end());
+        std::sort(std_floats.begin(), std_floats.end());
+
+        sorting_network_sort(signed_keys.data(), size);
+        sorting_network_sort(unsigned_keys.data(), size);
+        sorting_network_sort(float_keys.data(), size);
+        REQUIRE(signed_keys == std_signed);
+        REQUIRE(unsigned_keys == std_unsigned);
+        REQUIRE(float_keys == std_floats);
+    }
+
+    // Many tiny arrays, e.g. the top candidates of queries
+    const size_t num_arrays = 100, array_size = 10;
+    vector<int32_t> candidates(num_arrays * array_size);
+    for (int32_t& candidate : candidates)
+        candidate = int32_t(generator() % 1000);
+    vector<int32_t> std_candidates = candidates;
+    for (size_t i = 0; i < num_arrays; i++)
+        std::sort(std_candidates.begin() + i * array_size, std_candidates.begin() + (i + 1) * array_size);
+    sort_tiny_arrays(candidates.data(), num_arrays, array_size);
+    REQUIRE(candidates == std_candidates);
+
+    // Arrays larger than the largest network are insertion sorted
+    const size_t large_size = 3 * SORTING_NETWORK_MAX_SIZE;
+    vector<int32_t> large_arrays(2 * large_size);
+    vector<uint32_t> large_unsigned(large_size);
+    vector<float> large_floats(large_size);
+    for (int32_t& key : large_arrays)
+        key = int32_t(generator());
+    for (size_t i = 0; i < large_size; i++) {
+        large_unsigned[i] = generator();
+        large_floats[i] = float(int(generator() % 200) - 100) / 8;
+    }
+    vector<int32_t> std_large_arrays = large_arrays;
+    vector<uint32_t> std_large_unsigned = large_unsigned;
+    vector<float> std_large_floats = large_floats;
+    std::sort(std_large_arrays.begin(), std_large_arrays.begin() + large_size);
+    std::sort(std_large_arrays.begin() + large_size, std_large_arrays.end());
+    std::sort(std_large_unsigned.begin(), std_large_unsigned.end());
+    std::sort(std_large_floats.begin(), std_large_floats.end());
+    sort_tiny_arrays(large_arrays.data(), 2, large_size);
+    sorting_network_sort(large_unsigned.data(), large_size);
+    sorting_network_sort(large_floats.data(), large_size);
+    REQUIRE(large_arrays == std_large_arrays);
+    REQUIRE(large_unsigned == std_large_unsigned);
+    REQUIRE(large_floats == std_large_floats);
+
+    // small_sort in both orders
+    vector<int> values = generate_unsorted_vector(SORTING_NETWORK_MAX_SIZE);
+    vector<int> std_values = values;
+    std::sort(std_values.rbegin(), std_values.rend());
+    small_sort(values.begin(), values.end(), std::greater<int>());
+    REQUIRE(values == std_values);
+
+    // Comparators of another key type order the keys differently from the
+    // networks, so they must not use them
+    REQUIRE(HasSortingNetwork<int32_t*, std::less<int32_t>>::value == bool(SORTING_NETWORK_SIMD));
+    REQUIRE(HasSortingNetwork<int32_t*, std::greater<>>::value == bool(SORTING_NETWORK_SIMD));
+    REQUIRE_FALSE(HasSortingNetwork<int32_t*, std::less<uint32_t>>::value);
+    REQUIRE_FALSE(HasMergeNetwork<int32_t*, int32_t*, int32_t*, std::greater<int64_t>>::value);
+    vector<int32_t> mixed_signs(1000);
+    for (int32_t& key : mixed_signs)
+        key = int32_t(generator());
+    for (const bool descending : {false, true}) {
+        vector<int32_t> algo_sorted = mixed_signs, std_sorted = mixed_signs;
+        if (descending) {
+            quick_sort(algo_sorted.begin(), algo_sorted.end(), std::greater<uint32_t>());
+            std::sort(std_sorted.begin(), std_sorted.end(), std::greater<uint32_t>());
+        }
+        else {
+            quick_sort(algo_sorted.begin(), algo_sorted.end(), std::less<uint32_t>());
+            std::sort(std_sorted.begin(), std_sorted.end(), std::less<uint32_t>());
+        }
+        REQUIRE(algo_sorted == std_sorted);
+
+        algo_sorted = mixed_signs;
+        if (descending)
+            merge_sort(algo_sorted.begin(), algo_sorted.end(), std::greater<uint32_t>());
+        else
+            merge_sort(algo_sorted.begin(), algo_sorted.end(), std::less<uint32_t>());
+        REQUIRE(algo_sorted == std_sorted);
+    }
+}
+
+TEST_CASE("Bitonic merge of 32 and 64 bit keys", "[sorting][sorting_network][merge_sort]") {
+    std::mt19937 generator(TIMES_TO_RUN);
+
+    // Every split of up to 100 keys, so that both ranges run out in every way
+    for (size_t size = 0; size <= 100; size++) {
+        for (size_t split = 0; split <= size; split++) {
+            vector<int32_t> keys(size);
+            vector<int64_t> wide_keys(size);
+            for (size_t i = 0; i < size; i++) {
+                keys[i] = int32_t(generator() % 50) - 25;
+                wide_keys[i] = (int64_t(generator()) << 31) - (int64_t(1) << 62);
+            }
+            std::sort(keys.begin(), keys.begin() + split);
+            std::sort(keys.begin() + split, keys.end());
+            std::sort(wide_keys.begin(), wide_keys.begin() + split, std::greater<int64_t>());
+            std::sort(wide_keys.begin() + split, wide_keys.end(), std::greater<int64_t>());
+
+            vector<int32_t> merged(size);
+            vector<int64_t> wide_merged(size);
+            REQUIRE(bitonic_merge(keys.data(), keys.data() + split, keys.data() + split, keys.data() + size,
+                                  merged.data()) == merged.data() + size);
+            bitonic_merge(wide_keys.data(), wide_keys.data() + split, wide_keys.data() + split,
+                          wide_keys.data() + size, wide_merged.data(), std::greater<int64_t>());
+
+            std::sort(keys.begin(), keys.end());
+            std::sort(wide_keys.begin(), wide_keys.end(), std::greater<int64_t>());
+            REQUIRE(merged == keys);
+            REQUIRE(wide_merged == wide_keys);
+        }
+    }
+
+    // Merge sort merges such ranges with the network
+    vector<int64_t> longs(100000);
+    for (int64_t& value : longs)
+        value = int64_t(generator()) * (generator() % 2 ? 1 : -1);
+    vector<int64_t> std_longs = longs;
+    std::sort(std_longs.begin(), std_longs.end());
+    merge_sort(longs.begin(), longs.end());
+    REQUIRE(longs == std_longs);
+}
+
+TEST_CASE("K-way merge", "[sorting][k_way_merge]") {
+    std::mt19937 generator(TIMES_TO_RUN);
+
+    for (size_t num_runs : {0, 1, 2, 3, 7, 64, 300}) {
+        vector<vector<int>> runs(num_runs);
+        vector<int> std_merged;
+        for (vector<int>& run : runs) {
+            run.resize(generator() % 50);
+            for (int& value : run)
+                value = int(generator() % 1000);
+            std::sort(run.begin(), run.end());
+            std_merged.insert(std_merged.end(), run.begin(), run.end());
+        }
+        std::sort(std_merged.begin(), std_merged.end());
+        REQUIRE(k_way_merge(runs) == std_merged);
+    }
+
+    // Ties keep the order of the runs
+    using Record = std::pair<int, size_t>;
+    vector<vector<Record>> record_runs(10);
+    for (size_t run = 0; run < record_runs.size(); run++) {
+        for (int key = 100; key > 0; key -= int(generator() % 3) + 1)
+            record_runs[run].emplace_back(key, run);
+    }
+    auto by_key_descending = [](const Record& a, const Record& b) { return a.first > b.first; };
+    const vector<Record> records = k_way_merge(record_runs, by_key_descending);
+    REQUIRE(std::is_sorted(records.begin(), records.end(), [](const Record& a, const Record& b) {
+        return a.first > b.first or (a.first == b.first and a.second < b.second);
+    }));
+
+    // Iterator pairs, moving the elements into an existing range
+    vector<vector<std::string>> words{{"apple", "kiwi"}, {}, {"banana", "cherry", "zucchini"}};
+    using MoveIt = std::move_iterator<vector<std::string>::iterator>;
+    vector<std::pair<MoveIt, MoveIt>> ranges;
+    for (vector<std::string>& run : words)
+        ranges.emplace_back(std::make_move_iterator(run.begin()), std::make_move_iterator(run.end()));
+    vector<std::string> merged(5);
+    REQUIRE(k_way_merge(ranges.begin(), ranges.end(), merged.begin()) == merged.end());
+    REQUIRE(merged == vector<std::string>{"apple", "banana", "cherry", "kiwi", "zucchini"});
+}
+
+TEST_CASE("External sort of records", "[sorting][external_sort]") {
+    struct Record {
+        uint64_t key;
+        uint32_t sequence;
+        uint32_t payload;
+    };
+    auto by_key = [](const Record& a, const Record& b) { return a.key < b.key; };
+    std::mt19937 generator(TIMES_TO_RUN);
+
+    // Up to 4 records per run, and more runs than are merged at once
+    for (size_t size : {0, 1, 5, 100, 3000}) {
+        vector<Record> records(size);
+        for (size_t i = 0; i < size; i++)
+            records[i] = Record{generator() % 200, uint32_t(i), uint32_t(generator())};
+
+        FileHandle input = make_temp_file();
+        FileHandle output = make_temp_file();
+        write_records(input.get(), records.data(), size);
+        std::rewind(input.get());
+        external_sort<Record>(input.get(), output.get(), by_key, 4 * 4 * sizeof(Record));
+
+        std::stable_sort(records.begin(), records.end(), by_key);
+        vector<Record> sorted(size + 1);
+        std::rewind(output.get());
+        REQUIRE(read_records(output.get(), sorted.data(), size + 1) == size);
+        for (size_t i = 0; i < size; i++) {
+            REQUIRE(sorted[i].key == records[i].key);
+            REQUIRE(sorted[i].sequence == records[i].sequence);
+        }
+    }
+
+    // Records in memory (e.g. mapped from a file), in descending order
+    vector<int32_t> values(10000);
+    for (int32_t& value : values)
+        value = int32_t(generator());
+    FileHandle output = make_temp_file();
+    external_sort(values.data(), values.data() + values.size(), output.get(), std::greater<int32_t>(), 4096);
+
+    vector<int32_t> sorted(values.size());
+    std::rewind(output.get());
+    REQUIRE(read_records(output.get(), sorted.data(), sorted.size()) == sorted.size());
+    std::sort(values.begin(), values.end(), std::greater<int32_t>());
+    REQUIRE(sorted == values);
+}
+
+TEST_CASE("Key-value sorting and argsort", "[sorting][by_key][argsort]") {
+    std::mt19937 generator(TIMES_TO_RUN);
+
+    for (size_t size : {0, 1, 2, 17, 100, 1000, 5000}) {
+        // Few distinct keys, so that stability matters
+        vector<int> keys(size);
+        for (int& key : keys)
+            key = int(generator() % 64) - 32;
+        vector<size_t> values(size);
+        std::iota(values.begin(), values.end(), 0);
+
+        vector<std::pair<int, size_t>> std_sorted, std_sorted_descending;
+        for (size_t i = 0; i < size; i++)
+            std_sorted.emplace_back(keys[i], values[i]);
+        std_sorted_descending = std_sorted;
+        std::stable_sort(std_sorted.begin(), std_sorted.end(), [](const std::pair<int, size_t>& a,
+                                                                   const std::pair<int, size_t>& b) {
+            return a.first < b.first;
+        });
+        std::stable_sort(std_sorted_descending.begin(), std_sorted_descending.end(),
+                         [](const std::pair<int, size_t>& a, const std::pair<int, size_t>& b) {
+            return a.first > b.first;
+        });
+
+        vector<size_t> std_argsort, std_argsort_descending;
+        for (const std::pair<int, size_t>& pair : std_sorted)
+            std_argsort.push_back(pair.second);
+        for (const std::pair<int, size_t>& pair : std_sorted_descending)
+            std_argsort_descending.push_back(pair.second);
+
+        auto zip = [](const vector<int>& sorted_keys, const vector<size_t>& sorted_values) {
+            vector<std::pair<int, size_t>> pairs;
+            for (size_t i = 0; i < sorted_keys.size(); i++)
+                pairs.emplace_back(sorted_keys[i], sorted_values[i]);
+            return pairs;
+        };
+
+        // Stable sorts
+        vector<int> sorted_keys = keys;
+        vector<size_t> sorted_values = values;
+        merge_sort_by_key(sorted_keys.begin(), sorted_keys.end(), sorted_values.begin());
+        REQUIRE(zip(sorted_keys, sorted_values) == std_sorted);
+
+        sorted_keys = keys;
+        sorted_values = values;
+        merge_sort_by_key(sorted_keys.begin(), sorted_keys.end(), sorted_values.begin(), std::greater<int>());
+        REQUIRE(zip(sorted_keys, sorted_values) == std_sorted_descending);
+
+        sorted_keys = keys;
+        sorted_values = values;
+        radix_sort_by_key(sorted_keys.begin(), sorted_keys.end(), sorted_values.begin());
+        REQUIRE(zip(sorted_keys, sorted_values) == std_sorted);
+
+        sorted_keys = keys;
+        sorted_values = values;
+        radix_sort_by_key(sorted_keys.begin(), sorted_keys.end(), sorted_values.begin(), -1);
+        REQUIRE(zip(sorted_keys, sorted_values) == std_sorted_descending);
+
+        sorted_keys = keys;
+        sorted_values = values;
+        counting_sort_by_key(sorted_keys.begin(), sorted_keys.end(), sorted_values.begin());
+        REQUIRE(zip(sorted_keys, sorted_values) == std_sorted);
+
+        sorted_keys = keys;
+        sorted_values = values;
+        counting_sort_by_key(sorted_keys.begin(), sorted_keys.end(), sorted_values.begin(), -1);
+        REQUIRE(zip(sorted_keys, sorted_values) == std_sorted_descending);
+
+        REQUIRE(merge_argsort(keys.begin(), keys.end()) == std_argsort);
+        REQUIRE(radix_argsort(keys.begin(), keys.end()) == std_argsort);
+        REQUIRE(radix_argsort(keys.begin(), keys.end(), RadixIdentity(), -1) == std_argsort_descending);
+        REQUIRE(counting_argsort(keys.begin(), keys.end()) == std_argsort);
+        REQUIRE(counting_argsort(keys.begin(), keys.end(), RadixIdentity(), -1) == std_argsort_descending);
+
+        // Quick sort is not stable: the keys are sorted, and every value stays
+        // with its key
+        sorted_keys = keys;
+        sorted_values = values;
+        quick_sort_by_key(sorted_keys.begin(), sorted_keys.end(), sorted_values.begin());
+        REQUIRE(std::is_sorted(sorted_keys.begin(), sorted_keys.end()));
+        for (size_t i = 0; i < size; i++)
+            REQUIRE(keys[sorted_values[i]] == sorted_keys[i]);
+        vector<size_t> permutation = sorted_values;
+        std::sort(permutation.begin(), permutation.end());
+        REQUIRE(permutation == values);
+
+        const vector<size_t> indices = quick_argsort(keys.begin(), keys.end(), std::greater<int>());
+        permutation = indices;
+        std::sort(permutation.begin(), permutation.end());
+        REQUIRE(permutation == values);
+        for (size_t i = 1; i < size; i++)
+            REQUIRE(keys[indices[i - 1]] >= keys[indices[i]]);
+    }
+
+    // Sparse keys fall back to radix sort, and values need not be integers
+    vector<long long> sparse_keys{1LL << 40, -5, 7, 1LL << 40, -(1LL << 50), 7};
+    vector<std::string> words{"a", "b", "c", "d", "e", "f"};
+    counting_sort_by_key(sparse_keys.begin(), sparse_keys.end(), words.begin());
+    REQUIRE(sparse_keys == vector<long long>{-(1LL << 50), -5, 7, 7, 1LL << 40, 1LL << 40});
+    REQUIRE(words == vector<std::string>{"e", "b", "c", "f", "a", "d"});
+
+    // Floating point keys, extracted from records
+    vector<std::pair<std::string, double>> records{{"x", 2.5}, {"y", -1.0}, {"z", 0.0}, {"w", -1.0}};
+    auto weight = [](const std::pair<std::string, double>& record) { return record.second; };
+    REQUIRE(radix_argsort(records.begin(), records.end(), weight) == vector<size_t>{1, 3, 2, 0});
+}
+
+TEST_CASE("Selection, partial sorting and top k", "[sorting][partial_sort]") {
+    std::mt19937 generator(TIMES_TO_RUN);
+
+    for (int times = 0; times < TIMES_TO_RUN; times++) {
+        vector<int> values = generate_unsorted_vector();
+        vector<int> std_sorted = values;
+        std::sort(std_sorted.begin(), std_sorted.end());
+        const size_t k = generator() % (values.size() + 1);
+
+        if (k < values.size()) {
+            vector<int> selected = values;
+            introselect(selected.begin(), selected.begin() + k, selected.end());
+            REQUIRE(selected[k] == std_sorted[k]);
+            REQUIRE(std::all_of(selected.begin(), selected.begin() + k,
+                                [&](int value) { return value <= selected[k]; }));
+            REQUIRE(std::all_of(selected.begin() + k, selected.end(),
+                                [&](int value) { return value >= selected[k]; }));
+
+            // Median of medians pivots from the start
+            selected = values;
+            introselect_loop(selected.begin(), selected.begin() + k, selected.end(), 0, std::less<>());
+            REQUIRE(selected[k] == std_sorted[k]);
+            REQUIRE(std::all_of(selected.begin(), selected.begin() + k,
+                                [&](int value) { return value <= selected[k]; }));
+        }
+
+        vector<int> partially_sorted = values;
+        partial_introsort(partially_sorted.begin(), partially_sorted.begin() + k, partially_sorted.end());
+        REQUIRE(std::equal(partially_sorted.begin(), partially_sorted.begin() + k, std_sorted.begin()));
+        std::sort(partially_sorted.begin(), partially_sorted.end());
+        REQUIRE(partially_sorted == std_sorted);
+
+        partially_sorted = values;
+        heap_partial_sort(partially_sorted.begin(), partially_sorted.begin() + k, partially_sorted.end());
+        REQUIRE(std::equal(partially_sorted.begin(), partially_sorted.begin() + k, std_sorted.begin()));
+        std::sort(partially_sorted.begin(), partially_sorted.end());
+        REQUIRE(partially_sorted == std_sorted);
+
+        TopK<int, std::greater<int>> largest(k);
+        largest.push(values.begin(), values.end());
+        REQUIRE(largest.sorted() == vector<int>(std_sorted.rbegin(), std_sorted.rbegin() + k));
+    }
+
+    // Many duplicates, and sorted input
+    vector<int> values(10000);
+    for (int& value : values)
+        value = int(generator() % 3);
+    vector<int> selected = values;
+    introselect_loop(selected.begin(), selected.begin() + 5000, selected.end(), 0, std::less<>());
+    vector<int> std_sorted = values;
+    std::sort(std_sorted.begin(), std_sorted.end());
+    REQUIRE(selected[5000] == std_sorted[5000]);
+
+    std::iota(values.begin(), values.end(), 0);
+    introselect(values.begin(), values.begin() + 1234, values.end(), std::greater<int>());
+    REQUIRE(values[1234] == 10000 - 1 - 1234);
+
+    // A stream with fewer elements than k, and k = 0
+    TopK<std::string> first_words(5);
+    for (const std::string word : {"pear", "fig", "apple"})
+        first_words.push(word);
+    REQUIRE(first_words.sorted() == vector<std::string>{"apple", "fig", "pear"});
+    TopK<int> none(0);
+    none.push(1);
+    REQUIRE(none.sorted().empty());
+}
+
+TEST_CASE("Heap sort with d-ary heaps", "[sorting][heap_sort]") {
+    std::mt19937 generator(TIMES_TO_RUN);
+
+    // Sizes around the levels of the heaps, including nodes with fewer
+    // children than the others
+    for (size_t size : {0, 1, 2, 3, 4, 5, 8, 9, 17, 64, 65, 100, 1000, 4097}) {
+        vector<int> values(size);
+        for (int& value : values)
+            value = int(generator() % (size + 1));
+        vector<int> std_sorted = values;
+        std::sort(std_sorted.begin(), std_sorted.end());
+
+        vector<int> sorted = values;
+        dary_heap_sort<2>(sorted.begin(), sorted.end());
+        REQUIRE(sorted == std_sorted);
+        sorted = values;
+        dary_heap_sort<3>(sorted.begin(), sorted.end());
+        REQUIRE(sorted == std_sorted);
+        sorted = values;
+        dary_heap_sort(sorted.begin(), sorted.end());
+        REQUIRE(sorted == std_sorted);
+        sorted = values;
+        dary_heap_sort<8>(sorted.begin(), sorted.end(), std::greater<int>());
+        REQUIRE(sorted == vector<int>(std_sorted.rbegin(), std_sorted.rend()));
+    }
+
+    // Elements that are only movable, and a step callback
+    vector<std::unique_ptr<int>> pointers;
+    for (int i = 0; i < 100; i++)
+        pointers.emplace_back(new int(int(generator() % 50)));
+    int num_steps = 0;
+    dary_heap_sort(pointers.begin(), pointers.end(),
+                   [](const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) { return *a < *b; },
+                   [&]() { num_steps++; });
+    REQUIRE(std::is_sorted(pointers.begin(), pointers.end(),
+                           [](const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) { return *a < *b; }));
+    REQUIRE(num_steps == 100);
+}
+
+TEST_CASE("Shell sort gap sequences", "[sorting][shell_sort]") {
+    REQUIRE(CiuraGaps::next_gap(1000) == 701);
+    REQUIRE(CiuraGaps::next_gap(701) == 301);
+    REQUIRE(CiuraGaps::next_gap(1) == 0);
+    REQUIRE(TokudaGaps::next_gap(10) == 9);
+    REQUIRE(SedgewickGaps::next_gap(100) == 77);
+    REQUIRE(ShellGaps::next_gap(10) == 5);
+
+    std::mt19937 generator(TIMES_TO_RUN);
+
+    // Sizes around the vector widths, whose last rows are partly vectorized,
+    // and keys at the ends of the range of int32_t
+    for (size_t size : {0, 1, 7, 8, 9, 16, 17, 100, 1000, 5000}) {
+        vector<int32_t> values(size);
+        for (int32_t& value : values)
+            value = int32_t(generator());
+        if (size > 2) {
+            values[0] = std::numeric_limits<int32_t>::max();
+            values[1] = std::numeric_limits<int32_t>::min();
+        }
+        vector<int32_t> std_sorted = values;
+        std::sort(std_sorted.begin(), std_sorted.end());
+        const vector<int32_t> reversed(std_sorted.rbegin(), std_sorted.rend());
+
+        for (const vector<int32_t>& input : {values, std_sorted, reversed}) {
+            vector<int32_t> sorted = input;
+            shell_sort(sorted.begin(), sorted.end());
+            REQUIRE(sorted == std_sorted);
+            sorted = input;
+            shell_sort<TokudaGaps>(sorted.begin(), sorted.end());
+            REQUIRE(sorted == std_sorted);
+            sorted = input;
+            shell_sort<SedgewickGaps>(sorted.begin(), sorted.end(), std::greater<int32_t>());
+            REQUIRE(sorted == reversed);
+            sorted = input;
+            shell_sort<ShellGaps>(sorted.begin(), sorted.end(), std::greater<>());
+            REQUIRE(sorted == reversed);
+        }
+    }
+
+    // Keys that are not 32 bit integers are always sorted by insertion
+    vector<double> doubles(1000);
+    for (double& value : doubles)
+        value = double(generator() % 100) / 8;
+    vector<double> std_sorted = doubles;
+    std::sort(std_sorted.begin(), std_sorted.end());
+    shell_sort(doubles.begin(), doubles.end());
+    REQUIRE(doubles == std_sorted);
+}
+
+TEST_CASE("Smart sort", "[sorting][smart_sort]") {
+    std::mt19937 generator(TIMES_TO_RUN);
+    const SmartSortThresholds thresholds;
+    const size_t sample_size = thresholds.sample_size;
+
+    vector<int> random_ints(10000);
+    for (int& value : random_ints)
+        value = int(generator());
+    vector<int> few_ints = random_ints;
+    for (int& value : few_ints)
+        value %= 100;
+    vector<int> sorted_ints = random_ints;
+    std::sort(sorted_ints.begin(), sorted_ints.end());
+    vector<double> random_doubles(random_ints.begin(), random_ints.end());
+    vector<std::string> random_strings(10000);
+    for (std::string& value : random_strings)
+        value = std::to_string(generator());
+    vector<std::string> few_strings(1000);
+    for (std::string& value : few_strings)
+        value = std::to_string(generator() % 3);
+
+    auto choice_for = [&](auto first, auto last, auto comp) {
+        using Value = typename std::iterator_traits<decltype(first)>::value_type;
+        using RadixKeys = HasRadixKeys<Value, decltype(comp)>;
+        return choose_smart_sort(sample_statistics(first, last, comp, sample_size), thresholds,
+                                 RadixKeys::value, RadixKeys::value and std::is_integral<Value>::value);
+    };
+    REQUIRE(choice_for(sorted_ints.begin(), sorted_ints.end(), std::less<>()) == USE_TIM_SORT);
+    REQUIRE(choice_for(sorted_ints.rbegin(), sorted_ints.rend(), std::less<>()) == USE_TIM_SORT);
+    REQUIRE(choice_for(random_ints.begin(), random_ints.end(), std::less<>()) == USE_RADIX_SORT);
+    REQUIRE(choice_for(few_ints.begin(), few_ints.end(), std::greater<int>()) == USE_COUNTING_SORT);
+    REQUIRE(choice_for(random_doubles.begin(), random_doubles.end(), std::less<double>()) == USE_RADIX_SORT);
+    REQUIRE(choice_for(random_ints.begin(), random_ints.end(), [](int a, int b) { return a < b; }) == USE_PDQ_SORT);
+    REQUIRE(choice_for(random_strings.begin(), random_strings.end(), std::less<>()) == USE_PDQ_SORT);
+    REQUIRE(choice_for(random_strings.begin(), random_strings.begin() + 1000, std::less<>()) == USE_INTROSORT);
+    REQUIRE(choice_for(few_strings.begin(), few_strings.end(), std::less<>()) == USE_PDQ_SORT);
+    REQUIRE(choice_for(random_ints.begin(), random_ints.begin() + 10, std::less<>()) == USE_INTROSORT);
+
+    // Whatever is chosen sorts, around the thresholds and in both orders
+    for (size_t size : {0, 1, 63, 64, 100, 2047, 2048, 10000}) {
+        for (const vector<int>* ints : {&random_ints, &few_ints, &sorted_ints}) {
+            vector<int> sorted(ints->begin(), ints->begin() + size);
+            vector<int> std_sorted = sorted;
+            std::sort(std_sorted.begin(), std_sorted.end());
+            smart_sort(sorted.begin(), sorted.end());
+            REQUIRE(sorted == std_sorted);
+            smart_sort(sorted.begin(), sorted.end(), std::greater<>());
+            REQUIRE(sorted == vector<int>(std_sorted.rbegin(), std_sorted.rend()));
+        }
+
+        vector<double> doubles(random_doubles.begin(), random_doubles.begin() + size);
+        smart_sort(doubles.begin(), doubles.end(), std::greater<double>());
+        REQUIRE(std::is_sorted(doubles.begin(), doubles.end(), std::greater<double>()));
+        vector<std::string> strings(random_strings.begin(), random_strings.begin() + size);
+        smart_sort(strings.begin(), strings.end());
+        REQUIRE(std::is_sorted(strings.begin(), strings.end()));
+    }
+
+    // Thresholds are saved and loaded as "name value" lines
+    SmartSortThresholds tuned;
+    tuned.radix_sort_min_size = 123;
+    tuned.tim_sort_max_descent_ratio = 0.1;
+    auto thresholds_file = [](const char* text) {
+        FileHandle file = make_temp_file();
+        std::fputs(text, file.get());
+        std::rewind(file.get());
+        return file;
+    };
+    FileHandle saved = make_temp_file();
+    save_smart_sort_thresholds(tuned, saved.get());
+    std::rewind(saved.get());
+    const SmartSortThresholds loaded = load_smart_sort_thresholds(saved.get());
+    REQUIRE(loaded.radix_sort_min_size == 123);
+    REQUIRE(loaded.tim_sort_max_descent_ratio == 0.1);
+    REQUIRE(loaded.pdq_sort_min_size == thresholds.pdq_sort_min_size);
+    REQUIRE(load_smart_sort_thresholds(thresholds_file(" sample_size\t64\r\n\n").get()).sample_size == 64);
+    REQUIRE_THROWS_AS(load_smart_sort_thresholds(thresholds_file("radix_sort_max_size 10\n").get()), std::runtime_error);
+    REQUIRE_THROWS_AS(load_smart_sort_thresholds(thresholds_file("sample_size many\n").get()), std::runtime_error);
+    REQUIRE_THROWS_AS(load_smart_sort_thresholds(thresholds_file("sample_size -1\n").get()), std::runtime_error);
+    REQUIRE_THROWS_AS(load_smart_sort_thresholds(thresholds_file("sample_size 64abc\n").get()), std::runtime_error);
+    REQUIRE_THROWS_AS(load_smart_sort_thresholds(thresholds_file("radix_sort_min_size 1e6\n").get()), std::runtime_error);
+    REQUIRE_THROWS_AS(load_smart_sort_thresholds("no/such/file"), std::runtime_error);
+
+    // The tim sort ratios lie halfway between the ratio of the last input
+    // that tim sort wins on and the first that it loses on. The outcomes are
+    // given, rather than timed, so that they don't depend on the machine.
+    vector<int32_t> sorted_input(4096);
+    std::iota(sorted_input.begin(), sorted_input.end(), 0);
+    auto swapped_input = [&](const int level) {
+        vector<int32_t> input = sorted_input;
+        for (size_t i = 0; i + 1 < input.size(); i += size_t(1024) >> level)
+            std::swap(input[i], input[i + 1]);
+        return input;
+    };
+    auto descent_ratio = [](const SortStatistics& stats) { return stats.descent_ratio; };
+    auto ratio_at = [&](const int level) {
+        const vector<int32_t> input = swapped_input(level);
+        const size_t sample_size = std::min(thresholds.sample_size, input.size() / SMART_SORT_SAMPLE_FRACTION);
+        return sample_statistics(input.begin(), input.end(), std::less<>(), sample_size).descent_ratio;
+    };
+    int num_wins = 0;
+    auto tim_sort_wins = [&](const vector<int32_t>&) { return num_wins-- > 0; };
+    REQUIRE(ratio_at(4) < ratio_at(5));
+    num_wins = 5;
+    REQUIRE(calibrate_tim_sort_ratio(8, swapped_input, descent_ratio, tim_sort_wins, thresholds) ==
+            (ratio_at(4) + ratio_at(5)) / 2);
+    num_wins = 0;
+    REQUIRE(calibrate_tim_sort_ratio(8, swapped_input, descent_ratio, tim_sort_wins, thresholds) ==
+            ratio_at(0) / 2);
+    num_wins = 9;
+    REQUIRE(calibrate_tim_sort_ratio(8, swapped_input, descent_ratio, tim_sort_wins, thresholds) == 0.5);
+
+    // Calibration on small ranges is quick, and yields thresholds in range,
+    // whatever the timings
+    const SmartSortThresholds calibrated = calibrate_smart_sort(1024);
+    REQUIRE(calibrated.pdq_sort_min_size <= 1024);
+    REQUIRE(calibrated.radix_sort_min_size <= 1024);
+    REQUIRE(calibrated.tim_sort_max_descent_ratio >= 0);
+    REQUIRE(calibrated.tim_sort_max_descent_ratio <= 0.5);
+    REQUIRE(calibrated.counting_sort_max_range_ratio >= 0);
+    REQUIRE(calibrated.counting_sort_max_range_ratio <= double(COUNTING_SORT_RANGE_FACTOR));
+}
+
+TEST_CASE("Loading values and displaying states", "[sorting][utils]") {
+    // Binary values, over more than one block
+    vector<int64_t> values(LOAD_BLOCK_BYTES / sizeof(int64_t) + 3);
+    std::iota(values.begin(), values.end(), std::numeric_limits<int64_t>::max() - int64_t(values.size()));
+    FileHandle binary = make_temp_file();
+    save_values_binary(values, binary.get());
+    std::rewind(binary.get());
+    REQUIRE(load_values_binary<int64_t>(binary.get()) == values);
+    std::rewind(binary.get());
+    REQUIRE(load_values_binary<char>(binary.get()).size() == values.size() * sizeof(int64_t));
+    std::fseek(binary.get(), 0, SEEK_END);
+    std::fputc(0, binary.get());
+    std::rewind(binary.get());
+    REQUIRE_THROWS_AS(load_values_binary<int64_t>(binary.get()), std::runtime_error);
+
+    // Text values, including the limits of their types
+    FileHandle text = make_temp_file();
+    std::fputs("3 -2147483648\n 2147483647\t+7\r\n0 ", text.get());
+    std::rewind(text.get());
+    REQUIRE(load_values_text<int32_t>(text.get()) == vector<int32_t>{3, std::numeric_limits<int32_t>::min(),
+                                                                    std::numeric_limits<int32_t>::max(), 7, 0});
+    std::rewind(text.get());
+    REQUIRE(load_values_text<double>(text.get())[1] == -2147483648.0);
+    std::rewind(text.get());
+    REQUIRE_THROWS_AS(load_values_text<int16_t>(text.get()), std::runtime_error);
+    std::rewind(text.get());
+    REQUIRE_THROWS_AS(load_values_text<uint32_t>(text.get()), std::runtime_error);
+    FileHandle out_of_range = make_temp_file();
+    std::fputs("1e300 -1e300", out_of_range.get());
+    std::rewind(out_of_range.get());
+    REQUIRE(load_values_text<double>(out_of_range.get()) == vector<double>{1e300, -1e300});
+    std::rewind(out_of_range.get());
+    REQUIRE_THROWS_AS(load_values_text<float>(out_of_range.get()), std::runtime_error);
+    FileHandle invalid = make_temp_file();
+    std::fputs("1 2 three", invalid.get());
+    std::rewind(invalid.get());
+    REQUIRE_THROWS_AS(load_values_text<int>(invalid.get()), std::runtime_error);
+    REQUIRE_THROWS_AS(load_values_text<int>("no/such/file"), std::runtime_error);
+
+    // States are printed one line each
+    FileHandle output = make_temp_file();
+    display_state(vector<int>{3, -1, 2}, output.get());
+    std::rewind(output.get());
+    char line[16] = {};
+    REQUIRE(std::fgets(line, sizeof(line), output.get()) != nullptr);
+    REQUIRE(std::string(line) == "3 -1 2 \n");
+
+    // Wrappers choose the comparator and the step callback once
+    vector<int> traced{5, 1, 4};
+    int num_steps = 0;
+    sort_in_order(traced, -1, false, [&](auto comp, auto show_state) {
+        insertion_sort(traced.begin(), traced.end(), comp, [&]() { show_state(); num_steps++; });
+    });
+    REQUIRE(traced == vector<int>{5, 4, 1});
+    REQUIRE(num_steps > 0);
+}
+
 /*
     generate_unsorted_vector
     ------------------------